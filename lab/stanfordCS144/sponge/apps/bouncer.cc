@@ -8,7 +8,7 @@
 using namespace std;
 
 void program_body() {
-    EventLoop loop;
+    EventLoop loop{EventLoop::Backend::Epoll};
     vector<UDPSocket> sockets;
     vector<optional<Address>> peers;
     sockets.reserve(66000);
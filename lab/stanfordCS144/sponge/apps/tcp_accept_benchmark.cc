@@ -0,0 +1,105 @@
+#include "tcp_connection_manager.hh"
+#include "tcp_sponge_listener.hh"
+#include "util.hh"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using ConnectionId = TCPConnectionManager::ConnectionId;
+
+constexpr size_t connections = 10000;
+constexpr size_t clients = 4;                 // peers (each a TCPConnectionManager on its own UDP socket)
+constexpr size_t handshakes_per_client = 16;  // connections each peer has opening at once
+constexpr uint64_t time_limit_ms = 60000;
+
+//! Open `connections` connections to a listener whose application accepts and closes each at once
+void accept_loop(const size_t backlog, const bool io_uring) {
+    TCPConfig config;
+    config.rt_timeout = 50;  // (a SYN dropped for want of backlog is retransmitted soon)
+    FdAdapterConfig adapter_config;
+    adapter_config.source = {"127.0.0.1", 0};
+    adapter_config.io_uring = io_uring;
+
+    TCPSpongeListener listener{config, adapter_config, backlog};
+    atomic<size_t> accepted{0};
+    thread application([&] {
+        while (accepted < connections) {
+            listener.accept();  // (and close: the listener ends the connection)
+            accepted++;
+        }
+    });
+
+    vector<unique_ptr<TCPConnectionManager>> peers;
+    vector<size_t> opening(clients, 0);
+    size_t started = 0, closed = 0;
+    for (size_t c = 0; c < clients; c++) {
+        peers.push_back(make_unique<TCPConnectionManager>(config, adapter_config, TCPConnectionManager::Callbacks{}));
+        TCPConnectionManager &peer = *peers.back();
+        TCPConnectionManager::Callbacks callbacks;
+        callbacks.on_open = [&opening, c](ConnectionId) { opening[c]--; };
+        callbacks.on_readable = [&peer](ConnectionId id) {
+            const ByteStream &inbound = peer.inbound_stream(id);
+            if (inbound.error()) {
+                throw runtime_error("connection reset");
+            }
+            if (inbound.eof()) {
+                peer.end_input(id);
+            }
+        };
+        callbacks.on_close = [&closed](ConnectionId) { closed++; };
+        peer.set_callbacks(move(callbacks));
+    }
+
+    const uint64_t deadline = timestamp_ms() + time_limit_ms;
+    const auto first_time = chrono::steady_clock::now();
+    while (accepted < connections) {
+        for (size_t c = 0; c < clients; c++) {
+            while (opening[c] < handshakes_per_client and started < connections) {
+                peers[c]->connect(listener.local_address());
+                opening[c]++;
+                started++;
+            }
+            peers[c]->wait_next_event(chrono::microseconds{1000 / clients});
+        }
+        if (timestamp_ms() > deadline) {
+            throw runtime_error("timed out after " + to_string(accepted) + " connections");
+        }
+    }
+    const auto final_time = chrono::steady_clock::now();
+    application.join();
+
+    const double seconds = chrono::duration<double>(final_time - first_time).count();
+    cout << fixed << setprecision(0) << "[backlog " << setw(3) << backlog
+         << (io_uring ? ", io_uring] " : "]           ") << connections
+         << " connections accepted: " << connections / seconds << " connections/s\n";
+
+    // let the connections finish closing, and the listener's side finish lingering in TIME_WAIT
+    while (closed < connections and timestamp_ms() < deadline) {
+        for (auto &peer : peers) {
+            peer->wait_next_event(chrono::microseconds{1000});
+        }
+    }
+    this_thread::sleep_for(chrono::milliseconds{20 * config.rt_timeout});  // (twice the ten RTOs they linger)
+}
+
+int main() {
+    try {
+        for (const size_t backlog : {size_t{16}, size_t{128}}) {
+            accept_loop(backlog, false);
+        }
+        accept_loop(128, true);
+    } catch (const exception &e) {
+        cerr << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -10,6 +10,9 @@ using namespace std;
 using namespace std::chrono;
 
 constexpr size_t len = 100 * 1024 * 1024;
+constexpr size_t small_len = 16 * 1024 * 1024;
+constexpr size_t small_write = 100;      // bytes per write() in the small-write benchmark
+constexpr size_t writes_per_round = 64;  // small writes between exchanges of segments
 
 void move_segments(TCPConnection &x, TCPConnection &y, vector<TCPSegment> &segments, const bool reorder) {
     while (not x.segments_out().empty()) {
@@ -28,8 +31,14 @@ void move_segments(TCPConnection &x, TCPConnection &y, vector<TCPSegment> &segme
     segments.clear();
 }
 
-void main_loop(const bool reorder) {
+void main_loop(const bool reorder,
+               const ByteStream::Backend backend,
+               const StreamReassembler::Engine engine,
+               const bool delayed_ack = false) {
     TCPConfig config;
+    config.stream_backend = backend;
+    config.reassembler_engine = engine;
+    config.delayed_ack = delayed_ack;
     TCPConnection x{config}, y{config};
 
     string string_to_send(len, 'x');
@@ -42,6 +51,7 @@ void main_loop(const bool reorder) {
     y.end_input_stream();
 
     bool x_closed = false;
+    size_t acks_sent = 0;
 
     string string_received;
     string_received.reserve(len);
@@ -67,6 +77,7 @@ void main_loop(const bool reorder) {
         // exchange segments between x and y but in reverse order
         vector<TCPSegment> segments;
         move_segments(x, y, segments, reorder);
+        acks_sent += y.segments_out().size();
         move_segments(y, x, segments, false);
 
         // read output from y
@@ -95,18 +106,107 @@ void main_loop(const bool reorder) {
     const auto gigabits_per_second = len * 8.0 / double(duration);
 
     cout << fixed << setprecision(2);
-    cout << "CPU-limited throughput" << (reorder ? " with reordering: " : "                : ") << gigabits_per_second
-         << " Gbit/s\n";
+    cout << (backend == ByteStream::Backend::Ring ? "[ring" : "[list")
+         << (engine == StreamReassembler::Engine::Ring ? ", ring] " : ", map]  ") << "CPU-limited throughput"
+         << (reorder ? " with reordering: " : delayed_ack ? " (delayed ACKs) : " : "                : ")
+         << gigabits_per_second << " Gbit/s";
+    if (not reorder) {
+        cout << ", " << acks_sent << " ACKs";
+    }
+    cout << "\n";
 
     while (x.active() or y.active()) {
         loop();
     }
 }
 
+//! How the small-write benchmark hands its writes to the connection
+enum class Batching { None, Nagle, Cork };
+
+void small_writes_loop(const Batching batching) {
+    TCPConfig config;
+    config.nagle = batching == Batching::Nagle;
+    TCPConnection x{config}, y{config};
+
+    const string chunk(small_write, 'x');
+    size_t bytes_written = 0;
+    size_t bytes_received = 0;
+    size_t segments_sent = 0;
+    bool x_closed = false;
+    x.connect();
+    y.end_input_stream();
+
+    const auto first_time = high_resolution_clock::now();
+
+    vector<TCPSegment> segments;
+    while (not y.inbound_stream().eof()) {
+        // a burst of small writes, then the segments they produced cross (and are acknowledged)
+        if (batching == Batching::Cork) {
+            x.cork();
+        }
+        for (size_t i = 0; i < writes_per_round and bytes_written < small_len; i++) {
+            if (x.remaining_outbound_capacity() < small_write) {
+                break;
+            }
+            bytes_written += x.write(chunk.substr(0, small_len - bytes_written));
+        }
+        if (batching == Batching::Cork) {
+            x.uncork();
+        }
+        if (bytes_written == small_len and not x_closed) {
+            x.end_input_stream();
+            x_closed = true;
+        }
+
+        segments_sent += x.segments_out().size();
+        move_segments(x, y, segments, false);
+        move_segments(y, x, segments, false);
+        bytes_received += y.inbound_stream().read(y.inbound_stream().buffer_size()).size();
+
+        x.tick(1);
+        y.tick(1);
+    }
+
+    if (bytes_received != small_len) {
+        throw runtime_error("bytes sent vs. received don't match");
+    }
+
+    const auto final_time = high_resolution_clock::now();
+    const auto duration = duration_cast<nanoseconds>(final_time - first_time).count();
+    const auto gigabits_per_second = small_len * 8.0 / double(duration);
+
+    cout << fixed << setprecision(2);
+    const char *label = batching == Batching::None    ? "[no batching]"
+                        : batching == Batching::Nagle ? "[nagle]"
+                                                      : "[cork]";
+    cout << left << setw(14) << label << right << small_write << "-byte writes: " << gigabits_per_second
+         << " Gbit/s, " << segments_sent << " segments\n";
+
+    while (x.active() or y.active()) {
+        move_segments(x, y, segments, false);
+        move_segments(y, x, segments, false);
+        x.tick(1000);
+        y.tick(1000);
+    }
+}
+
 int main() {
     try {
-        main_loop(false);
-        main_loop(true);
+        for (const auto backend : {ByteStream::Backend::List, ByteStream::Backend::Ring}) {
+            for (const auto engine : {StreamReassembler::Engine::Map, StreamReassembler::Engine::Ring}) {
+                main_loop(false, backend, engine);
+                main_loop(true, backend, engine);
+            }
+        }
+        main_loop(false, ByteStream::Backend::List, StreamReassembler::Engine::Map, true);
+
+        for (const auto batching : {Batching::None, Batching::Nagle, Batching::Cork}) {
+            small_writes_loop(batching);
+        }
+
+        const auto &pool = BufferPool::local().stats();
+        cout << "buffer pool: " << pool.hits << " hits, " << pool.misses << " misses, high water " << pool.high_water
+             << " buffers\n";
     } catch (const exception &e) {
         cerr << e.what() << "\n";
         return EXIT_FAILURE;
@@ -30,7 +30,24 @@ static void show_usage(const char *argv0, const char *msg) {
          << "   -w <winsz>      Use a window of <winsz> bytes                   " << TCPConfig::MAX_PAYLOAD_SIZE
          << "\n\n"
 
-         << "   -t <tmout>      Set rt_timeout to tmout                         " << TCPConfig::TIMEOUT_DFLT << "\n\n"
+         << "   -t <tmout>      Set rt_timeout to tmout                         " << TCPConfig::TIMEOUT_DFLT << "\n"
+         << "   -R              Keep the retransmission timeout at <tmout>      (adapt to the RTT)\n\n"
+
+         << "   -m <mss>        Use segments of up to <mss> payload bytes       " << TCPConfig::MAX_PAYLOAD_SIZE << "\n"
+         << "   -M <mtu>        Send datagrams of up to <mtu> bytes             1500\n"
+         << "                   (the MSS is lowered to fit the MTU)\n"
+         << "   -U              Batch datagram reads and writes with io_uring   (one system call each)\n\n"
+
+         << "   -S              Disable selective acknowledgments (SACK)        (enabled)\n"
+         << "   -W              Disable window scaling                          (enabled)\n"
+         << "   -T              Disable timestamps (RTT measurement, PAWS)      (enabled)\n\n"
+
+         << "   -C <algo>       Use congestion control <algo>                   none\n"
+         << "                   (none, reno, newreno, cubic or bbr)\n"
+         << "   -p              Pace segments at the congestion control's rate  (no pacing)\n"
+         << "   -P <rate>       Pace segments at <rate> bytes per second        (no pacing)\n"
+         << "   -N              Coalesce small writes (Nagle's algorithm)       (send at once)\n"
+         << "   -D              Delay ACKs, acknowledging every second segment  (ACK every segment)\n\n"
 
          << "   -d <tundev>     Connect to tun <tundev>                         " << TUN_DFLT << "\n\n"
 
@@ -54,6 +71,7 @@ static void check_argc(int argc, char **argv, int curr, const char *err) {
 
 static tuple<TCPConfig, FdAdapterConfig, bool, char *> get_config(int argc, char **argv) {
     TCPConfig c_fsm{};
+    c_fsm.adaptive_rto = true;
     FdAdapterConfig c_filt{};
     char *tundev = nullptr;
 
@@ -88,11 +106,69 @@ static tuple<TCPConfig, FdAdapterConfig, bool, char *> get_config(int argc, char
             c_fsm.rt_timeout = strtol(argv[curr + 1], nullptr, 0);
             curr += 2;
 
+        } else if (strncmp("-m", argv[curr], 3) == 0) {
+            check_argc(argc, argv, curr, "ERROR: -m requires one argument.");
+            c_fsm.mss = strtol(argv[curr + 1], nullptr, 0);
+            curr += 2;
+
+        } else if (strncmp("-M", argv[curr], 3) == 0) {
+            check_argc(argc, argv, curr, "ERROR: -M requires one argument.");
+            c_filt.mtu = strtol(argv[curr + 1], nullptr, 0);
+            curr += 2;
+
+        } else if (strncmp("-U", argv[curr], 3) == 0) {
+            c_filt.io_uring = true;
+            curr += 1;
+
+        } else if (strncmp("-R", argv[curr], 3) == 0) {
+            c_fsm.adaptive_rto = false;
+            curr += 1;
+
+        } else if (strncmp("-S", argv[curr], 3) == 0) {
+            c_fsm.sack = false;
+            curr += 1;
+
+        } else if (strncmp("-W", argv[curr], 3) == 0) {
+            c_fsm.window_scaling = false;
+            curr += 1;
+
+        } else if (strncmp("-T", argv[curr], 3) == 0) {
+            c_fsm.timestamps = false;
+            curr += 1;
+
+        } else if (strncmp("-C", argv[curr], 3) == 0) {
+            check_argc(argc, argv, curr, "ERROR: -C requires one argument.");
+            const auto algorithm = CongestionControl::parse(argv[curr + 1]);
+            if (not algorithm.has_value()) {
+                show_usage(argv[0], string("ERROR: unknown congestion control " + string(argv[curr + 1])).c_str());
+                exit(1);
+            }
+            c_fsm.congestion_control = algorithm.value();
+            curr += 2;
+
         } else if (strncmp("-d", argv[curr], 3) == 0) {
             check_argc(argc, argv, curr, "ERROR: -t requires one argument.");
             tundev = argv[curr + 1];
             curr += 2;
 
+        } else if (strncmp("-p", argv[curr], 3) == 0) {
+            c_fsm.pacing = true;
+            curr += 1;
+
+        } else if (strncmp("-P", argv[curr], 3) == 0) {
+            check_argc(argc, argv, curr, "ERROR: -P requires one argument.");
+            c_fsm.pacing = true;
+            c_fsm.pacing_rate = strtoull(argv[curr + 1], nullptr, 0);
+            curr += 2;
+
+        } else if (strncmp("-N", argv[curr], 3) == 0) {
+            c_fsm.nagle = true;
+            curr += 1;
+
+        } else if (strncmp("-D", argv[curr], 3) == 0) {
+            c_fsm.delayed_ack = true;
+            curr += 1;
+
         } else if (strncmp("-Lu", argv[curr], 3) == 0) {
             check_argc(argc, argv, curr, "ERROR: -Lu requires one argument.");
             float lossrate = strtof(argv[curr + 1], nullptr);
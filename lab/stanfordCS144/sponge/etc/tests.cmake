@@ -13,6 +13,7 @@ add_test(NAME t_recv_window          COMMAND recv_window)
 add_test(NAME t_recv_reorder         COMMAND recv_reorder)
 add_test(NAME t_recv_close           COMMAND recv_close)
 add_test(NAME t_recv_special         COMMAND recv_special)
+add_test(NAME t_recv_sack            COMMAND recv_sack)
 
 add_test(NAME t_send_connect         COMMAND send_connect)
 add_test(NAME t_send_transmit        COMMAND send_transmit)
@@ -21,6 +22,12 @@ add_test(NAME t_send_window          COMMAND send_window)
 add_test(NAME t_send_ack             COMMAND send_ack)
 add_test(NAME t_send_close           COMMAND send_close)
 add_test(NAME t_send_extra           COMMAND send_extra)
+add_test(NAME t_send_sack            COMMAND send_sack)
+add_test(NAME t_send_rtt             COMMAND send_rtt)
+add_test(NAME t_send_congestion      COMMAND send_congestion)
+add_test(NAME t_send_fast_retx       COMMAND send_fast_retx)
+add_test(NAME t_send_nagle           COMMAND send_nagle)
+add_test(NAME t_send_persist         COMMAND send_persist)
 
 add_test(NAME t_strm_reassem_single      COMMAND fsm_stream_reassembler_single)
 add_test(NAME t_strm_reassem_seq         COMMAND fsm_stream_reassembler_seq)
@@ -30,12 +37,23 @@ add_test(NAME t_strm_reassem_many        COMMAND fsm_stream_reassembler_many)
 add_test(NAME t_strm_reassem_overlapping COMMAND fsm_stream_reassembler_overlapping)
 add_test(NAME t_strm_reassem_win         COMMAND fsm_stream_reassembler_win)
 add_test(NAME t_strm_reassem_cap         COMMAND fsm_stream_reassembler_cap)
+add_test(NAME t_strm_reassem_ring        COMMAND fsm_stream_reassembler_ring)
 
 add_test(NAME t_byte_stream_construction COMMAND byte_stream_construction)
 add_test(NAME t_byte_stream_one_write    COMMAND byte_stream_one_write)
 add_test(NAME t_byte_stream_two_writes   COMMAND byte_stream_two_writes)
 add_test(NAME t_byte_stream_capacity     COMMAND byte_stream_capacity)
 add_test(NAME t_byte_stream_many_writes  COMMAND byte_stream_many_writes)
+add_test(NAME t_byte_stream_ring       COMMAND byte_stream_ring)
+
+add_test(NAME t_buffer_pool            COMMAND buffer_pool)
+add_test(NAME t_buffer_list            COMMAND buffer_list)
+add_test(NAME t_timer_wheel            COMMAND timer_wheel)
+add_test(NAME t_eventloop              COMMAND eventloop)
+add_test(NAME t_io_engine              COMMAND io_engine)
+add_test(NAME t_tcp_connection_manager COMMAND tcp_connection_manager)
+add_test(NAME t_sharded_tcp_connection_manager COMMAND sharded_tcp_connection_manager)
+add_test(NAME t_tcp_sponge_listener COMMAND tcp_sponge_listener)
 
 add_test(NAME t_webget               COMMAND "${PROJECT_SOURCE_DIR}/tests/webget_t.sh")
 
@@ -56,6 +74,11 @@ add_test(NAME t_connect              COMMAND fsm_connect_relaxed)
 add_test(NAME ec_listen              COMMAND fsm_listen)
 add_test(NAME t_listen               COMMAND fsm_listen_relaxed)
 add_test(NAME t_winsize              COMMAND fsm_winsize)
+add_test(NAME t_winscale             COMMAND fsm_winscale)
+add_test(NAME t_mss                  COMMAND fsm_mss)
+add_test(NAME t_fast_retx            COMMAND fsm_fast_retx)
+add_test(NAME t_delayed_ack          COMMAND fsm_delayed_ack)
+add_test(NAME t_timestamps           COMMAND fsm_timestamps)
 add_test(NAME ec_retx                COMMAND fsm_retx)
 add_test(NAME t_retx                 COMMAND fsm_retx_relaxed)
 add_test(NAME t_retx_win             COMMAND fsm_retx_win)
@@ -1,5 +1,6 @@
 #include "byte_stream.hh"
 
+#include <cstring>
 #include <sstream>
 
 // Dummy implementation of a flow-controlled in-memory byte stream.
@@ -14,16 +15,23 @@ void DUMMY_CODE(Targs &&... /* unused */) {}
 
 using namespace std;
 
-ByteStream::ByteStream(const size_t capacity)
+//! \param[in] capacity the maximum number of bytes buffered at any one time
+//! \param[in] backend the storage engine; Backend::Ring allocates all `capacity` bytes up front
+ByteStream::ByteStream(const size_t capacity, const Backend backend)
     : _capacity(capacity)
+    , _backend(backend)
     , _bytes_written(0)
     , _bytes_read(0)
     , _buffer{}
+    , _ring(backend == Backend::Ring ? capacity : 0, '\0')
     , _buffer_size{0}
     , _end_input(false)
     , _error(false) {}
 
 size_t ByteStream::write(const string &data) {
+    if (_backend == Backend::Ring) {
+        return write(data.data(), data.size());
+    }
     size_t count = min(_capacity - _buffer_size, data.length());
     _buffer.append(BufferList(std::move(data.substr(0, count))));
     _buffer_size += count;
@@ -31,16 +39,108 @@ size_t ByteStream::write(const string &data) {
     return count;
 }
 
+//! \details With Backend::List, a string that fits entirely is adopted as the stream's next Buffer
+//! instead of being copied. Backend::Ring always copies into the ring. A string whose allocation is
+//! mostly unused (e.g. a short read into a large buffer) is also copied, so that the stream does not
+//! pin the slack until the bytes are read.
+size_t ByteStream::write(string &&data) {
+    if (_backend == Backend::Ring or data.size() > remaining_capacity() or data.capacity() / 2 > data.size()) {
+        return write(data.data(), data.size());
+    }
+    const size_t count = data.size();
+    if (count > 0) {
+        _buffer.append(BufferList(std::move(data)));
+    }
+    _buffer_size += count;
+    _bytes_written += count;
+    return count;
+}
+
+//! \details With Backend::List, a Buffer that fits entirely is shared by the stream (no copy).
+size_t ByteStream::write(Buffer data) {
+    if (_backend == Backend::Ring or data.size() > remaining_capacity()) {
+        return write(data.str().data(), data.size());
+    }
+    const size_t count = data.size();
+    if (count > 0) {
+        _buffer.append(std::move(data));
+    }
+    _buffer_size += count;
+    _bytes_written += count;
+    return count;
+}
+
+//! \param[in] data points to the bytes to be written
+//! \param[in] len is the number of bytes available at `data`
+size_t ByteStream::write(const char *data, const size_t len) {
+    const size_t count = min(_capacity - _buffer_size, len);
+    if (count == 0) {
+        return 0;
+    }
+    if (_backend == Backend::List) {
+        // copy into pool-sized chunks, so large writes don't need a large allocation
+        for (size_t offset = 0; offset < count; offset += BufferPool::CHUNK_SIZE) {
+            const size_t chunk_size = min(BufferPool::CHUNK_SIZE, count - offset);
+            string chunk = BufferPool::local().acquire(chunk_size);
+            chunk.append(data + offset, chunk_size);
+            _buffer.append(Buffer{move(chunk)});
+        }
+    } else {
+        // copy into the free region after the readable bytes, wrapping around the end of the ring
+        const size_t tail = (_ring_head + _buffer_size) % _capacity;
+        const size_t first = min(count, _capacity - tail);
+        memcpy(_ring.data() + tail, data, first);
+        memcpy(_ring.data(), data + first, count - first);
+    }
+    _buffer_size += count;
+    _bytes_written += count;
+    return count;
+}
+
 //! \param[in] len bytes will be copied from the output side of the buffer
 string ByteStream::peek_output(const size_t len) const {
     size_t count = min(len, _buffer_size);
-    return _buffer.concatenate(count);
+    if (_backend == Backend::List) {
+        return _buffer.concatenate(count);
+    }
+    const size_t first = min(count, _capacity - _ring_head);
+    string ret = BufferPool::local().acquire(count);
+    ret.append(_ring, _ring_head, first);
+    ret.append(_ring, 0, count - first);
+    return ret;
+}
+
+//! \param[in] len bytes at the output side of the buffer will be exposed
+//! \details The returned list holds one view per stored Buffer (Backend::List), or at most
+//! two views (Backend::Ring), so it can be handed to FileDescriptor::write() as iovecs.
+BufferViewList ByteStream::peek_output_views(const size_t len) const {
+    size_t count = min(len, _buffer_size);
+    BufferViewList ret;
+    if (_backend == Backend::List) {
+        for (const auto &buf : _buffer.buffers()) {
+            if (count == 0) {
+                break;
+            }
+            const string_view view = buf.str().substr(0, count);
+            ret.append(view);
+            count -= view.size();
+        }
+        return ret;
+    }
+    const size_t first = min(count, _capacity - _ring_head);
+    ret.append({_ring.data() + _ring_head, first});
+    ret.append({_ring.data(), count - first});
+    return ret;
 }
 
 //! \param[in] len bytes will be removed from the output side of the buffer
 void ByteStream::pop_output(const size_t len) {
     size_t count = min(len, _buffer_size);
-    _buffer.remove_prefix(count);
+    if (_backend == Backend::List) {
+        _buffer.remove_prefix(count);
+    } else if (count > 0) {
+        _ring_head = (_ring_head + count) % _capacity;
+    }
     _bytes_read += count;
     _buffer_size -= count;
 }
@@ -49,11 +149,25 @@ void ByteStream::pop_output(const size_t len) {
 //! \param[in] len bytes will be popped and returned
 //! \returns a string
 string ByteStream::read(const size_t len) {
-    const auto ret = peek_output(len);
+    auto ret = peek_output(len);
     pop_output(len);
     return ret;
 }
 
+//! \param[in] len bytes will be popped and returned
+//! \details Segment payloads come from here, so with Backend::List a segment (and any retransmission
+//! of it) refers to the bytes the writer handed over instead of a copy of them.
+Buffer ByteStream::read_buffer(const size_t len) {
+    const size_t count = min(len, _buffer_size);
+    if (_backend == Backend::List and count > 0 and _buffer.buffers().front().size() >= count) {
+        Buffer ret = _buffer.buffers().front();
+        ret.remove_suffix(ret.size() - count);
+        pop_output(count);
+        return ret;
+    }
+    return Buffer{read(count)};
+}
+
 void ByteStream::end_input() { _end_input = true; }
 
 bool ByteStream::input_ended() const { return _end_input; }
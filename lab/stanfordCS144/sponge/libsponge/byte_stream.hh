@@ -12,6 +12,13 @@
 //! side.  The byte stream is finite: the writer can end the input,
 //! and then no more bytes can be written.
 class ByteStream {
+  public:
+    //! Storage engine that holds the bytes between the writer and the reader
+    enum class Backend {
+        List,  //!< a BufferList with one reference-counted Buffer per write
+        Ring   //!< one contiguous ring buffer, allocated once at the stream's capacity
+    };
+
   private:
     // Your code here -- add private members as necessary.
 
@@ -20,17 +27,20 @@ class ByteStream {
     // that's a sign that you probably want to keep exploring
     // different approaches.
     size_t _capacity;
+    Backend _backend;
     size_t _bytes_written;
     size_t _bytes_read;
     BufferList _buffer;
+    std::string _ring;     //!< Storage for Backend::Ring, sized to `_capacity` at construction
+    size_t _ring_head{0};  //!< Index in `_ring` of the next byte to be read
     size_t _buffer_size;
     bool _end_input;
 
     bool _error;  //!< Flag indicating that the stream suffered an error.
 
   public:
-    //! Construct a stream with room for `capacity` bytes.
-    ByteStream(const size_t capacity);
+    //! Construct a stream with room for `capacity` bytes, stored using the given `backend`.
+    ByteStream(const size_t capacity, const Backend backend = Backend::List);
 
     //! \name "Input" interface for the writer
     //!@{
@@ -40,6 +50,19 @@ class ByteStream {
     //! \returns the number of bytes accepted into the stream
     size_t write(const std::string &data);
 
+    //! Write a string of bytes into the stream, taking ownership of `data` if all of it fits.
+    //! \note If only part of `data` fits, that part is copied and `data` is left untouched.
+    //! \returns the number of bytes accepted into the stream
+    size_t write(std::string &&data);
+
+    //! Write a Buffer into the stream, sharing its storage if all of it fits.
+    //! \returns the number of bytes accepted into the stream
+    size_t write(Buffer data);
+
+    //! Write `len` bytes starting at `data`, as many as will fit.
+    //! \returns the number of bytes accepted into the stream
+    size_t write(const char *data, const size_t len);
+
     //! \returns the number of additional bytes that the stream has space for
     size_t remaining_capacity() const;
 
@@ -57,6 +80,10 @@ class ByteStream {
     //! \returns a string
     std::string peek_output(const size_t len) const;
 
+    //! Peek at next "len" bytes of the stream without copying them
+    //! \returns views of the stream's own storage, valid until the next call to pop_output() or read()
+    BufferViewList peek_output_views(const size_t len) const;
+
     //! Remove bytes from the buffer
     void pop_output(const size_t len);
 
@@ -64,6 +91,11 @@ class ByteStream {
     //! \returns a string
     std::string read(const size_t len);
 
+    //! Read (i.e., take and then pop) the next "len" bytes of the stream as a Buffer
+    //! \returns a Buffer that shares the stream's storage when the bytes lie in one stored Buffer
+    //! (Backend::List), or else a copy
+    Buffer read_buffer(const size_t len);
+
     //! \returns `true` if the stream input has ended
     bool input_ended() const;
 
@@ -88,6 +120,9 @@ class ByteStream {
 
     //! Total number of bytes popped
     size_t bytes_read() const;
+
+    //! Storage engine selected at construction
+    Backend backend() const { return _backend; }
     //!@}
 };
 
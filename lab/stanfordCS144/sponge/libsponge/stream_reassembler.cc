@@ -10,20 +10,60 @@
 template <typename... Targs>
 void DUMMY_CODE(Targs &&... /* unused */) {}
 
+#include <algorithm>
+#include <cstring>
+
 using namespace std;
 
-StreamReassembler::StreamReassembler(const size_t capacity)
-    : _output(capacity), _capacity(capacity), _unassemble_buffer(), _next_pos(0), _unassembled_bytes(0) {}
+StreamReassembler::StreamReassembler(const size_t capacity,
+                                     const ByteStream::Backend backend,
+                                     const Engine engine)
+    : _output(capacity, backend)
+    , _capacity(capacity)
+    , _engine(engine)
+    , _unassemble_buffer()
+    , _next_pos(0)
+    , _unassembled_bytes(0)
+    , _window(engine == Engine::Ring ? capacity : 0, 0)
+    , _present(engine == Engine::Ring ? (capacity + 63) / 64 : 0, 0) {}
 
 //! \details This function accepts a substring (aka a segment) of bytes,
 //! possibly out-of-order, from the logical stream, and assembles any newly
 //! contiguous substrings and writes them into the output stream in order.
 void StreamReassembler::push_substring(const string &data, const size_t index, const bool eof) {
-    insert_pair(data, index);
-    write_output();
+    if (_engine == Engine::Ring) {
+        push_window(data.data(), data.size(), index);
+    } else {
+        insert_pair(data, index);
+        write_output();
+    }
+    update_eof(index + data.length(), eof);
+}
+
+//! \details In-order data that fits in the output stream, with nothing else waiting to be
+//! reassembled, is handed to the stream as a Buffer and never copied. Anything else takes the
+//! same path as the std::string version.
+void StreamReassembler::push_substring(const Buffer &data, const uint64_t index, const bool eof) {
+    const size_t end_index = index + data.size();
+    if (empty() and index <= _next_pos and _next_pos < end_index and
+        end_index - _next_pos <= _output.remaining_capacity()) {
+        Buffer in_order = data;
+        in_order.remove_prefix(_next_pos - index);
+        _next_pos += _output.write(std::move(in_order));
+        update_eof(end_index, eof);
+        return;
+    }
+    if (_engine == Engine::Ring) {
+        push_window(data.str().data(), data.size(), index);
+        update_eof(end_index, eof);
+        return;
+    }
+    push_substring(data.copy(), index, eof);
+}
 
+void StreamReassembler::update_eof(const size_t end_index, const bool eof) {
     if (eof) {
-        _eof_index = index + data.length();
+        _eof_index = end_index;
         _eof_appear_sign = true;
     }
     if (_eof_appear_sign && _next_pos >= _eof_index) {
@@ -85,10 +125,11 @@ void StreamReassembler::insert_pair(const string &data, const size_t index) {
     string new_data = data.substr(new_index - index, new_length);
 
     // optimize 1: if we can write this data we don't insert into map
+    // (the stream adopts new_data if it fits whole, so its length is checked before the move)
     if (new_index == _next_pos) {
         const size_t write_bytes = _output.write(std::move(new_data));
         _next_pos += write_bytes;
-        if (write_bytes == new_data.length()) {
+        if (write_bytes == new_length) {
             return;
         }
         new_index += write_bytes;
@@ -103,10 +144,11 @@ void StreamReassembler::insert_pair(const string &data, const size_t index) {
 void StreamReassembler::write_output() {
     auto it = _unassemble_buffer.begin();
     while (!_unassemble_buffer.empty() && it->first == _next_pos && _output.remaining_capacity() > 0) {
+        const size_t length = it->second.length();
         const size_t write_bytes = _output.write(std::move(it->second));
         _unassembled_bytes -= write_bytes;
         _next_pos += write_bytes;
-        if (write_bytes < it->second.length()) {
+        if (write_bytes < length) {
             if (write_bytes == 0) {
                 return;
             }
@@ -117,6 +159,134 @@ void StreamReassembler::write_output() {
     }
 }
 
+//! \details Bytes outside the acceptable window are discarded. In-order bytes are written
+//! straight to the output; the rest are copied into the window and marked present.
+void StreamReassembler::push_window(const char *data, const size_t len, const size_t index) {
+    const size_t first_unacceptable_idx = _next_pos + _capacity - _output.buffer_size();
+    const size_t begin = max(index, _next_pos);
+    const size_t end = min(index + len, first_unacceptable_idx);
+    if (begin >= end) {
+        return;
+    }
+
+    const size_t count = end - begin;
+    const char *const src = data + (begin - index);
+    const size_t pos = begin % _capacity;
+
+    // in-order bytes always fit in the output, since the window ends at its remaining capacity
+    if (begin == _next_pos) {
+        _output.write(src, count);
+        _unassembled_bytes -= set_present(pos, count, false);
+        _next_pos = end;
+        flush_window();
+        return;
+    }
+
+    const size_t first = min(count, _capacity - pos);
+    memcpy(&_window[pos], src, first);
+    memcpy(&_window[0], src + first, count - first);
+    _unassembled_bytes += set_present(pos, count, true);
+}
+
+//! \details Writes the run of present bytes starting at `_next_pos` (if any) to the output.
+void StreamReassembler::flush_window() {
+    if (_capacity == 0) {
+        return;
+    }
+
+    const size_t pos = _next_pos % _capacity;
+    const size_t count = run_length(pos, _output.remaining_capacity(), true);
+    if (count == 0) {
+        return;
+    }
+
+    const size_t first = min(count, _capacity - pos);
+    _output.write(_window.data() + pos, first);
+    if (count > first) {
+        _output.write(_window.data(), count - first);
+    }
+    set_present(pos, count, false);
+    _unassembled_bytes -= count;
+    _next_pos += count;
+}
+
+//! \param[in] pos is the window position of the first byte
+//! \param[in] len is the number of bytes (wrapping around the end of the window)
+//! \param[in] present is the state to set
+//! \returns the number of bytes whose state changed
+size_t StreamReassembler::set_present(size_t pos, size_t len, const bool present) {
+    size_t changed = 0;
+    while (len > 0) {
+        const size_t bit = pos % 64;
+        const size_t span = min({len, 64 - bit, _capacity - pos});
+        const uint64_t mask = (span == 64 ? ~uint64_t{0} : (uint64_t{1} << span) - 1) << bit;
+
+        uint64_t &word = _present[pos / 64];
+        const uint64_t flips = mask & (present ? ~word : word);
+        changed += __builtin_popcountll(flips);
+        word ^= flips;
+
+        len -= span;
+        pos += span;
+        if (pos == _capacity) {
+            pos = 0;
+        }
+    }
+    return changed;
+}
+
+//! \returns the number of consecutive bytes, starting at window position `pos` and wrapping around
+//! the end of the window, whose presence is `present` (at most `max_len`)
+size_t StreamReassembler::run_length(const size_t pos, const size_t max_len, const bool present) const {
+    size_t run = 0;
+    size_t cur = pos;
+    while (run < max_len) {
+        const size_t bit = cur % 64;
+        const uint64_t word = present ? _present[cur / 64] : ~_present[cur / 64];
+        const uint64_t other = ~(word >> bit);  // the bits shifted in from the top end the run
+        size_t span = other == 0 ? 64 : min<size_t>(__builtin_ctzll(other), 64 - bit);
+        span = min(span, _capacity - cur);  // bits past the end of the window aren't part of it
+
+        run += span;
+        cur += span;
+        if (cur == _capacity) {
+            cur = 0;  // the run continues from the start of the window
+        } else if (span < 64 - bit) {
+            break;
+        }
+    }
+    return min(run, max_len);
+}
+
 size_t StreamReassembler::unassembled_bytes() const { return _unassembled_bytes; }
 
 bool StreamReassembler::empty() const { return _unassembled_bytes == 0; }
+
+vector<StreamReassembler::Range> StreamReassembler::unassembled_ranges(const size_t max_ranges) const {
+    vector<Range> ret;
+    if (_engine == Engine::Map) {
+        for (const auto &[index, data] : _unassemble_buffer) {
+            if (not ret.empty() and ret.back().end == index) {
+                ret.back().end += data.size();
+            } else if (ret.size() < max_ranges) {
+                ret.push_back({index, index + data.size()});
+            } else {
+                break;
+            }
+        }
+        return ret;
+    }
+
+    // Engine::Ring: alternate between holes and runs of present bytes until every unassembled byte is found
+    const size_t window = _capacity - _output.buffer_size();
+    size_t offset = 0;
+    size_t found = 0;
+    while (found < _unassembled_bytes and ret.size() < max_ranges) {
+        offset += run_length((_next_pos + offset) % _capacity, window - offset, false);
+        const size_t len = run_length((_next_pos + offset) % _capacity, window - offset, true);
+        ret.push_back({_next_pos + offset, _next_pos + offset + len});
+        offset += len;
+        found += len;
+    }
+    return ret;
+}
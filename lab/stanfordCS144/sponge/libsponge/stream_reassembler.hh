@@ -6,14 +6,29 @@
 #include <cstdint>
 #include <map>
 #include <string>
+#include <vector>
 
 //! \brief A class that assembles a series of excerpts from a byte stream (possibly out of order,
 //! possibly overlapping) into an in-order byte stream.
 class StreamReassembler {
+  public:
+    //! How out-of-order bytes are stored until they can be reassembled
+    enum class Engine {
+        Map,  //!< a std::map of non-overlapping substrings, keyed by index
+        Ring  //!< a capacity-sized ring of bytes plus an occupancy bitmap
+    };
+
+    //! A run of received bytes, `[begin, end)` in stream indices
+    struct Range {
+        uint64_t begin;  //!< index of the first byte
+        uint64_t end;    //!< index one past the last byte
+    };
+
   private:
     // Your code here -- add private members as necessary.
     ByteStream _output;  //!< The reassembled in-order byte stream
     size_t _capacity;    //!< The maximum number of bytes
+    Engine _engine;      //!< Which of the storage schemes below is in use
 
     std::map<size_t, std::string> _unassemble_buffer;
     size_t _next_pos;           // first unassembled index
@@ -21,14 +36,33 @@ class StreamReassembler {
     size_t _eof_index{0};
     bool _eof_appear_sign{false};
 
+    //! \name Engine::Ring storage
+    //! Byte `i` of the stream lives at `_window[i % _capacity]`, and its bit in `_present`
+    //! is set once it has been received but not yet written to the output.
+    //!@{
+    std::string _window{};
+    std::vector<uint64_t> _present{};
+    //!@}
+
     void insert_pair(const std::string &data, const size_t index);
     void write_output();
+    void update_eof(const size_t end_index, const bool eof);
+
+    //! \name Engine::Ring helpers
+    //!@{
+    void push_window(const char *data, const size_t len, const size_t index);
+    void flush_window();
+    size_t set_present(size_t pos, size_t len, const bool present);
+    size_t run_length(const size_t pos, const size_t max_len, const bool present) const;
+    //!@}
 
   public:
     //! \brief Construct a `StreamReassembler` that will store up to `capacity` bytes.
     //! \note This capacity limits both the bytes that have been reassembled,
     //! and those that have not yet been reassembled.
-    StreamReassembler(const size_t capacity);
+    StreamReassembler(const size_t capacity,
+                      const ByteStream::Backend backend = ByteStream::Backend::List,
+                      const Engine engine = Engine::Map);
 
     //! \brief Receive a substring and write any newly contiguous bytes into the stream.
     //!
@@ -40,6 +74,10 @@ class StreamReassembler {
     //! \param eof the last byte of `data` will be the last byte in the entire stream
     void push_substring(const std::string &data, const uint64_t index, const bool eof);
 
+    //! \brief Receive a substring held in a Buffer (e.g. a segment's payload).
+    //! \details Same as the std::string version, but in-order data can reach the stream without a copy.
+    void push_substring(const Buffer &data, const uint64_t index, const bool eof);
+
     //! \name Access the reassembled byte stream
     //!@{
     const ByteStream &stream_out() const { return _output; }
@@ -55,6 +93,14 @@ class StreamReassembler {
     //! \brief Is the internal state empty (other than the output stream)?
     //! \returns `true` if no substrings are waiting to be assembled
     bool empty() const;
+
+    //! \brief The received-but-unassembled bytes, as maximal runs in increasing index order
+    //! \details These all lie beyond the first unassembled index, so each run is preceded by a hole.
+    //! \param[in] max_ranges is the most runs to report (the lowest-indexed ones are kept)
+    std::vector<Range> unassembled_ranges(const size_t max_ranges) const;
+
+    //! The storage engine chosen at construction
+    Engine engine() const { return _engine; }
 };
 
 #endif  // SPONGE_LIBSPONGE_STREAM_REASSEMBLER_HH
@@ -1,6 +1,8 @@
 #include "tcp_connection.hh"
 
+#include <algorithm>
 #include <iostream>
+#include <limits>
 
 // Dummy implementation of a TCP connection
 
@@ -12,6 +14,13 @@ void DUMMY_CODE(Targs &&... /* unused */) {}
 
 using namespace std;
 
+TCPConnection::TCPConnection(const TCPConfig &cfg) : _cfg{cfg} {
+    if (_cfg.adaptive_rto) {
+        _sender.adapt_rto(_cfg.rto_min, _cfg.rto_max);
+    }
+    _sender.set_nagle(_cfg.nagle);
+}
+
 void TCPConnection::send_rst_segment() {
     _sender.send_empty_segment();
     TCPSegment rst_segment = _sender.segments_out().front();
@@ -22,10 +31,24 @@ void TCPConnection::send_rst_segment() {
         rst_segment.header().ackno = ackno.value();
         rst_segment.header().ack = true;
     }
-    rst_segment.header().win = static_cast<uint16_t>(_receiver.window_size());
+    rst_segment.header().win = advertised_window(false);
     _segments_out.push(rst_segment);
 }
 
+uint8_t TCPConnection::window_scale_for(const size_t capacity) {
+    uint8_t shift = 0;
+    while (shift < TCPHeader::MAX_WINDOW_SCALE and (capacity >> shift) > numeric_limits<uint16_t>::max()) {
+        shift++;
+    }
+    return shift;
+}
+
+//! \param[in] syn whether the segment is a SYN (the window in a SYN is never scaled)
+uint16_t TCPConnection::advertised_window(const bool syn) const {
+    const size_t window = _receiver.window_size() >> (_wscale_ok and not syn ? _rcv_wscale : 0);
+    return static_cast<uint16_t>(min(window, static_cast<size_t>(numeric_limits<uint16_t>::max())));
+}
+
 size_t TCPConnection::remaining_outbound_capacity() const { return _sender.stream_in().remaining_capacity(); }
 
 size_t TCPConnection::bytes_in_flight() const { return _sender.bytes_in_flight(); }
@@ -47,16 +70,57 @@ bool TCPConnection::send_segments() {
             segment.header().ackno = ackno.value();
             segment.header().ack = true;
         }
-        size_t window_size = _receiver.window_size();
-        if (window_size > std::numeric_limits<uint16_t>::max()) {
-            window_size = std::numeric_limits<uint16_t>::max();
+        auto &header = segment.header();
+        header.win = advertised_window(header.syn);
+
+        // announce our MSS and offer window scaling and SACK on our SYN (on a SYN/ACK, only if the
+        // peer offered them too), and report out-of-order data once SACK is negotiated
+        if (header.syn) {
+            header.mss = static_cast<uint16_t>(min(_cfg.mss, static_cast<size_t>(numeric_limits<uint16_t>::max())));
         }
-        segment.header().win = static_cast<uint16_t>(window_size);
+        if (header.syn and _cfg.window_scaling and (not ackno.has_value() or _wscale_ok)) {
+            header.wscale = _rcv_wscale;
+        }
+        header.sack_permitted = header.syn and _cfg.sack and (not ackno.has_value() or _sack_permitted);
+        if (_sack_permitted) {
+            header.sack = _receiver.sack_blocks(TCPHeader::MAX_SACK_BLOCKS);
+        }
+        if (_ts_ok or (header.syn and _cfg.timestamps and not ackno.has_value())) {
+            header.timestamps = {static_cast<uint32_t>(_sender.time_ms()), _ts_recent.value_or(0)};
+        }
+        // the options come out of the MSS: a full segment has no room left for SACK blocks
+        while (not header.sack.empty() and
+               header.options_length() + segment.payload().size() > _sender.max_segment_size()) {
+            header.sack.pop_back();
+        }
+        if (ackno.has_value()) {
+            _last_ack_sent = ackno;
+        }
+        header.doff = (TCPHeader::LENGTH + header.options_length()) / 4;
         _segments_out.push(segment);
+        if (ackno.has_value()) {
+            _segments_unacked = 0;  // any segment carries the ACK that was owed
+            _ack_delay_ms.reset();
+        }
     }
     return is_send;
 }
 
+//! \param[in] ack_now whether the ACK must not be delayed
+void TCPConnection::acknowledge(const bool ack_now) {
+    _sender.fill_window();
+    if (send_segments()) {
+        return;  // data went out, carrying the ACK
+    }
+    _segments_unacked++;
+    if (_cfg.delayed_ack and not ack_now and _segments_unacked < 2) {
+        _ack_delay_ms = _ack_delay_ms.value_or(0);
+        return;
+    }
+    _sender.send_empty_segment();
+    send_segments();
+}
+
 void TCPConnection::segment_received(const TCPSegment &segment) {
     _time_since_last_segment_received = 0;
     // Step1: if RST is set,
@@ -68,29 +132,73 @@ void TCPConnection::segment_received(const TCPSegment &segment) {
     }
 
     // Step2: send the segment to TCPReceiver
+    // (the peer's SYN tells how large a segment it takes, whether it scales its window,
+    // and whether it can send and use SACK blocks)
+    if (segment.header().syn and not _receiver.ackno().has_value()) {
+        if (segment.header().mss.has_value()) {
+            _sender.limit_mss(segment.header().mss.value());
+        }
+        _wscale_ok = _cfg.window_scaling and segment.header().wscale.has_value();
+        _snd_wscale = _wscale_ok ? segment.header().wscale.value() : 0;
+        _sack_permitted = _cfg.sack and segment.header().sack_permitted;
+        _ts_ok = _cfg.timestamps and segment.header().timestamps.has_value();
+        _sender.set_options_length(_ts_ok ? TCPHeader::TIMESTAMPS_LENGTH : 0);
+    }
+
+    // PAWS (RFC 7323, section 5): a segment stamped earlier than the latest one is an old duplicate,
+    // perhaps from before the sequence numbers wrapped. It is dropped, but acknowledged.
+    const auto &timestamps = segment.header().timestamps;
+    if (_ts_ok and timestamps.has_value() and _ts_recent.has_value() and
+        static_cast<int32_t>(timestamps->first - _ts_recent.value()) < 0) {
+        if (segment.length_in_sequence_space() > 0) {
+            _sender.send_empty_segment();
+            send_segments();
+        }
+        return;
+    }
+    // the timestamp to echo is that of the earliest segment the next ACK covers (RFC 7323, section 4.3)
+    if (_ts_ok and timestamps.has_value() and
+        (not _last_ack_sent.has_value() or segment.header().seqno - _last_ack_sent.value() <= 0)) {
+        _ts_recent = timestamps->first;
+    }
+    // data that arrives out of order, repeats data already received, or fills a hole is acknowledged
+    // at once, so the peer learns of a loss (or its repair) without delay
+    const auto ackno_before = _receiver.ackno();
+    const bool in_order = ackno_before.has_value() and segment.header().seqno == ackno_before.value() and
+                          _receiver.unassembled_bytes() == 0;
     _receiver.segment_received(segment);
 
     // Step3: if ack is set, tell TCPSender ackno and window_size
     // size_t current_segment_out_length = _sender.segments_out().size();
+    bool sent = false;
     if (segment.header().ack) {
-        _sender.ack_received(segment.header().ackno, segment.header().win);
-        send_segments();
+        static const vector<pair<WrappingInt32, WrappingInt32>> no_sack{};
+        const size_t window = static_cast<size_t>(segment.header().win)
+                              << (segment.header().syn ? 0 : _snd_wscale);  // the window in a SYN is never scaled
+        const auto ts_echo = _ts_ok and timestamps.has_value() ? optional(timestamps->second) : nullopt;
+        _sender.ack_received(segment.header().ackno,
+                             window,
+                             _sack_permitted ? segment.header().sack : no_sack,
+                             segment.length_in_sequence_space() > 0,
+                             ts_echo);
+        sent = send_segments();
     }
 
     // Step4: if the incoming segment occupied any seqno, we need to send at least one segment
-    if (segment.length_in_sequence_space() > 0) {
-        _sender.fill_window();
-        bool is_send = send_segments();
-        if (!is_send) {
-            _sender.send_empty_segment();
-            send_segments();
-        }
+    // (an ACK for in-order data may be delayed, if so configured, and is not owed if data just went out)
+    if (segment.length_in_sequence_space() > 0 and not (_cfg.delayed_ack and sent)) {
+        acknowledge(not in_order or segment.header().syn or segment.header().fin or
+                    _receiver.unassembled_bytes() > 0);
     }
     test_end();
 }
 
 bool TCPConnection::active() const { return _active; }
 
+bool TCPConnection::established() const {
+    return _receiver.ackno().has_value() and _sender.next_seqno_absolute() > _sender.bytes_in_flight();
+}
+
 size_t TCPConnection::write(const string &data) {
     if (!data.size())
         return 0;
@@ -100,14 +208,24 @@ size_t TCPConnection::write(const string &data) {
     return sz;
 }
 
+size_t TCPConnection::write(string &&data) {
+    if (!data.size())
+        return 0;
+    size_t sz = _sender.stream_in().write(std::move(data));
+    _sender.fill_window();
+    send_segments();
+    return sz;
+}
+
 //! \param[in] ms_since_last_tick number of milliseconds since the last call to this method
 void TCPConnection::tick(const size_t ms_since_last_tick) {
     // tell the TCPSender about the passage of time
     _time_since_last_segment_received += ms_since_last_tick;
     _sender.tick(ms_since_last_tick);
 
-    // abort the connection if try too many times
-    if (_sender.consecutive_retransmissions() > TCPConfig::MAX_RETX_ATTEMPTS) {
+    // abort the connection if try too many times (or the peer stopped answering zero-window probes)
+    if (_sender.consecutive_retransmissions() > TCPConfig::MAX_RETX_ATTEMPTS or
+        _sender.unanswered_probes() > TCPConfig::MAX_RETX_ATTEMPTS) {
         passive_close();
         send_rst_segment();
         return;
@@ -115,16 +233,56 @@ void TCPConnection::tick(const size_t ms_since_last_tick) {
 
     send_segments();
 
+    // send a delayed ACK that has waited long enough
+    if (_ack_delay_ms.has_value()) {
+        _ack_delay_ms = _ack_delay_ms.value() + ms_since_last_tick;
+        if (_ack_delay_ms.value() >= _cfg.delayed_ack_timeout) {
+            _sender.send_empty_segment();
+            send_segments();
+        }
+    }
+
     // end the connection cleanly
     test_end();
 }
 
+optional<size_t> TCPConnection::next_tick() const {
+    if (not active()) {
+        return {};
+    }
+    optional<size_t> next = _sender.next_timeout();
+    const auto sooner = [&next](const size_t ms) { next = min(next.value_or(ms), ms); };
+    if (_ack_delay_ms.has_value()) {
+        sooner(_ack_delay_ms.value() < _cfg.delayed_ack_timeout ? _cfg.delayed_ack_timeout - _ack_delay_ms.value() : 0);
+    }
+    // (see test_end())
+    if (_linger_after_streams_finish and check_inbound_ended() and check_outbound_ended()) {
+        const size_t linger_ms = 10 * _cfg.rt_timeout;
+        sooner(_time_since_last_segment_received < linger_ms ? linger_ms - _time_since_last_segment_received : 0);
+    }
+    return next;
+}
+
 void TCPConnection::end_input_stream() {
     _sender.stream_in().end_input();
     _sender.fill_window();
     send_segments();
 }
 
+void TCPConnection::cork() { _sender.cork(); }
+
+void TCPConnection::uncork() {
+    _sender.uncork();
+    send_segments();
+}
+
+void TCPConnection::abort() {
+    if (active()) {
+        passive_close();
+        send_rst_segment();
+    }
+}
+
 void TCPConnection::connect() {
     // don't need to send syn twice
     if (_sender.next_seqno_absolute() != 0)
@@ -149,14 +307,14 @@ TCPConnection::~TCPConnection() {
 }
 
 // prereqs#1 : The inbound stream has been fully assembled and has ended.
-bool TCPConnection::check_inbound_ended() {
+bool TCPConnection::check_inbound_ended() const {
     return _receiver.unassembled_bytes() == 0 && _receiver.stream_out().input_ended();
 }
 
 // prereqs2 : The outbound stream has been ended by the local application and fully sent (including
 // the fact that it ended, i.e. a segment with fin ) to the remote peer.
 // prereqs3 : The outbound stream has been fully acknowledged by the remote peer.
-bool TCPConnection::check_outbound_ended() {
+bool TCPConnection::check_outbound_ended() const {
     return _sender.stream_in().eof() && _sender.next_seqno_absolute() == _sender.stream_in().bytes_written() + 2 &&
            _sender.bytes_in_flight() == 0;
 }
@@ -10,8 +10,9 @@
 class TCPConnection {
   private:
     TCPConfig _cfg;
-    TCPReceiver _receiver{_cfg.recv_capacity};
-    TCPSender _sender{_cfg.send_capacity, _cfg.rt_timeout, _cfg.fixed_isn};
+    TCPReceiver _receiver{_cfg.recv_capacity, _cfg.stream_backend, _cfg.reassembler_engine};
+    TCPSender _sender{
+        _cfg.send_capacity, _cfg.rt_timeout, _cfg.fixed_isn, _cfg.stream_backend, _cfg.mss, _cfg.congestion_control};
 
     //! outbound queue of segments that the TCPConnection wants sent
     std::queue<TCPSegment> _segments_out{};
@@ -23,10 +24,43 @@ class TCPConnection {
     size_t _time_since_last_segment_received{0};
     bool _active{true};
 
+    //! Did both ends offer SACK in their SYNs?
+    bool _sack_permitted{false};
+
+    //! \name Window scaling
+    //! The shifts only take effect once both ends have offered the option in their SYNs
+    //!@{
+    uint8_t _rcv_wscale{window_scale_for(_cfg.recv_capacity)};  //!< shift we apply to our advertised window
+    uint8_t _snd_wscale{0};                                     //!< shift the peer applies to its window
+    bool _wscale_ok{false};                                     //!< was the option negotiated?
+    //!@}
+
+    //! \name Timestamps ([RFC 7323](\ref rfc::rfc7323))
+    //!@{
+    bool _ts_ok{false};                             //!< did both ends offer timestamps in their SYNs?
+    std::optional<uint32_t> _ts_recent{};           //!< the peer's timestamp to echo (TS.Recent)
+    std::optional<WrappingInt32> _last_ack_sent{};  //!< ackno of the latest segment sent (Last.ACK.sent)
+    //!@}
+
+    //! \name Delayed acknowledgments (when `_cfg.delayed_ack` is set)
+    //!@{
+    size_t _segments_unacked{0};            //!< segments received since an ACK was last sent
+    std::optional<size_t> _ack_delay_ms{};  //!< time since the oldest of them arrived (empty: no ACK owed)
+    //!@}
+
+    //! Acknowledge a segment that occupied sequence numbers, now or (if it may wait) later
+    void acknowledge(const bool ack_now);
+
+    //! Smallest shift that lets a window of `capacity` bytes fit in the 16-bit window field
+    static uint8_t window_scale_for(const size_t capacity);
+
+    //! The window field for an outgoing segment
+    uint16_t advertised_window(const bool syn) const;
+
     bool send_segments();
     void send_rst_segment();
-    bool check_inbound_ended();
-    bool check_outbound_ended();
+    bool check_inbound_ended() const;
+    bool check_outbound_ended() const;
     inline void passive_close();
     void test_end();
 
@@ -41,11 +75,26 @@ class TCPConnection {
     //! \returns the number of bytes from `data` that were actually written.
     size_t write(const std::string &data);
 
+    //! \brief Write data to the outbound byte stream, handing ownership of `data` to the stream if it fits
+    //! \returns the number of bytes from `data` that were actually written.
+    size_t write(std::string &&data);
+
     //! \returns the number of `bytes` that can be written right now.
     size_t remaining_outbound_capacity() const;
 
     //! \brief Shut down the outbound byte stream (still allows reading incoming data)
     void end_input_stream();
+
+    //! \brief Hold back data that does not fill a segment, so that following writes join it
+    //! \details Like Linux's TCP_CORK: held data goes out once uncorked, once it fills a segment, when
+    //! the stream ends, or after TCPSender::CORK_TIMEOUT_MS.
+    void cork();
+
+    //! \brief Stop holding back data, and send what was held
+    void uncork();
+
+    //! \brief End the connection at once: both streams end in error, and a RST tells the peer
+    void abort();
     //!@}
 
     //! \name "Output" interface for the reader
@@ -64,6 +113,16 @@ class TCPConnection {
     size_t unassembled_bytes() const;
     //! \brief Number of milliseconds since the last segment was received
     size_t time_since_last_segment_received() const;
+    //! \brief Smoothed round-trip time in milliseconds (empty until a round trip has been measured)
+    std::optional<unsigned int> srtt() const { return _sender.srtt(); }
+    //! \brief Current retransmission timeout in milliseconds
+    unsigned int rto() const { return _sender.rto(); }
+    //! \brief Latest delivery rate sample in bytes per second (empty until data has been acknowledged)
+    std::optional<uint64_t> delivery_rate() const { return _sender.delivery_rate(); }
+    //! \brief Smallest round-trip time measured, in milliseconds
+    std::optional<uint64_t> min_rtt() const { return _sender.min_rtt(); }
+    //! \brief Rate at which to release segments, in bytes per second (0: no limit; see TCPSender::pacing_rate())
+    uint64_t pacing_rate() const { return _sender.pacing_rate(); }
     //!< \brief summarize the state of the sender, receiver, and the connection
     TCPState state() const { return {_sender, _receiver, active(), _linger_after_streams_finish}; };
     //!@}
@@ -77,12 +136,22 @@ class TCPConnection {
     //! Called periodically when time elapses
     void tick(const size_t ms_since_last_tick);
 
+    //! \brief Milliseconds until tick() next has something to do, if nothing else happens first
+    //! \details Empty when only a segment or a call from the owner can make progress (or the connection is
+    //! done). An owner of many connections can then tick each one just when it is due, instead of every
+    //! connection periodically; the clock must still be brought up to date (with tick()) before any other
+    //! call, as round-trip times and timestamps are read from it.
+    std::optional<size_t> next_tick() const;
+
     //! \brief TCPSegments that the TCPConnection has enqueued for transmission.
     //! \note The owner or operating system will dequeue these and
     //! put each one into the payload of a lower-layer datagram (usually Internet datagrams (IP),
     //! but could also be user datagrams (UDP) or any other kind).
     std::queue<TCPSegment> &segments_out() { return _segments_out; }
 
+    //! \brief Has the three-way handshake completed (both SYNs received, ours acknowledged)?
+    bool established() const;
+
     //! \brief Is the connection still alive in any way?
     //! \returns `true` if either stream is still running or if the TCPConnection is lingering
     //! after both streams have finished (e.g. to ACK retransmissions from the peer)
@@ -90,7 +159,7 @@ class TCPConnection {
     //!@}
 
     //! Construct a new connection from a configuration
-    explicit TCPConnection(const TCPConfig &cfg) : _cfg{cfg} {}
+    explicit TCPConnection(const TCPConfig &cfg);
 
     //! \name construction and destruction
     //! moving is allowed; copying is disallowed; default construction not possible
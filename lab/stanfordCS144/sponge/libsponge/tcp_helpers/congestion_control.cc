@@ -0,0 +1,338 @@
+#include "congestion_control.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace std;
+
+namespace {
+
+//! No congestion control: the receiver's window is the only limit
+class NoCongestionControl : public CongestionControl {
+  public:
+    string name() const override { return "none"; }
+    size_t cwnd() const override { return numeric_limits<size_t>::max(); }
+    bool in_recovery() const override { return false; }
+    void on_ack(const AckSample &) override {}
+    void on_loss(const uint64_t, const size_t, const uint64_t) override {}
+    void on_rto(const uint64_t, const size_t) override {}
+    void set_mss(const size_t) override {}
+};
+
+//! Initial window ([RFC 5681](\ref rfc::rfc5681), section 3.1)
+size_t initial_window(const size_t mss) { return min(4 * mss, max<size_t>(2 * mss, 4380)); }
+
+}  // namespace
+
+unique_ptr<CongestionControl> CongestionControl::make(const Algorithm algorithm, const size_t mss) {
+    switch (algorithm) {
+        case Algorithm::Reno:
+            return make_unique<RenoCongestionControl>(mss, false);
+        case Algorithm::NewReno:
+            return make_unique<RenoCongestionControl>(mss, true);
+        case Algorithm::Cubic:
+            return make_unique<CubicCongestionControl>(mss);
+        case Algorithm::Bbr:
+            return make_unique<BbrCongestionControl>(mss);
+        case Algorithm::None:
+            break;
+    }
+    return make_unique<NoCongestionControl>();
+}
+
+optional<CongestionControl::Algorithm> CongestionControl::parse(const string &name) {
+    for (const auto algorithm :
+         {Algorithm::None, Algorithm::Reno, Algorithm::NewReno, Algorithm::Cubic, Algorithm::Bbr}) {
+        if (make(algorithm, 1)->name() == name) {
+            return algorithm;
+        }
+    }
+    return {};
+}
+
+RenoCongestionControl::RenoCongestionControl(const size_t mss, const bool new_reno)
+    : _new_reno(new_reno), _mss(mss), _cwnd(initial_window(mss)), _ssthresh(numeric_limits<size_t>::max()) {}
+
+void RenoCongestionControl::on_ack(const AckSample &ack) {
+    if (_in_recovery) {
+        if (_new_reno and ack.ackno < _recovery_point) {
+            // partial ACK: deflate by the amount acknowledged, but let one more segment out (RFC 6582, 3.2)
+            _cwnd = max(_cwnd > ack.bytes_acked ? _cwnd - ack.bytes_acked + _mss : _mss, _mss);
+            return;
+        }
+        // the loss is repaired: deflate the window inflated by duplicate ACKs
+        _in_recovery = false;
+        _cwnd = _ssthresh;
+        return;
+    }
+
+    if (_cwnd < _ssthresh) {
+        // slow start: one segment per acknowledged segment
+        _cwnd += min(ack.bytes_acked, _mss);
+        return;
+    }
+
+    // congestion avoidance: one segment per window acknowledged
+    _acked_in_avoidance += ack.bytes_acked;
+    if (_acked_in_avoidance >= _cwnd) {
+        _acked_in_avoidance -= _cwnd;
+        _cwnd += _mss;
+    }
+}
+
+void RenoCongestionControl::on_dupack(const uint64_t, const size_t) {
+    // each duplicate ACK means a segment left the network
+    if (_in_recovery) {
+        _cwnd += _mss;
+    }
+}
+
+void RenoCongestionControl::on_loss(const uint64_t, const size_t bytes_in_flight, const uint64_t recovery_point) {
+    if (_in_recovery) {
+        return;  // one reduction per loss event
+    }
+    _ssthresh = max(bytes_in_flight / 2, 2 * _mss);
+    _cwnd = _ssthresh + 3 * _mss;  // the three segments that produced the duplicate ACKs have left
+    _acked_in_avoidance = 0;
+    _in_recovery = true;
+    _recovery_point = recovery_point;
+}
+
+void RenoCongestionControl::on_rto(const uint64_t, const size_t bytes_in_flight) {
+    _ssthresh = max(bytes_in_flight / 2, 2 * _mss);
+    _cwnd = _mss;
+    _acked_in_avoidance = 0;
+    _in_recovery = false;
+}
+
+CubicCongestionControl::CubicCongestionControl(const size_t mss)
+    : _mss(mss), _cwnd(initial_window(mss)), _ssthresh(numeric_limits<double>::max()) {}
+
+void CubicCongestionControl::reduce(const size_t bytes_in_flight) {
+    const double window = min(_cwnd, static_cast<double>(bytes_in_flight));
+    // fast convergence: a flow whose window keeps shrinking releases bandwidth sooner
+    _w_max = window < _w_max ? window * (1 + BETA) / 2 : window;
+    _ssthresh = max(window * BETA, 2.0 * _mss);
+    _cwnd = _ssthresh;
+    _epoch_ms.reset();
+}
+
+void CubicCongestionControl::on_ack(const AckSample &ack) {
+    if (ack.rtt_ms.has_value() and (_min_rtt_ms == 0 or ack.rtt_ms.value() < _min_rtt_ms)) {
+        _min_rtt_ms = ack.rtt_ms.value();
+    }
+
+    if (_in_recovery) {
+        if (ack.ackno < _recovery_point) {
+            return;  // the window stays put until the loss is repaired
+        }
+        _in_recovery = false;
+    }
+
+    const double acked = static_cast<double>(ack.bytes_acked);
+    if (_cwnd < _ssthresh) {
+        _cwnd += min(acked, static_cast<double>(_mss));
+        return;
+    }
+
+    const double mss = static_cast<double>(_mss);
+    if (not _epoch_ms.has_value()) {
+        _epoch_ms = ack.now_ms;
+        if (_cwnd < _w_max) {
+            _k = cbrt((_w_max - _cwnd) / mss / C);
+        } else {
+            _k = 0;
+            _w_max = _cwnd;
+        }
+        _w_est = _cwnd;
+    }
+
+    // where the cubic function says the window should be one RTT from now (capped at 1.5 * cwnd)
+    const double t = static_cast<double>(ack.now_ms - _epoch_ms.value() + _min_rtt_ms) / 1000.0;
+    const double w_cubic = (C * pow(t - _k, 3) + _w_max / mss) * mss;
+    const double target = clamp(w_cubic, _cwnd, 1.5 * _cwnd);
+
+    // where Reno would be
+    _w_est += mss * (3 * (1 - BETA) / (1 + BETA)) * acked / _cwnd;
+
+    if (w_cubic < _w_est) {
+        _cwnd = max(_cwnd, _w_est);
+    } else {
+        _cwnd += (target - _cwnd) * acked / _cwnd;
+    }
+}
+
+void CubicCongestionControl::on_loss(const uint64_t, const size_t bytes_in_flight, const uint64_t recovery_point) {
+    if (_in_recovery) {
+        return;  // one reduction per loss event
+    }
+    reduce(bytes_in_flight);
+    _in_recovery = true;
+    _recovery_point = recovery_point;
+}
+
+void CubicCongestionControl::on_rto(const uint64_t, const size_t bytes_in_flight) {
+    reduce(bytes_in_flight);
+    _cwnd = static_cast<double>(_mss);
+    _in_recovery = false;
+}
+
+BbrCongestionControl::BbrCongestionControl(const size_t mss) : _mss(mss), _cwnd(initial_window(mss)) {}
+
+uint64_t BbrCongestionControl::bandwidth() const { return _bw_samples.empty() ? 0 : _bw_samples.front().second; }
+
+//! \details Zero (no pacing) until the first delivery rate sample: the initial window alone limits sending.
+//! \details Until the pipe is full, the rate does not fall below Startup's gain times the window per
+//! round trip: the first samples (the handshake's, say) carry only a few bytes, and pacing at those would
+//! keep the later samples just as small.
+uint64_t BbrCongestionControl::pacing_rate() const {
+    const auto rate = static_cast<uint64_t>(_pacing_gain * static_cast<double>(bandwidth()));
+    if (rate == 0 or _filled_pipe) {
+        return rate;
+    }
+    const double window_rate =
+        HIGH_GAIN * static_cast<double>(_cwnd) * 1000 / static_cast<double>(max<uint64_t>(_min_rtt_ms.value_or(1), 1));
+    return max(rate, static_cast<uint64_t>(window_rate));
+}
+
+size_t BbrCongestionControl::target_cwnd(const double gain) const {
+    const size_t floor = MIN_CWND_SEGMENTS * _mss;
+    if (bandwidth() == 0 or not _min_rtt_ms.has_value()) {
+        return floor;
+    }
+    // the clock ticks in milliseconds, so a shorter delay still takes one to observe
+    const double bdp = static_cast<double>(bandwidth()) * static_cast<double>(max<uint64_t>(_min_rtt_ms.value(), 1)) /
+                       1000;
+    return max(static_cast<size_t>(gain * bdp), floor);
+}
+
+void BbrCongestionControl::on_ack(const AckSample &ack) {
+    if (_recovery_point.has_value() and ack.ackno >= _recovery_point.value()) {
+        _recovery_point.reset();
+    }
+    update_model(ack);
+    update_mode(ack);
+    update_cwnd(ack);
+}
+
+void BbrCongestionControl::update_model(const AckSample &ack) {
+    // a round trip ends when data sent after it began is acknowledged
+    _round_start = ack.ackno >= _round_end;
+    if (_round_start) {
+        _round++;
+        _round_end = ack.ackno + ack.bytes_in_flight;
+    }
+
+    // windowed maximum; an app-limited sample only counts if it shows more bandwidth anyway
+    if (ack.delivery_rate.has_value() and (not ack.app_limited or ack.delivery_rate.value() >= bandwidth())) {
+        const uint64_t rate = ack.delivery_rate.value();
+        while (not _bw_samples.empty() and _bw_samples.back().second <= rate) {
+            _bw_samples.pop_back();
+        }
+        _bw_samples.emplace_back(_round, rate);
+    }
+    while (not _bw_samples.empty() and _bw_samples.front().first + BW_WINDOW_ROUNDS <= _round) {
+        _bw_samples.pop_front();
+    }
+
+    _min_rtt_expired = ack.now_ms > _min_rtt_stamp + MIN_RTT_WINDOW_MS;
+    if (ack.rtt_ms.has_value() and
+        (not _min_rtt_ms.has_value() or ack.rtt_ms.value() <= _min_rtt_ms.value() or _min_rtt_expired)) {
+        _min_rtt_ms = ack.rtt_ms;
+        _min_rtt_stamp = ack.now_ms;
+    }
+
+    if (_round_start and not _filled_pipe and not ack.app_limited) {
+        if (bandwidth() >= _full_bw * 5 / 4) {
+            _full_bw = bandwidth();
+            _full_bw_rounds = 0;
+        } else if (++_full_bw_rounds >= 3) {
+            _filled_pipe = true;
+        }
+    }
+}
+
+void BbrCongestionControl::enter_probe_bw(const uint64_t now_ms) {
+    _mode = Mode::ProbeBW;
+    _cwnd_gain = CWND_GAIN;
+    _cycle_index = 0;
+    _cycle_stamp = now_ms;
+    _pacing_gain = PACING_CYCLE[_cycle_index];
+}
+
+void BbrCongestionControl::update_mode(const AckSample &ack) {
+    if (_mode == Mode::Startup and _filled_pipe) {
+        _mode = Mode::Drain;
+        _pacing_gain = 1 / HIGH_GAIN;
+    }
+    if (_mode == Mode::Drain and ack.bytes_in_flight <= target_cwnd(1)) {
+        enter_probe_bw(ack.now_ms);
+    }
+    if (_mode == Mode::ProbeBW and ack.now_ms - _cycle_stamp > _min_rtt_ms.value_or(0)) {
+        // each gain lasts one round trip
+        _cycle_index = (_cycle_index + 1) % PACING_CYCLE.size();
+        _cycle_stamp = ack.now_ms;
+        _pacing_gain = PACING_CYCLE[_cycle_index];
+    }
+
+    if (_mode != Mode::ProbeRTT and _min_rtt_expired) {
+        _mode = Mode::ProbeRTT;
+        _pacing_gain = 1;
+        _cwnd_gain = 1;
+        _prior_cwnd = max(_prior_cwnd, _cwnd);
+        _probe_rtt_done.reset();
+    }
+    if (_mode == Mode::ProbeRTT) {
+        if (not _probe_rtt_done.has_value() and ack.bytes_in_flight <= MIN_CWND_SEGMENTS * _mss) {
+            _probe_rtt_done = ack.now_ms + PROBE_RTT_MS;
+        } else if (_probe_rtt_done.has_value() and ack.now_ms >= _probe_rtt_done.value()) {
+            _min_rtt_stamp = ack.now_ms;
+            _cwnd = max(_cwnd, _prior_cwnd);
+            _prior_cwnd = 0;
+            if (_filled_pipe) {
+                enter_probe_bw(ack.now_ms);
+            } else {
+                _mode = Mode::Startup;
+                _pacing_gain = _cwnd_gain = HIGH_GAIN;
+            }
+        }
+    }
+}
+
+void BbrCongestionControl::update_cwnd(const AckSample &ack) {
+    if (_after_rto) {
+        // pacing spreads the restored window out, so it does not go out as a burst
+        _after_rto = false;
+        _cwnd = max(_cwnd, _prior_cwnd);
+        _prior_cwnd = 0;
+    }
+
+    const size_t target = target_cwnd(_cwnd_gain);
+    if (_filled_pipe) {
+        _cwnd = min(_cwnd + ack.bytes_acked, target);
+    } else if (_cwnd < target or bandwidth() == 0) {
+        _cwnd += ack.bytes_acked;
+    }
+    _cwnd = max(_cwnd, MIN_CWND_SEGMENTS * _mss);
+    if (_mode == Mode::ProbeRTT) {
+        _cwnd = min(_cwnd, MIN_CWND_SEGMENTS * _mss);
+    }
+}
+
+//! \details Loss is not a signal to the model: the delivery rate already reflects what the path carries.
+//! The loss is only repaired, as NewReno would, until the recovery point is acknowledged.
+void BbrCongestionControl::on_loss(const uint64_t, const size_t, const uint64_t recovery_point) {
+    if (not _recovery_point.has_value()) {
+        _recovery_point = recovery_point;
+    }
+}
+
+void BbrCongestionControl::on_rto(const uint64_t, const size_t) {
+    _recovery_point.reset();
+    if (not _after_rto) {
+        _prior_cwnd = max(_prior_cwnd, _cwnd);
+    }
+    _after_rto = true;
+    _cwnd = _mss;
+}
@@ -0,0 +1,256 @@
+#ifndef SPONGE_LIBSPONGE_CONGESTION_CONTROL_HH
+#define SPONGE_LIBSPONGE_CONGESTION_CONTROL_HH
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+
+//! \brief What the TCPSender knows when an acknowledgment advances
+struct AckSample {
+    uint64_t now_ms;                        //!< the sender's clock, in milliseconds
+    uint64_t ackno;                         //!< the new (absolute) ackno
+    size_t bytes_acked;                     //!< sequence numbers newly acknowledged
+    size_t bytes_in_flight;                 //!< sequence numbers still outstanding
+    std::optional<uint64_t> rtt_ms;         //!< round-trip time measured by this acknowledgment, if any
+    std::optional<uint64_t> delivery_rate;  //!< bytes per second delivered over the acknowledged data's flight
+    bool app_limited;                       //!< that data was sent while the application had nothing more to send
+};
+
+//! \brief A congestion control algorithm, consulted by the TCPSender
+//! \details The sender keeps its bytes in flight within cwnd() (as well as the receiver's window), and tells
+//! the algorithm what happens to the data it sent. An algorithm may also ask for paced sending via
+//! pacing_rate(). Sizes are in bytes (sequence space).
+class CongestionControl {
+  public:
+    //! Available algorithms
+    enum class Algorithm {
+        None,     //!< no congestion window: send as much as the receiver's window allows
+        Reno,     //!< [RFC 5681](\ref rfc::rfc5681) slow start, congestion avoidance and fast recovery
+        NewReno,  //!< Reno that stays in fast recovery across partial ACKs ([RFC 6582](\ref rfc::rfc6582))
+        Cubic,    //!< CUBIC window growth ([RFC 9438](\ref rfc::rfc9438))
+        Bbr,      //!< model-based: paces at the measured bottleneck bandwidth, window of about two BDPs
+    };
+
+    //! \brief Create an algorithm for segments of up to `mss` bytes
+    static std::unique_ptr<CongestionControl> make(const Algorithm algorithm, const size_t mss);
+
+    //! \brief Algorithm named `name` ("none", "reno", "newreno", "cubic", "bbr"), if there is one
+    static std::optional<Algorithm> parse(const std::string &name);
+
+    //! \brief Name of the algorithm
+    virtual std::string name() const = 0;
+
+    //! \brief Most bytes the sender may have in flight
+    virtual size_t cwnd() const = 0;
+
+    //! \brief Rate at which to send, in bytes per second, or 0 to send as soon as the window allows
+    virtual uint64_t pacing_rate() const { return 0; }
+
+    //! \brief Is the algorithm still recovering from a loss?
+    //! \details While it is, the sender takes a partial acknowledgment (one short of the recovery point) to
+    //! mean the next segment was lost too, and resends it at once ([RFC 6582](\ref rfc::rfc6582)).
+    virtual bool in_recovery() const = 0;
+
+    //! \name Events
+    //!@{
+
+    //! \brief An acknowledgment advanced the ackno
+    virtual void on_ack(const AckSample &ack) = 0;
+
+    //! \brief A duplicate acknowledgment arrived (same ackno and window, no data, data outstanding)
+    virtual void on_dupack(const uint64_t /* now_ms */, const size_t /* bytes_in_flight */) {}
+
+    //! \brief The sender resent data it presumes lost
+    //! \param[in] now_ms is the sender's clock
+    //! \param[in] bytes_in_flight is the number of outstanding sequence numbers
+    //! \param[in] recovery_point is the (absolute) next seqno: the loss is repaired once it is acknowledged
+    virtual void on_loss(const uint64_t now_ms, const size_t bytes_in_flight, const uint64_t recovery_point) = 0;
+
+    //! \brief The retransmission timer expired
+    virtual void on_rto(const uint64_t now_ms, const size_t bytes_in_flight) = 0;
+    //!@}
+
+    //! \brief The segment size changed (e.g. after the MSS option was received)
+    virtual void set_mss(const size_t mss) = 0;
+
+    CongestionControl() = default;
+    virtual ~CongestionControl() = default;
+
+    //! \name Copy/move constructor/assignment operators
+    //! Algorithms are owned through a unique_ptr and are not copied
+    //!@{
+    CongestionControl(const CongestionControl &other) = delete;
+    CongestionControl &operator=(const CongestionControl &other) = delete;
+    //!@}
+};
+
+//! \brief Reno and NewReno
+class RenoCongestionControl : public CongestionControl {
+  private:
+    bool _new_reno;                 //!< stay in recovery until `_recovery_point` is acknowledged
+    size_t _mss;                    //!< segment size
+    size_t _cwnd;                   //!< congestion window
+    size_t _ssthresh;               //!< slow start threshold
+    size_t _acked_in_avoidance{0};  //!< bytes acknowledged since cwnd last grew in congestion avoidance
+    bool _in_recovery{false};       //!< in fast recovery
+    uint64_t _recovery_point{0};    //!< ackno that ends fast recovery
+
+  public:
+    //! \param[in] mss is the segment size
+    //! \param[in] new_reno selects NewReno's handling of partial acknowledgments
+    RenoCongestionControl(const size_t mss, const bool new_reno);
+
+    std::string name() const override { return _new_reno ? "newreno" : "reno"; }
+    size_t cwnd() const override { return _cwnd; }
+    size_t ssthresh() const { return _ssthresh; }  //!< slow start threshold
+    bool in_recovery() const override { return _in_recovery; }
+
+    void on_ack(const AckSample &ack) override;
+    void on_dupack(const uint64_t now_ms, const size_t bytes_in_flight) override;
+    void on_loss(const uint64_t now_ms, const size_t bytes_in_flight, const uint64_t recovery_point) override;
+    void on_rto(const uint64_t now_ms, const size_t bytes_in_flight) override;
+    void set_mss(const size_t mss) override { _mss = mss; }
+};
+
+//! \brief CUBIC
+//! \details Grows the window as a cubic function of the time since the last loss, so the window returns
+//! quickly to where the loss happened, then probes slowly around it. Falls back to Reno-like growth where
+//! that would be faster (the "Reno-friendly region").
+class CubicCongestionControl : public CongestionControl {
+  private:
+    static constexpr double C = 0.4;     //!< cubic scaling constant, in segments per second cubed
+    static constexpr double BETA = 0.7;  //!< multiplicative decrease factor
+
+    size_t _mss;                          //!< segment size
+    double _cwnd;                         //!< congestion window, in bytes
+    double _ssthresh;                     //!< slow start threshold, in bytes
+    double _w_max{0};                     //!< window before the last reduction, in bytes
+    double _w_est{0};                     //!< window a Reno flow would have, in bytes
+    double _k{0};                         //!< seconds from the epoch until the window is back at `_w_max`
+    std::optional<uint64_t> _epoch_ms{};  //!< start of the current congestion avoidance epoch
+    uint64_t _min_rtt_ms{0};              //!< smallest RTT seen (0 while unknown)
+    bool _in_recovery{false};             //!< in fast recovery
+    uint64_t _recovery_point{0};          //!< ackno that ends fast recovery
+
+    //! Shrink the window after a loss, remembering where it was
+    //! \details The window at the time of loss is at most what was in flight: a sender held back by the
+    //! receiver's window does not fill cwnd, and reducing from an unused cwnd would not relieve the path.
+    void reduce(const size_t bytes_in_flight);
+
+  public:
+    //! \param[in] mss is the segment size
+    explicit CubicCongestionControl(const size_t mss);
+
+    std::string name() const override { return "cubic"; }
+    size_t cwnd() const override { return static_cast<size_t>(_cwnd); }
+    size_t ssthresh() const { return static_cast<size_t>(_ssthresh); }  //!< slow start threshold
+    bool in_recovery() const override { return _in_recovery; }
+
+    void on_ack(const AckSample &ack) override;
+    void on_loss(const uint64_t now_ms, const size_t bytes_in_flight, const uint64_t recovery_point) override;
+    void on_rto(const uint64_t now_ms, const size_t bytes_in_flight) override;
+    void set_mss(const size_t mss) override { _mss = mss; }
+};
+
+//! \brief BBR (version 1)
+//! \details Rather than reacting to loss, keeps a model of the path: the bottleneck bandwidth (the
+//! largest delivery rate over the last ten round trips) and the propagation delay (the smallest RTT
+//! over the last ten seconds). It paces at a gain times the bandwidth and keeps about two
+//! bandwidth-delay products in flight, cycling the gain to probe for more bandwidth and briefly
+//! draining the queue to refresh the delay. Loss alone does not shrink the window, so a shallow
+//! buffer that drops a few packets does not collapse throughput.
+class BbrCongestionControl : public CongestionControl {
+  public:
+    //! Phases of the state machine
+    enum class Mode {
+        Startup,   //!< double the sending rate every round trip until the bandwidth stops growing
+        Drain,     //!< drain the queue built during Startup
+        ProbeBW,   //!< cycle the pacing gain around 1
+        ProbeRTT,  //!< hold four segments in flight to measure the delay of an empty queue
+    };
+
+  private:
+    static constexpr double HIGH_GAIN = 2.885;            //!< 2/ln(2): doubles the rate each round in Startup
+    static constexpr double CWND_GAIN = 2;                //!< window, in BDPs, outside Startup and Drain
+    static constexpr uint64_t BW_WINDOW_ROUNDS = 10;      //!< round trips the bandwidth filter remembers
+    static constexpr uint64_t MIN_RTT_WINDOW_MS = 10000;  //!< how long a delay measurement stays valid
+    static constexpr uint64_t PROBE_RTT_MS = 200;         //!< time spent with four segments in flight
+    static constexpr size_t MIN_CWND_SEGMENTS = 4;        //!< smallest window, in segments
+    //! pacing gains of ProbeBW, one phase per min RTT
+    static constexpr std::array<double, 8> PACING_CYCLE{1.25, 0.75, 1, 1, 1, 1, 1, 1};
+
+    size_t _mss;                     //!< segment size
+    size_t _cwnd;                    //!< congestion window
+    Mode _mode{Mode::Startup};       //!< current phase
+    double _pacing_gain{HIGH_GAIN};  //!< multiplier of the bandwidth for the pacing rate
+    double _cwnd_gain{HIGH_GAIN};    //!< multiplier of the BDP for the window
+
+    //! \name Round trips, counted by ACKs passing the seqno that was next when the round began
+    //!@{
+    uint64_t _round{0};        //!< round trips so far
+    uint64_t _round_end{0};    //!< ackno that ends the current round
+    bool _round_start{false};  //!< the latest ACK began a round
+    //!@}
+
+    //! delivery rate samples (round, bytes/s), decreasing in rate, for a windowed maximum
+    std::deque<std::pair<uint64_t, uint64_t>> _bw_samples{};
+    std::optional<uint64_t> _min_rtt_ms{};  //!< propagation delay estimate
+    uint64_t _min_rtt_stamp{0};             //!< when `_min_rtt_ms` was last measured
+    bool _min_rtt_expired{false};           //!< the latest ACK found `_min_rtt_ms` older than its window
+
+    //! \name Detecting a full pipe: the bandwidth grew less than 25% for three rounds
+    //!@{
+    bool _filled_pipe{false};     //!< Startup is over
+    uint64_t _full_bw{0};         //!< bandwidth at the last 25% growth
+    unsigned _full_bw_rounds{0};  //!< rounds since then
+    //!@}
+
+    size_t _cycle_index{0};                     //!< position in PACING_CYCLE
+    uint64_t _cycle_stamp{0};                   //!< when the current ProbeBW phase began
+    std::optional<uint64_t> _probe_rtt_done{};  //!< when ProbeRTT may end, once it has drained
+    size_t _prior_cwnd{0};                      //!< window to restore after ProbeRTT or a timeout
+    bool _after_rto{false};                     //!< the window was cut to one segment by a timeout
+    std::optional<uint64_t> _recovery_point{};  //!< ackno that ends the repair of a loss (if one is under way)
+
+    //! \name Steps of on_ack()
+    //!@{
+    void update_model(const AckSample &ack);
+    void update_mode(const AckSample &ack);
+    void update_cwnd(const AckSample &ack);
+    //!@}
+
+    void enter_probe_bw(const uint64_t now_ms);
+
+    //! Window of `gain` bandwidth-delay products (at least MIN_CWND_SEGMENTS)
+    size_t target_cwnd(const double gain) const;
+
+  public:
+    //! \param[in] mss is the segment size
+    explicit BbrCongestionControl(const size_t mss);
+
+    std::string name() const override { return "bbr"; }
+    size_t cwnd() const override { return _cwnd; }
+    uint64_t pacing_rate() const override;
+    bool in_recovery() const override { return _recovery_point.has_value(); }
+
+    //! \brief Current phase
+    Mode mode() const { return _mode; }
+
+    //! \brief Bottleneck bandwidth estimate, in bytes per second (0 while unknown)
+    uint64_t bandwidth() const;
+
+    //! \brief Propagation delay estimate, in milliseconds
+    std::optional<uint64_t> min_rtt() const { return _min_rtt_ms; }
+
+    void on_ack(const AckSample &ack) override;
+    void on_loss(const uint64_t now_ms, const size_t bytes_in_flight, const uint64_t recovery_point) override;
+    void on_rto(const uint64_t now_ms, const size_t bytes_in_flight) override;
+    void set_mss(const size_t mss) override { _mss = mss; }
+};
+
+#endif  // SPONGE_LIBSPONGE_CONGESTION_CONTROL_HH
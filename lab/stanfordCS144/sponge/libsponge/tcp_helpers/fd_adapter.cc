@@ -7,7 +7,8 @@
 using namespace std;
 
 //! \details This function first attempts to parse a TCP segment from the next UDP
-//! payload recv()d from the socket.
+//! payload recv()d from the socket (or, with an IoEngine, from the next datagram of its
+//! latest batch, receiving a new batch when that one is used up).
 //!
 //! If this succeeds, it then checks that the received segment is related to the
 //! current connection. When a TCP connection has been established, this means
@@ -19,23 +20,43 @@ using namespace std;
 //! the result that future outgoing segments go to the sender of the SYN segment.
 //! \returns a std::optional<TCPSegment> that is empty if the segment was invalid or unrelated
 optional<TCPSegment> TCPOverUDPSocketAdapter::read() {
-    auto datagram = _sock.recv();
+    IoEngine *const engine = io_engine();
+    if (engine == nullptr) {
+        _sock.recv(_datagram);
+        return parse(_datagram.source_address, _datagram.payload);
+    }
+
+    if (_batch_next == _batch_size) {
+        _batch_size = engine->recv(_sock);
+        _batch_next = 0;
+        if (_batch_size == 0) {
+            return {};
+        }
+    }
+    const size_t n = _batch_next++;
+    return parse(engine->source(n), engine->payload(n));
+}
 
+optional<TCPSegment> TCPOverUDPSocketAdapter::parse(const Address &source, const string_view datagram_payload) {
     // is it for us?
-    if (not listening() and (datagram.source_address != config().destination)) {
+    if (not listening() and (source != config().destination)) {
         return {};
     }
 
+    // copy the payload out of the (MTU-sized) receive buffer into a pooled chunk
+    string payload = BufferPool::local().acquire(datagram_payload.size());
+    payload.append(datagram_payload);
+
     // is the payload a valid TCP segment?
     TCPSegment seg;
-    if (ParseResult::NoError != seg.parse(move(datagram.payload), 0)) {
+    if (ParseResult::NoError != seg.parse(move(payload), 0)) {
         return {};
     }
 
     // should we target this source in all future replies?
     if (listening()) {
         if (seg.header().syn and not seg.header().rst) {
-            config_mutable().destination = datagram.source_address;
+            config_mutable().destination = source;
             set_listening(false);
         } else {
             return {};
@@ -45,12 +66,16 @@ optional<TCPSegment> TCPOverUDPSocketAdapter::read() {
     return seg;
 }
 
-//! Serialize a TCP segment and send it as the payload of a UDP datagram.
+//! Serialize a TCP segment and send it as the payload of a UDP datagram (with an IoEngine, on its next flush).
 //! \param[in] seg is the TCP segment to write
 void TCPOverUDPSocketAdapter::write(TCPSegment &seg) {
     seg.header().sport = config().source.port();
     seg.header().dport = config().destination.port();
-    _sock.sendto(config().destination, seg.serialize(0));
+    if (io_engine() != nullptr) {
+        io_engine()->sendto(_sock, config().destination, seg.serialize(0));
+    } else {
+        _sock.sendto(config().destination, seg.serialize(0));
+    }
 }
 
 //! Specialize LossyFdAdapter to TCPOverUDPSocketAdapter
@@ -2,6 +2,8 @@
 #define SPONGE_LIBSPONGE_FD_ADAPTER_HH
 
 #include "file_descriptor.hh"
+#include "io_engine.hh"
+#include "ipv4_header.hh"
 #include "lossy_fd_adapter.hh"
 #include "socket.hh"
 #include "tcp_config.hh"
@@ -9,14 +11,16 @@
 #include "tcp_segment.hh"
 
 #include <optional>
+#include <string_view>
 #include <utility>
 
 //! \brief Basic functionality for file descriptor adaptors
 //! \details See TCPOverUDPSocketAdapter and TCPOverIPv4OverTunFdAdapter for more information.
 class FdAdapterBase {
   private:
-    FdAdapterConfig _cfg{};  //!< Configuration values
-    bool _listen = false;    //!< Is the connected TCP FSM in listen state?
+    FdAdapterConfig _cfg{};          //!< Configuration values
+    bool _listen = false;            //!< Is the connected TCP FSM in listen state?
+    IoEngine *_io_engine = nullptr;  //!< Batches the reads and writes, if set
 
   protected:
     FdAdapterConfig &config_mutable() { return _cfg; }
@@ -40,20 +44,51 @@ class FdAdapterBase {
 
     //! Called periodically when time elapses
     void tick(const size_t) {}
+
+    //! \brief Read and write through `engine` (`nullptr`: make a system call for each datagram)
+    //! \details Adapters that do not batch their datagrams ignore it.
+    void set_io_engine(IoEngine *engine) { _io_engine = engine; }
+
+    //! The engine set by set_io_engine()
+    IoEngine *io_engine() const { return _io_engine; }
+
+    //! Are there datagrams that read() will return without reading the fd again?
+    bool pending_reads() const { return false; }
 };
 
 //! \brief A FD adaptor that reads and writes TCP segments in UDP payloads
 class TCPOverUDPSocketAdapter : public FdAdapterBase {
   private:
     UDPSocket _sock;
+    UDPSocket::received_datagram _datagram{{nullptr, 0}, {}};  //!< reused receive buffer
+    size_t _batch_size = 0;                                    //!< datagrams in the IoEngine's latest batch
+    size_t _batch_next = 0;                                    //!< next of them to return from read()
+
+    //! The TCP segment in a UDP payload, if it is valid and related to the current connection
+    std::optional<TCPSegment> parse(const Address &source, const std::string_view payload);
 
   public:
+    static constexpr size_t UDP_HEADER_LENGTH = 8;  //!< [UDP](\ref rfc::rfc768) header length
+
+    //! \brief The MSS to announce for UDP datagrams of `mtu` bytes
+    //! \details The largest TCP payload that fits behind a header without options; as RFC 6691 has it, the
+    //! options a segment carries come out of this.
+    static size_t max_segment_size(const size_t mtu) {
+        return mtu - IPv4Header::LENGTH - UDP_HEADER_LENGTH - TCPHeader::LENGTH;
+    }
+
+    //! The MSS to announce for datagrams of FdAdapterConfig::mtu bytes
+    size_t max_segment_size() const { return max_segment_size(config().mtu); }
+
     //! Construct from a UDPSocket sliced into a FileDescriptor
     explicit TCPOverUDPSocketAdapter(UDPSocket &&sock) : _sock(std::move(sock)) {}
 
     //! Attempts to read and return a TCP segment related to the current connection from a UDP payload
     std::optional<TCPSegment> read();
 
+    //! Are there datagrams (from the IoEngine's latest batch) that read() will return without reading the socket?
+    bool pending_reads() const { return _batch_next < _batch_size; }
+
     //! Writes a TCP segment into a UDP payload
     void write(TCPSegment &seg);
 
@@ -2,6 +2,7 @@
 #define SPONGE_LIBSPONGE_LOSSY_FD_ADAPTER_HH
 
 #include "file_descriptor.hh"
+#include "io_engine.hh"
 #include "tcp_config.hh"
 #include "tcp_segment.hh"
 #include "util.hh"
@@ -63,6 +64,11 @@ class LossyFdAdapter {
     void set_listening(const bool l) { _adapter.set_listening(l); }      //!< FdAdapterBase::set_listening passthrough
     const FdAdapterConfig &config() const { return _adapter.config(); }  //!< FdAdapterBase::config passthrough
     FdAdapterConfig &config_mut() { return _adapter.config_mut(); }      //!< FdAdapterBase::config_mut passthrough
+    size_t max_segment_size() const { return _adapter.max_segment_size(); }  //!< AdapterT::max_segment_size passthrough
+    void set_io_engine(IoEngine *engine) {
+        _adapter.set_io_engine(engine);
+    }  //!< FdAdapterBase::set_io_engine passthrough
+    bool pending_reads() const { return _adapter.pending_reads(); }          //!< AdapterT::pending_reads passthrough
     void tick(const size_t ms_since_last_tick) {
         _adapter.tick(ms_since_last_tick);
     }  //!< FdAdapterBase::tick passthrough
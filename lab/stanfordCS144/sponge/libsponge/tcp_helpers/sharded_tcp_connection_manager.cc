@@ -0,0 +1,159 @@
+#include "sharded_tcp_connection_manager.hh"
+
+#include "util.hh"
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <utility>
+
+using namespace std;
+
+//! Longest a shard sleeps without checking whether it should stop, in microseconds
+static constexpr uint64_t SHARD_MAX_WAIT_US = 10000;
+
+ShardedTCPConnectionManager::Shard::Shard(const TCPConfig &tcp_config, const FdAdapterConfig &adapter_config)
+    : manager(tcp_config, adapter_config, {}), wakeup(SystemCall("eventfd", ::eventfd(0, EFD_CLOEXEC))) {}
+
+ShardedTCPConnectionManager::ShardedTCPConnectionManager(const size_t shards,
+                                                         const TCPConfig &tcp_config,
+                                                         const FdAdapterConfig &adapter_config,
+                                                         const CallbackFactory &callbacks)
+    : _address(adapter_config.source) {
+    if (shards == 0) {
+        throw runtime_error("ShardedTCPConnectionManager: no shards");
+    }
+
+    // the first shard's socket settles the port (if none was given), and the others bind the same one
+    FdAdapterConfig shard_config = adapter_config;
+    shard_config.reuse_port = true;
+    for (size_t i = 0; i < shards; i++) {
+        _shards.push_back(make_unique<Shard>(tcp_config, shard_config));
+        if (i == 0) {
+            _address = _shards[0]->manager.local_address();
+            shard_config.source = _address;
+        }
+    }
+
+    for (size_t i = 0; i < shards; i++) {
+        Shard &shard = *_shards[i];
+        for (size_t from = 0; from < shards; from++) {
+            shard.handoffs.push_back(from == i ? nullptr : make_unique<SpscQueue<Handoff>>(HANDOFF_CAPACITY));
+        }
+        shard.to_wake.resize(shards);
+        shard.manager.set_callbacks(callbacks(i, shard.manager));
+        shard.manager.set_shard(
+            i, shards, [this, i](const size_t owner, const Address &source, const string_view payload) {
+                hand_off(i, owner, source, payload);
+            });
+        shard.manager.eventloop().add_rule(shard.wakeup, Direction::In, [this, i] { drain(i); });
+    }
+
+    for (size_t i = 0; i < shards; i++) {
+        _shards[i]->thread = thread([this, i] { shard_main(i); });
+    }
+}
+
+ShardedTCPConnectionManager::~ShardedTCPConnectionManager() {
+    try {
+        stop();
+    } catch (const exception &e) {
+        cerr << "Exception stopping ShardedTCPConnectionManager: " << e.what() << "\n";
+    }
+}
+
+void ShardedTCPConnectionManager::shard_main(const size_t index) {
+    Shard &shard = *_shards[index];
+    try {
+        while (not _stopping.load(memory_order_acquire)) {
+            shard.manager.wait_next_event(chrono::microseconds{SHARD_MAX_WAIT_US});
+            wake(index);
+        }
+    } catch (const exception &e) {
+        cerr << "Exception in ShardedTCPConnectionManager shard " << index << ": " << e.what() << "\n";
+        throw;
+    }
+}
+
+//! \details A full queue drops the datagram, as a congested network would; TCP recovers it.
+void ShardedTCPConnectionManager::hand_off(const size_t from,
+                                           const size_t to,
+                                           const Address &source,
+                                           const string_view payload) {
+    Handoff handoff{*reinterpret_cast<const sockaddr_in *>(static_cast<const sockaddr *>(source)), string{payload}};
+    if (_shards[to]->handoffs[from]->push(move(handoff))) {
+        _shards[from]->to_wake[to] = true;
+    }
+}
+
+//! \details The owner is woken after its datagrams are queued, so it cannot miss any: if it is draining
+//! already, it either takes them now or is woken again.
+void ShardedTCPConnectionManager::wake(const size_t index) {
+    vector<bool> &to_wake = _shards[index]->to_wake;
+    for (size_t i = 0; i < to_wake.size(); i++) {
+        if (to_wake[i]) {
+            to_wake[i] = false;
+            signal(i);
+        }
+    }
+}
+
+void ShardedTCPConnectionManager::signal(const size_t index) {
+    const uint64_t one = 1;
+    SystemCall("write", static_cast<int>(::write(_shards[index]->wakeup.fd_num(), &one, sizeof(one))));
+}
+
+void ShardedTCPConnectionManager::drain(const size_t index) {
+    Shard &shard = *_shards[index];
+    shard.wakeup.read(sizeof(uint64_t));  // (resets the eventfd's count)
+
+    Task task{};
+    while (shard.tasks.pop(task)) {
+        task(shard.manager);
+    }
+
+    Handoff handoff{};
+    for (const auto &queue : shard.handoffs) {
+        while (queue and queue->pop(handoff)) {
+            const Address source{reinterpret_cast<const sockaddr *>(&handoff.source), sizeof(handoff.source)};
+            shard.manager.deliver(source, handoff.payload);
+        }
+    }
+}
+
+//! \details Waits (yielding) while the shard's task queue is full.
+void ShardedTCPConnectionManager::post(const size_t shard, Task task) {
+    if (shard >= _shards.size()) {
+        throw runtime_error("ShardedTCPConnectionManager: no shard " + to_string(shard));
+    }
+    while (not _shards[shard]->tasks.push(move(task))) {
+        this_thread::yield();
+    }
+    signal(shard);
+}
+
+void ShardedTCPConnectionManager::set_listening(const bool listening) {
+    for (size_t i = 0; i < _shards.size(); i++) {
+        post(i, [listening](TCPConnectionManager &manager) { manager.set_listening(listening); });
+    }
+}
+
+size_t ShardedTCPConnectionManager::connect(const Address &peer) {
+    const size_t shard = _next_connect;
+    _next_connect = (_next_connect + 1) % _shards.size();
+    post(shard, [peer](TCPConnectionManager &manager) { manager.connect(peer); });
+    return shard;
+}
+
+void ShardedTCPConnectionManager::stop() {
+    _stopping.store(true, memory_order_release);
+    for (size_t i = 0; i < _shards.size(); i++) {
+        if (_shards[i]->thread.joinable()) {
+            signal(i);
+            _shards[i]->thread.join();
+        }
+    }
+}
@@ -0,0 +1,119 @@
+#ifndef SPONGE_LIBSPONGE_SHARDED_TCP_CONNECTION_MANAGER_HH
+#define SPONGE_LIBSPONGE_SHARDED_TCP_CONNECTION_MANAGER_HH
+
+#include "address.hh"
+#include "file_descriptor.hh"
+#include "spsc_queue.hh"
+#include "tcp_config.hh"
+#include "tcp_connection_manager.hh"
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <netinet/in.h>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+//! \brief TCP connections on one UDP address, spread over several threads (one TCPConnectionManager each)
+//! \details Each shard has its own thread, event loop, connection table and UDP socket; the sockets share
+//! the address with SO_REUSEPORT. Each flow is owned by one shard, chosen by a hash of its addresses and
+//! ports (see TCPConnectionManager::set_shard()). The kernel picks a socket by the sender's address alone,
+//! so a datagram that reaches a shard that does not own its flow is handed to the owner through a
+//! lock-free SpscQueue (one for each pair of shards), and the owner is woken through its eventfd, at most
+//! once per pass of the sender's event loop. Shards share nothing else.
+//!
+//! The application runs on the shards' threads, through callbacks made for each shard, and reaches a
+//! shard from its own thread with post().
+class ShardedTCPConnectionManager {
+  public:
+    //! Makes the callbacks of the manager of shard `shard` (so they may refer to `manager`)
+    using CallbackFactory =
+        std::function<TCPConnectionManager::Callbacks(const size_t shard, TCPConnectionManager &manager)>;
+
+    //! Work for a shard, run on its thread with its manager
+    using Task = std::function<void(TCPConnectionManager &manager)>;
+
+  private:
+    static constexpr size_t HANDOFF_CAPACITY = 4096;  //!< datagrams in flight from one shard to another
+    static constexpr size_t TASK_CAPACITY = 1024;     //!< tasks in flight to one shard
+
+    //! A datagram received by a shard for a flow of another
+    struct Handoff {
+        sockaddr_in source{};  //!< its sender (an IPv4 address, as every flow has)
+        std::string payload{};
+    };
+
+    //! One thread's share of the connections
+    struct Shard {
+        TCPConnectionManager manager;                                 //!< its connections and socket
+        FileDescriptor wakeup;                                        //!< eventfd that tasks and handoffs signal
+        SpscQueue<Task> tasks{TASK_CAPACITY};                         //!< from post()
+        std::vector<std::unique_ptr<SpscQueue<Handoff>>> handoffs{};  //!< from each other shard, by index
+        std::vector<bool> to_wake{};                                  //!< shards handed datagrams since the last wake()
+        std::thread thread{};                                         //!< runs the manager
+
+        Shard(const TCPConfig &tcp_config, const FdAdapterConfig &adapter_config);
+    };
+
+    std::vector<std::unique_ptr<Shard>> _shards{};  //!< every shard
+    Address _address;                               //!< the address they share
+    std::atomic<bool> _stopping{false};             //!< have the threads been asked to return?
+    size_t _next_connect{0};                        //!< shard for the next connect()
+
+    //! A shard's thread
+    void shard_main(const size_t index);
+
+    //! On shard `from`'s thread: queue a datagram for shard `to`
+    void hand_off(const size_t from, const size_t to, const Address &source, const std::string_view payload);
+
+    //! On shard `index`'s thread: wake the shards it has handed datagrams to
+    void wake(const size_t index);
+
+    //! On shard `index`'s thread: run its tasks and deliver the datagrams handed to it
+    void drain(const size_t index);
+
+    //! Signal a shard's eventfd
+    void signal(const size_t index);
+
+  public:
+    //! \param[in] shards is the number of shards (and threads)
+    //! \param[in] tcp_config is the configuration of every connection
+    //! \param[in] adapter_config gives the address to share (a port of 0 picks one for all the shards), the
+    //!            MTU, and whether to use an IoEngine in each shard
+    //! \param[in] callbacks makes the callbacks of each shard; it runs on this thread, before the shards start
+    ShardedTCPConnectionManager(const size_t shards,
+                                const TCPConfig &tcp_config,
+                                const FdAdapterConfig &adapter_config,
+                                const CallbackFactory &callbacks);
+
+    //! Stops the shards
+    ~ShardedTCPConnectionManager();
+
+    ShardedTCPConnectionManager(const ShardedTCPConnectionManager &other) = delete;
+    ShardedTCPConnectionManager &operator=(const ShardedTCPConnectionManager &other) = delete;
+
+    //! \brief Run `task` on shard `shard`'s thread, with its manager
+    //! \details Only the thread that created this object may post (each shard's task queue has one producer).
+    void post(const size_t shard, Task task);
+
+    //! \brief Accept connections opened by peers, on every shard
+    void set_listening(const bool listening);
+
+    //! \brief Open a connection to `peer` from the next shard in turn
+    //! \returns the shard, whose callbacks will hear about the connection
+    size_t connect(const Address &peer);
+
+    //! \brief Stop and join the shards' threads (their connections are abandoned)
+    void stop();
+
+    //! \brief Number of shards
+    size_t shards() const { return _shards.size(); }
+
+    //! \brief The address the shards share
+    const Address &local_address() const { return _address; }
+};
+
+#endif  // SPONGE_LIBSPONGE_SHARDED_TCP_CONNECTION_MANAGER_HH
@@ -2,6 +2,9 @@
 #define SPONGE_LIBSPONGE_TCP_CONFIG_HH
 
 #include "address.hh"
+#include "byte_stream.hh"
+#include "congestion_control.hh"
+#include "stream_reassembler.hh"
 #include "wrapping_integers.hh"
 
 #include <cstddef>
@@ -20,6 +23,58 @@ class TCPConfig {
     size_t recv_capacity = DEFAULT_CAPACITY;  //!< Receive capacity, in bytes
     size_t send_capacity = DEFAULT_CAPACITY;  //!< Sender capacity, in bytes
     std::optional<WrappingInt32> fixed_isn{};
+
+    //! \brief Derive the retransmission timeout from measured round-trip times ([RFC 6298](\ref rfc::rfc6298))
+    //! \details Off by default: every (re)started timer then begins at `rt_timeout`.
+    bool adaptive_rto = false;
+    uint16_t rto_min = 200;    //!< Lower bound for an adaptive retransmission timeout, in ms
+    uint32_t rto_max = 60000;  //!< Upper bound for an adaptive retransmission timeout and its backoff, in ms
+
+    //! \brief Largest payload to send or receive in one segment, in bytes
+    //! \details Announced in the SYN with the MSS option; the sender uses the smaller of this and the
+    //! peer's announcement (or this alone if the peer sent none), less the options every segment carries.
+    //! TCPSpongeSocket lowers it to fit the adapter's MTU.
+    size_t mss = MAX_PAYLOAD_SIZE;
+
+    //! Storage engine for the inbound and outbound ByteStreams
+    ByteStream::Backend stream_backend = ByteStream::Backend::List;
+
+    //! Storage engine for out-of-order bytes in the receiver
+    StreamReassembler::Engine reassembler_engine = StreamReassembler::Engine::Map;
+
+    //! Offer (and accept) window scaling ([RFC 7323](\ref rfc::rfc7323)), so windows can exceed 64 KiB
+    bool window_scaling = true;
+
+    //! Offer (and accept) selective acknowledgments ([RFC 2018](\ref rfc::rfc2018)) during the handshake
+    bool sack = true;
+
+    //! \brief Offer (and accept) the timestamps option ([RFC 7323](\ref rfc::rfc7323)) during the handshake
+    //! \details Once negotiated, every ACK yields a round-trip time sample (retransmissions included), and
+    //! segments older than the latest timestamp are rejected (PAWS), guarding against old duplicates
+    //! once the sequence numbers wrap.
+    bool timestamps = true;
+
+    //! \brief Congestion control algorithm for the sender
+    //! \details None by default: the sender is then limited only by the receiver's window.
+    CongestionControl::Algorithm congestion_control = CongestionControl::Algorithm::None;
+
+    //! \brief Release segments to the network at a steady rate rather than in bursts
+    //! \details Used by TCPSpongeSocket: segments go out at `pacing_rate` if that is set, or else at the
+    //! rate the sender derives from its congestion control (TCPConnection::pacing_rate()).
+    bool pacing = false;
+    uint64_t pacing_rate = 0;  //!< Fixed pacing rate, in bytes per second (0: follow the congestion control)
+
+    //! \brief Coalesce small writes with Nagle's algorithm ([RFC 896](\ref rfc::rfc896))
+    //! \details Off by default, so every write goes out at once. TCPConnection::cork() batches writes
+    //! regardless of this setting.
+    bool nagle = false;
+
+    //! \brief Delay the ACK for in-order data, so one ACK covers two segments ([RFC 1122](\ref rfc::rfc1122) 4.2.3.2)
+    //! \details Off by default: every segment that occupies sequence numbers is then acknowledged at once.
+    //! When on, out-of-order data, a SYN or a FIN is still acknowledged at once, and an ACK is never
+    //! held longer than `delayed_ack_timeout`.
+    bool delayed_ack = false;
+    uint16_t delayed_ack_timeout = 40;  //!< Longest an ACK is delayed, in milliseconds
 };
 
 //! Config for classes derived from FdAdapter
@@ -30,6 +85,15 @@ class FdAdapterConfig {
 
     uint16_t loss_rate_dn = 0;  //!< Downlink loss rate (for LossyFdAdapter)
     uint16_t loss_rate_up = 0;  //!< Uplink loss rate (for LossyFdAdapter)
+
+    uint16_t mtu = 1500;  //!< Largest IP datagram the adapter sends (bounds the MSS)
+
+    //! \brief Read and write datagrams in batches through an IoEngine, where io_uring is available
+    //! \details Off by default: each datagram is then read or written with its own system call.
+    bool io_uring = false;
+
+    //! \brief Bind with SO_REUSEPORT, so that several sockets (one per thread) share the `source` address
+    bool reuse_port = false;
 };
 
 #endif  // SPONGE_LIBSPONGE_TCP_CONFIG_HH
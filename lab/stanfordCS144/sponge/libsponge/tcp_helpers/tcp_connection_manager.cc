@@ -0,0 +1,394 @@
+#include "tcp_connection_manager.hh"
+
+#include "buffer_pool.hh"
+#include "fd_adapter.hh"
+#include "parser.hh"
+#include "tcp_header.hh"
+#include "util.hh"
+
+#include <algorithm>
+#include <exception>
+#include <iostream>
+#include <netinet/in.h>
+#include <stdexcept>
+#include <utility>
+
+using namespace std;
+
+//! Resolution of the connections' wakeups, in microseconds (TCPConnection ticks in milliseconds)
+static constexpr uint64_t TIMER_RESOLUTION_US = 1000;
+
+//! Longest run() sleeps without checking its condition, in microseconds
+static constexpr uint64_t RUN_MAX_WAIT_US = 10000;
+
+//! The UDP port of an IPv4 address (without the name lookup of Address::port())
+static uint16_t port_of(const Address &address) {
+    return be16toh(reinterpret_cast<const sockaddr_in *>(static_cast<const sockaddr *>(address))->sin_port);
+}
+
+//! A big-endian 16-bit field of a segment (its TCP ports, before it is parsed)
+static uint16_t u16_at(const string_view payload, const size_t offset) {
+    return static_cast<uint16_t>((uint8_t(payload[offset]) << 8) | uint8_t(payload[offset + 1]));
+}
+
+bool TCPConnectionManager::FlowKey::operator==(const FlowKey &other) const {
+    return peer_ip == other.peer_ip and peer_port == other.peer_port and remote_port == other.remote_port and
+           local_port == other.local_port;
+}
+
+size_t TCPConnectionManager::FlowKeyHash::operator()(const FlowKey &key) const {
+    const uint64_t ports = (uint64_t{key.peer_port} << 32) | (uint64_t{key.remote_port} << 16) | key.local_port;
+    return hash<uint64_t>{}((uint64_t{key.peer_ip} << 48) ^ (uint64_t{key.peer_ip} >> 16) ^ ports);
+}
+
+//! \details Not FlowKeyHash itself: within a shard, that hash should still spread flows over all the buckets.
+size_t TCPConnectionManager::shard_of(const FlowKey &key, const size_t count) {
+    return ((FlowKeyHash{}(key) * UINT64_C(0x9e3779b97f4a7c15)) >> 32) % count;
+}
+
+TCPConnectionManager::TCPConnectionManager(const TCPConfig &tcp_config,
+                                           const FdAdapterConfig &adapter_config,
+                                           Callbacks callbacks)
+    : _tcp_config(tcp_config)
+    , _adapter_config(adapter_config)
+    , _callbacks(move(callbacks))
+    , _timers(TIMER_RESOLUTION_US, timestamp_us()) {
+    // segments must fit in the datagrams
+    _tcp_config.mss = min(_tcp_config.mss, TCPOverUDPSocketAdapter::max_segment_size(_adapter_config.mtu));
+
+    if (_adapter_config.reuse_port) {
+        _socket.set_reuseport();
+    }
+    _socket.bind(_adapter_config.source);
+    _next_port = port_of(_socket.local_address());
+
+    if (_adapter_config.io_uring) {
+        IoEngine::try_emplace(_io_engine);
+    }
+
+    _eventloop.add_rule(_socket, Direction::In, [&] { read_socket(); });
+}
+
+//! \details (The peers then need not time out. The application hears nothing: it is likely being torn down too.)
+TCPConnectionManager::~TCPConnectionManager() {
+    try {
+        for (auto &entry : _connections) {
+            entry.second.tcp.abort();
+            send_segments(entry.second);
+        }
+        if (_io_engine.has_value()) {
+            _io_engine->flush();
+        }
+    } catch (const exception &e) {
+        cerr << "Exception destructing TCPConnectionManager: " << e.what() << "\n";
+    }
+}
+
+TCPConnectionManager::Connection &TCPConnectionManager::find(const ConnectionId id) {
+    const auto it = _connections.find(id);
+    if (it == _connections.end()) {
+        throw runtime_error("TCPConnectionManager: no connection " + to_string(id));
+    }
+    return it->second;
+}
+
+const TCPConnectionManager::Connection &TCPConnectionManager::find(const ConnectionId id) const {
+    const auto it = _connections.find(id);
+    if (it == _connections.end()) {
+        throw runtime_error("TCPConnectionManager: no connection " + to_string(id));
+    }
+    return it->second;
+}
+
+TCPConnectionManager::ConnectionId TCPConnectionManager::create(const FlowKey &key, const Address &peer) {
+    const ConnectionId id = _next_id++;
+    _connections.try_emplace(id, key, peer, _tcp_config, timestamp_us());
+    _flows.emplace(key, id);
+    return id;
+}
+
+//! \details The clock moves in whole milliseconds; the remainder stays behind until it adds up to one.
+void TCPConnectionManager::catch_up(Connection &connection, const uint64_t now_us) {
+    if (now_us <= connection.clock_us) {
+        return;
+    }
+    const uint64_t elapsed_ms = (now_us - connection.clock_us) / 1000;
+    if (elapsed_ms > 0) {
+        connection.tcp.tick(elapsed_ms);
+        connection.clock_us += elapsed_ms * 1000;
+    }
+}
+
+void TCPConnectionManager::touch(const ConnectionId id) {
+    Connection &connection = find(id);
+    if (not connection.dirty) {
+        connection.dirty = true;
+        _dirty.push_back(id);
+    }
+}
+
+//! \details A callback may touch connections (its own included) again; they are settled in the same pass.
+//! Called from a callback, this does nothing: the pass under way takes care of them.
+void TCPConnectionManager::settle() {
+    if (_settling) {
+        return;
+    }
+    _settling = true;
+    try {
+        for (size_t i = 0; i < _dirty.size(); i++) {
+            service(_dirty[i]);
+        }
+    } catch (...) {
+        _dirty.clear();
+        _settling = false;
+        throw;
+    }
+    _dirty.clear();
+    _settling = false;
+}
+
+void TCPConnectionManager::service(const ConnectionId id) {
+    auto it = _connections.find(id);
+    if (it == _connections.end()) {
+        return;
+    }
+    Connection &connection = it->second;
+    connection.dirty = false;
+    TCPConnection &tcp = connection.tcp;
+
+    send_segments(connection);
+
+    if (connection.timer.has_value()) {
+        _timers.cancel(connection.timer.value());
+        connection.timer.reset();
+    }
+
+    const bool active = tcp.active();
+    const auto next_tick = tcp.next_tick();
+    if (next_tick.has_value()) {
+        connection.timer = _timers.schedule(connection.clock_us + next_tick.value() * 1000, [this, id] {
+            Connection &due = find(id);
+            due.timer.reset();
+            catch_up(due, timestamp_us());
+            touch(id);
+        });
+    }
+
+    // what to tell the application
+    const bool open = active and not connection.opened and tcp.established();
+    connection.opened |= open;
+    _half_open -= open and connection.passive;
+    const ByteStream &inbound = tcp.inbound_stream();
+    const bool ended = inbound.input_ended() or inbound.error();
+    const bool readable =
+        inbound.bytes_written() > connection.bytes_reported or (ended and not connection.end_reported);
+    connection.bytes_reported = inbound.bytes_written();
+    connection.end_reported |= ended;
+    const bool writable = active and connection.blocked and tcp.remaining_outbound_capacity() > 0;
+    connection.blocked &= not writable;
+
+    // (only settle() removes connections, so the connection outlives these)
+    if (open and _callbacks.on_open) {
+        _callbacks.on_open(id);
+    }
+    if (readable and _callbacks.on_readable) {
+        _callbacks.on_readable(id);
+    }
+    if (writable and _callbacks.on_writable) {
+        _callbacks.on_writable(id);
+    }
+
+    if (not active) {
+        _half_open -= connection.passive and not connection.opened;
+        _flows.erase(connection.key);
+        _connections.erase(id);
+        if (_callbacks.on_close) {
+            _callbacks.on_close(id);
+        }
+    }
+}
+
+void TCPConnectionManager::send_segments(Connection &connection) {
+    auto &segments = connection.tcp.segments_out();
+    while (not segments.empty()) {
+        TCPSegment &segment = segments.front();
+        segment.header().sport = connection.key.local_port;
+        segment.header().dport = connection.key.remote_port;
+        send(connection.peer, segment);
+        segments.pop();
+    }
+}
+
+void TCPConnectionManager::send(const Address &peer, TCPSegment &segment) {
+    if (_io_engine.has_value()) {
+        _io_engine->sendto(_socket, peer, segment.serialize(0));
+    } else {
+        _socket.sendto(peer, segment.serialize(0));
+    }
+}
+
+//! \details The RST takes its sequence number from the segment's ACK if it has one, and otherwise
+//! acknowledges the segment, so the peer will accept it. A connection the peer still keeps after this side
+//! has forgotten it (e.g. a FIN retransmitted once this side stopped lingering) ends at once.
+void TCPConnectionManager::reset(const Address &peer, const TCPSegment &segment) {
+    const TCPHeader &header = segment.header();
+    TCPSegment rst{};
+    rst.header().sport = header.dport;
+    rst.header().dport = header.sport;
+    rst.header().rst = true;
+    if (header.ack) {
+        rst.header().seqno = header.ackno;
+    } else {
+        rst.header().ack = true;
+        rst.header().ackno = header.seqno + static_cast<uint32_t>(segment.length_in_sequence_space());
+    }
+    send(peer, rst);
+}
+
+//! \details Takes as many datagrams as are waiting, up to IoEngine::BATCH (with one system call each
+//! unless there is an IoEngine), so a burst for many connections is handled in one pass.
+void TCPConnectionManager::read_socket() {
+    if (not _io_engine.has_value()) {
+        _socket.recv(_datagram);
+        receive(_datagram.source_address, _datagram.payload);
+        for (size_t i = 1; i < IoEngine::BATCH and _socket.try_recv(_datagram); i++) {
+            receive(_datagram.source_address, _datagram.payload);
+        }
+    } else {
+        const size_t count = _io_engine->recv(_socket);
+        for (size_t i = 0; i < count; i++) {
+            receive(_io_engine->source(i), _io_engine->payload(i));
+        }
+    }
+    settle();
+}
+
+//! \details A segment of an unknown flow opens a connection if it is a SYN (without RST) to the UDP
+//! socket's port while listening, with room in the SYN backlog (a SYN without room is dropped, for the peer to
+//! retransmit); otherwise it is refused with a RST (unless it is one). Anything that is not IPv4 or a valid
+//! segment is dropped.
+void TCPConnectionManager::receive(const Address &source, const string_view payload) {
+    if (static_cast<const sockaddr *>(source)->sa_family != AF_INET) {
+        return;
+    }
+
+    // a datagram of another shard's flow goes there before any work is spent on it here
+    if (_shard_count > 1 and payload.size() >= 2 * sizeof(uint16_t)) {
+        const FlowKey key{source.ipv4_numeric(), port_of(source), u16_at(payload, 0), u16_at(payload, 2)};
+        const size_t owner = shard_of(key, _shard_count);
+        if (owner != _shard) {
+            _forward(owner, source, payload);
+            return;
+        }
+    }
+
+    // copy the payload out of the receive buffer into a pooled chunk
+    string buffer = BufferPool::local().acquire(payload.size());
+    buffer.append(payload);
+    TCPSegment segment;
+    if (ParseResult::NoError != segment.parse(move(buffer), 0)) {
+        return;
+    }
+
+    const TCPHeader &header = segment.header();
+    const FlowKey key{source.ipv4_numeric(), port_of(source), header.sport, header.dport};
+    const auto flow = _flows.find(key);
+    ConnectionId id = 0;
+    if (flow != _flows.end()) {
+        id = flow->second;
+    } else if (_listening and header.syn and not header.rst and header.dport == port_of(_socket.local_address())) {
+        if (_half_open >= _syn_backlog) {
+            return;
+        }
+        id = create(key, source);
+        find(id).passive = true;
+        _half_open++;
+    } else {
+        if (not header.rst) {
+            reset(source, segment);
+        }
+        return;
+    }
+
+    Connection &connection = find(id);
+    catch_up(connection, timestamp_us());
+    connection.tcp.segment_received(segment);
+    touch(id);
+}
+
+TCPConnectionManager::ConnectionId TCPConnectionManager::connect(const Address &peer) {
+    const auto following = [](const uint16_t port) -> uint16_t { return port == UINT16_MAX ? 1 : port + 1; };
+    FlowKey key{peer.ipv4_numeric(), port_of(peer), port_of(peer), _next_port};
+    while (_flows.count(key) or shard_of(key, _shard_count) != _shard) {
+        key.local_port = following(key.local_port);
+        if (key.local_port == _next_port) {
+            throw runtime_error("TCPConnectionManager: no free port to connect to " + peer.to_string());
+        }
+    }
+    _next_port = following(key.local_port);
+
+    const ConnectionId id = create(key, peer);
+    find(id).tcp.connect();
+    touch(id);
+    settle();
+    return id;
+}
+
+size_t TCPConnectionManager::write(const ConnectionId id, string &&data) {
+    Connection &connection = find(id);
+    catch_up(connection, timestamp_us());
+    const size_t written = connection.tcp.write(move(data));
+    connection.blocked |= connection.tcp.remaining_outbound_capacity() == 0;
+    touch(id);
+    settle();
+    return written;
+}
+
+void TCPConnectionManager::end_input(const ConnectionId id) {
+    Connection &connection = find(id);
+    catch_up(connection, timestamp_us());
+    connection.tcp.end_input_stream();
+    touch(id);
+    settle();
+}
+
+void TCPConnectionManager::set_shard(const size_t index, const size_t count, Forward forward) {
+    if (count == 0 or index >= count) {
+        throw runtime_error("TCPConnectionManager: no shard " + to_string(index) + " of " + to_string(count));
+    }
+    _shard = index;
+    _shard_count = count;
+    _forward = move(forward);
+}
+
+void TCPConnectionManager::deliver(const Address &source, const string_view payload) {
+    receive(source, payload);
+    settle();
+}
+
+void TCPConnectionManager::wait_next_event(const chrono::microseconds max_wait) {
+    if (_io_engine.has_value()) {
+        _io_engine->flush();
+    }
+
+    chrono::microseconds timeout = max_wait;
+    const auto next_timer = _timers.next_expiry();
+    if (next_timer.has_value()) {
+        const uint64_t now = timestamp_us();
+        timeout = min(timeout, chrono::microseconds{next_timer.value() > now ? next_timer.value() - now : 0});
+    }
+
+    _eventloop.wait_next_event(timeout);
+    _timers.advance(timestamp_us());
+    settle();
+
+    if (_io_engine.has_value()) {
+        _io_engine->flush();
+    }
+}
+
+void TCPConnectionManager::run(const function<bool()> &condition) {
+    while (condition()) {
+        wait_next_event(chrono::microseconds{RUN_MAX_WAIT_US});
+    }
+}
@@ -0,0 +1,222 @@
+#ifndef SPONGE_LIBSPONGE_TCP_CONNECTION_MANAGER_HH
+#define SPONGE_LIBSPONGE_TCP_CONNECTION_MANAGER_HH
+
+#include "address.hh"
+#include "byte_stream.hh"
+#include "eventloop.hh"
+#include "io_engine.hh"
+#include "socket.hh"
+#include "tcp_config.hh"
+#include "tcp_connection.hh"
+#include "tcp_segment.hh"
+#include "timer_wheel.hh"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+//! \brief Many TCP connections carried over one UDP socket, served by one event loop on the caller's thread
+//! \details Inbound segments are demultiplexed by their flow: the peer's IPv4 address and UDP port, and the
+//! two TCP ports. Each TCPConnection is ticked only when it has a timer due (TCPConnection::next_tick()),
+//! from one TimerWheel shared by all of them, and its clock is brought up to date before any other event
+//! reaches it; idle connections cost nothing per tick, so thousands of them fit on one thread.
+//!
+//! Connections are opened with connect(), or by a peer's SYN while listening. The application hears about
+//! them through Callbacks, and drives them with write() and end_input(); every call (including from a
+//! callback) must be made on the thread that runs the manager.
+class TCPConnectionManager {
+  public:
+    using ConnectionId = uint64_t;  //!< Handle for a connection, never reused
+
+    //! \brief What the application is told about its connections
+    //! \details Each callback runs on the manager's thread, once the event that prompted it has been fully
+    //! handled; a callback may call any method of the manager. Unset callbacks are skipped. A connection's
+    //! last inbound bytes are announced by on_readable just before on_close, while they can still be read.
+    struct Callbacks {
+        std::function<void(ConnectionId)> on_open{};      //!< the three-way handshake has completed
+        std::function<void(ConnectionId)> on_readable{};  //!< new inbound bytes, or the inbound stream ended
+        std::function<void(ConnectionId)> on_writable{};  //!< room again in an outbound stream that was full
+        std::function<void(ConnectionId)> on_close{};     //!< the connection is gone (its id is now invalid)
+    };
+
+    //! \brief Hands a datagram to the shard that owns its flow (see set_shard())
+    using Forward = std::function<void(size_t shard, const Address &source, std::string_view payload)>;
+
+  private:
+    //! \brief A flow: what tells one connection's segments from another's
+    struct FlowKey {
+        uint32_t peer_ip;      //!< IPv4 address of the peer's UDP socket
+        uint16_t peer_port;    //!< UDP port of the peer's UDP socket
+        uint16_t remote_port;  //!< the peer's TCP port
+        uint16_t local_port;   //!< our TCP port
+        bool operator==(const FlowKey &other) const;
+    };
+
+    //! Hash of a FlowKey
+    struct FlowKeyHash {
+        size_t operator()(const FlowKey &key) const;
+    };
+
+    //! The shard (of `count`) that owns a flow
+    static size_t shard_of(const FlowKey &key, const size_t count);
+
+    //! One connection and its bookkeeping
+    struct Connection {
+        FlowKey key;                                 //!< its flow
+        Address peer;                                //!< the peer's UDP socket
+        TCPConnection tcp;                           //!< the state machine
+        uint64_t clock_us;                           //!< time up to which `tcp` has been ticked
+        std::optional<TimerWheel::TimerId> timer{};  //!< pending wakeup for TCPConnection::next_tick()
+        bool opened = false;                         //!< has on_open run?
+        bool passive = false;                        //!< was it opened by a peer's SYN?
+        uint64_t bytes_reported = 0;                 //!< inbound bytes on_readable was run for
+        bool end_reported = false;                   //!< has on_readable run for the end of the inbound stream?
+        bool blocked = false;                        //!< did a write() leave the outbound stream full?
+        bool dirty = false;                          //!< is it in `_dirty`?
+
+        //! (constructed in place: a moved-from TCPConnection would still think itself active)
+        Connection(const FlowKey &flow, const Address &address, const TCPConfig &config, const uint64_t now_us)
+            : key(flow), peer(address), tcp(config), clock_us(now_us) {}
+    };
+
+    TCPConfig _tcp_config;                                            //!< for every connection
+    FdAdapterConfig _adapter_config;                                  //!< the UDP socket's address, MTU, I/O engine
+    Callbacks _callbacks;                                             //!< the application
+    UDPSocket _socket{};                                              //!< carries every connection
+    UDPSocket::received_datagram _datagram{{nullptr, 0}, {}};         //!< reused receive buffer
+    std::optional<IoEngine> _io_engine{};                             //!< batches the datagrams, if enabled
+    EventLoop _eventloop{EventLoop::Backend::Epoll};                  //!< waits for datagrams
+    TimerWheel _timers;                                               //!< the connections' wakeups
+    std::unordered_map<ConnectionId, Connection> _connections{};      //!< every open connection
+    std::unordered_map<FlowKey, ConnectionId, FlowKeyHash> _flows{};  //!< connection of each flow
+    ConnectionId _next_id{1};                                         //!< handle for the next connection
+    uint16_t _next_port{0};                                           //!< TCP port connect() tries first
+    bool _listening = false;                                          //!< is a peer's SYN accepted?
+    size_t _syn_backlog{std::numeric_limits<size_t>::max()};          //!< most half-open connections
+    size_t _half_open{0};                                             //!< opened by a SYN, not yet established
+    std::vector<ConnectionId> _dirty{};                               //!< connections with events to settle
+    bool _settling = false;                                           //!< is settle() running (callbacks included)?
+    size_t _shard{0};                                                 //!< this manager's shard
+    size_t _shard_count{1};                                           //!< number of shards sharing the address
+    Forward _forward{};                                               //!< to the other shards
+
+    //! The connection with handle `id` (throws if there is none)
+    Connection &find(const ConnectionId id);
+    const Connection &find(const ConnectionId id) const;
+
+    //! Create a connection for `key` (neither connecting nor listening yet)
+    ConnectionId create(const FlowKey &key, const Address &peer);
+
+    //! Tick a connection up to `now_us`, in whole milliseconds
+    void catch_up(Connection &connection, const uint64_t now_us);
+
+    //! Note that a connection has had an event, for settle()
+    void touch(const ConnectionId id);
+
+    //! Send, reschedule and report on every dirty connection, removing those that are done
+    void settle();
+
+    //! Send a connection's outbound segments, reschedule its wakeup, and run its callbacks
+    void service(const ConnectionId id);
+
+    //! Put a connection's outbound segments on the wire
+    void send_segments(Connection &connection);
+
+    //! Handle one datagram received from `source`
+    void receive(const Address &source, const std::string_view payload);
+
+    //! Read the datagrams waiting on the socket
+    void read_socket();
+
+    //! Put a segment on the wire, to the UDP socket at `peer`
+    void send(const Address &peer, TCPSegment &segment);
+
+    //! Refuse a segment of no connection with a RST (as [RFC 793](\ref rfc::rfc793) does in CLOSED)
+    void reset(const Address &peer, const TCPSegment &segment);
+
+  public:
+    //! \param[in] tcp_config is the configuration of every connection (its MSS is lowered to fit the MTU)
+    //! \param[in] adapter_config gives the address to bind the UDP socket to (`source`), the MTU, and
+    //!            whether to batch datagram I/O through an IoEngine (`io_uring`)
+    //! \param[in] callbacks tell the application about its connections
+    TCPConnectionManager(const TCPConfig &tcp_config, const FdAdapterConfig &adapter_config, Callbacks callbacks);
+
+    //! Aborts the connections still open, each with a RST (and without callbacks)
+    ~TCPConnectionManager();
+
+    TCPConnectionManager(const TCPConnectionManager &other) = delete;
+    TCPConnectionManager &operator=(const TCPConnectionManager &other) = delete;
+
+    //! \brief Replace the callbacks (e.g. with ones that refer to the manager itself)
+    void set_callbacks(Callbacks callbacks) { _callbacks = std::move(callbacks); }
+
+    //! \brief Make this manager shard `index` of `count` managers bound to one address with `reuse_port`
+    //! \details The kernel spreads datagrams among the shards' sockets by sender, not by TCP flow, so each
+    //! flow is owned by one shard (by hash) and a datagram that reaches any other shard is passed to
+    //! `forward` unread, for the owner's deliver(). connect() picks ports whose flows this shard owns.
+    void set_shard(const size_t index, const size_t count, Forward forward);
+
+    //! \brief Handle a datagram that another shard received for a flow of this one
+    void deliver(const Address &source, const std::string_view payload);
+
+    //! \brief Is datagram I/O batched through an IoEngine? (FdAdapterConfig::io_uring, where io_uring is available)
+    bool batched_io() const { return _io_engine.has_value(); }
+
+    //! \brief The event loop, for rules on the application's own fds (served on the manager's thread)
+    EventLoop &eventloop() { return _eventloop; }
+
+    //! \brief Accept connections opened by peers (a SYN to the UDP socket's port, from an unknown flow)
+    void set_listening(const bool listening) { _listening = listening; }
+
+    //! \brief Drop a peer's SYN for a new connection while `backlog` connections are half-open
+    //! \details (opened by a peer's SYN and not yet established); the peer will retransmit the SYN.
+    void set_syn_backlog(const size_t backlog) { _syn_backlog = backlog; }
+
+    //! \brief Number of connections opened by a peer's SYN and not yet established
+    size_t half_open() const { return _half_open; }
+
+    //! \brief Open a connection to the manager or TCPSpongeSocket (over UDP) at `peer`
+    //! \details The first connection uses the UDP socket's port as its TCP port (which a TCPOverUDPSpongeSocket
+    //! peer expects); later ones take the following free ports in turn (of flows this shard owns, when
+    //! sharded), so a port is not reused while the peer may still linger on its last connection.
+    ConnectionId connect(const Address &peer);
+
+    //! \brief Write to a connection's outbound stream
+    //! \returns the number of bytes accepted; if that is less than the whole of `data`, or leaves the stream
+    //! full, on_writable runs once there is room again
+    size_t write(const ConnectionId id, std::string &&data);
+
+    //! \brief End a connection's outbound stream
+    void end_input(const ConnectionId id);
+
+    //! \brief A connection's inbound stream, to read what on_readable announced
+    ByteStream &inbound_stream(const ConnectionId id) { return find(id).tcp.inbound_stream(); }
+
+    //! \brief A connection's state machine (e.g. for its state() or remaining_outbound_capacity())
+    const TCPConnection &connection(const ConnectionId id) const { return find(id).tcp; }
+
+    //! \brief Wait up to `max_wait` for datagrams or due timers, and handle them
+    //! \details Queued outbound datagrams are flushed before waiting.
+    void wait_next_event(const std::chrono::microseconds max_wait);
+
+    //! \brief Handle events while `condition` returns true
+    void run(const std::function<bool()> &condition);
+
+    //! \brief Number of open connections
+    size_t size() const { return _connections.size(); }
+
+    //! \brief Number of pending connection wakeups
+    size_t timers() const { return _timers.size(); }
+
+    //! \brief The UDP socket's address
+    Address local_address() const { return _socket.local_address(); }
+};
+
+#endif  // SPONGE_LIBSPONGE_TCP_CONNECTION_MANAGER_HH
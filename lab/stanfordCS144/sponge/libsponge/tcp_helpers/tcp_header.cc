@@ -1,9 +1,60 @@
 #include "tcp_header.hh"
 
+#include <algorithm>
 #include <sstream>
 
 using namespace std;
 
+//! \param[in,out] header receives the options that are understood
+//! \param[in,out] p is positioned at the start of the options
+//! \param[in] len is the number of bytes of options (the rest of the header)
+//! \details Unknown options are skipped. A malformed option ends parsing, but is not an error.
+static void parse_options(TCPHeader &header, NetParser &p, size_t len) {
+    while (len > 0 and not p.error()) {
+        const uint8_t kind = p.u8();
+        len--;
+        if (kind == TCPHeader::OPT_EOL) {
+            return;
+        }
+        if (kind == TCPHeader::OPT_NOP) {
+            continue;
+        }
+
+        if (len == 0) {
+            return;
+        }
+        const uint8_t size = p.u8();
+        len--;
+        if (size < 2 or size - 2u > len) {
+            return;
+        }
+        size_t body = size - 2;
+        len -= body;
+
+        if (kind == TCPHeader::OPT_MSS and body == 2) {
+            header.mss = p.u16();
+            body = 0;
+        } else if (kind == TCPHeader::OPT_WSCALE and body == 1) {
+            header.wscale = min(p.u8(), TCPHeader::MAX_WINDOW_SCALE);  // larger values are treated as 14
+            body = 0;
+        } else if (kind == TCPHeader::OPT_SACK_PERMITTED and body == 0) {
+            header.sack_permitted = true;
+        } else if (kind == TCPHeader::OPT_TIMESTAMPS and body == 8) {
+            const uint32_t tsval = p.u32();
+            const uint32_t tsecr = p.u32();
+            header.timestamps = {tsval, tsecr};
+            body = 0;
+        } else if (kind == TCPHeader::OPT_SACK and body % 8 == 0) {
+            for (; body > 0; body -= 8) {
+                const WrappingInt32 left{p.u32()};
+                const WrappingInt32 right{p.u32()};
+                header.sack.emplace_back(left, right);
+            }
+        }
+        p.remove_prefix(body);
+    }
+}
+
 //! \param[in,out] p is a NetParser from which the TCP fields will be extracted
 //! \returns a ParseResult indicating success or the reason for failure
 //! \details It is important to check for (at least) the following potential errors
@@ -37,13 +88,22 @@ ParseResult TCPHeader::parse(NetParser &p) {
         return ParseResult::HeaderTooShort;
     }
 
-    // skip any options or anything extra in the header
-    p.remove_prefix(doff * 4 - TCPHeader::LENGTH);
+    // parse the options, then skip past them (and anything else extra in the header)
+    const size_t options_len = doff * 4 - TCPHeader::LENGTH;
+    NetParser options{p.buffer()};
+    p.remove_prefix(options_len);
 
     if (p.error()) {
         return p.get_error();
     }
 
+    mss.reset();
+    wscale.reset();
+    sack_permitted = false;
+    sack.clear();
+    timestamps.reset();
+    parse_options(*this, options, options_len);
+
     return ParseResult::NoError;
 }
 
@@ -54,8 +114,7 @@ string TCPHeader::serialize() const {
         throw runtime_error("TCP header too short");
     }
 
-    string ret;
-    ret.reserve(4 * doff);
+    string ret = BufferPool::local().acquire(4 * doff);
 
     NetUnparser::u16(ret, sport);              // source port
     NetUnparser::u16(ret, dport);              // destination port
@@ -72,11 +131,59 @@ string TCPHeader::serialize() const {
 
     NetUnparser::u16(ret, uptr);  // urgent pointer
 
-    ret.resize(4 * doff);  // expand header to advertised size
+    // options, as many as fit in the advertised size (each is padded to 4 bytes with NOPs)
+    const size_t header_len = 4 * doff;
+    if (mss.has_value() and ret.size() + 4 <= header_len) {
+        NetUnparser::u8(ret, OPT_MSS);
+        NetUnparser::u8(ret, 4);
+        NetUnparser::u16(ret, mss.value());
+    }
+    if (wscale.has_value() and ret.size() + 4 <= header_len) {
+        NetUnparser::u8(ret, OPT_NOP);
+        NetUnparser::u8(ret, OPT_WSCALE);
+        NetUnparser::u8(ret, 3);
+        NetUnparser::u8(ret, wscale.value());
+    }
+    if (sack_permitted and ret.size() + 4 <= header_len) {
+        NetUnparser::u8(ret, OPT_NOP);
+        NetUnparser::u8(ret, OPT_NOP);
+        NetUnparser::u8(ret, OPT_SACK_PERMITTED);
+        NetUnparser::u8(ret, 2);
+    }
+    if (timestamps.has_value() and ret.size() + TIMESTAMPS_LENGTH <= header_len) {
+        NetUnparser::u8(ret, OPT_NOP);
+        NetUnparser::u8(ret, OPT_NOP);
+        NetUnparser::u8(ret, OPT_TIMESTAMPS);
+        NetUnparser::u8(ret, 10);
+        NetUnparser::u32(ret, timestamps->first);
+        NetUnparser::u32(ret, timestamps->second);
+    }
+    if (not sack.empty() and ret.size() + 12 <= header_len) {
+        const size_t blocks = min({sack.size(), MAX_SACK_BLOCKS, (header_len - ret.size() - 4) / 8});
+        NetUnparser::u8(ret, OPT_NOP);
+        NetUnparser::u8(ret, OPT_NOP);
+        NetUnparser::u8(ret, OPT_SACK);
+        NetUnparser::u8(ret, 2 + 8 * blocks);
+        for (size_t i = 0; i < blocks; i++) {
+            NetUnparser::u32(ret, sack[i].first.raw_value());
+            NetUnparser::u32(ret, sack[i].second.raw_value());
+        }
+    }
+
+    ret.resize(header_len);  // expand header to advertised size
 
     return ret;
 }
 
+size_t TCPHeader::options_length() const {
+    size_t ret = (mss.has_value() ? 4 : 0) + (wscale.has_value() ? 4 : 0) + (sack_permitted ? 4 : 0) +
+                 (timestamps.has_value() ? TIMESTAMPS_LENGTH : 0);
+    if (not sack.empty() and ret + 12 <= MAX_OPTIONS) {
+        ret += 4 + 8 * min(sack.size(), min(MAX_SACK_BLOCKS, (MAX_OPTIONS - ret - 4) / 8));
+    }
+    return ret;
+}
+
 //! \returns A string with the header's contents
 string TCPHeader::to_string() const {
     stringstream ss{};
@@ -90,6 +197,21 @@ string TCPHeader::to_string() const {
        << "TCP winsize: " << +win << '\n'
        << "TCP cksum: " << +cksum << '\n'
        << "TCP uptr: " << +uptr << '\n';
+    if (mss.has_value()) {
+        ss << "TCP option: MSS " << mss.value() << '\n';
+    }
+    if (wscale.has_value()) {
+        ss << "TCP option: window scale " << +wscale.value() << '\n';
+    }
+    if (sack_permitted) {
+        ss << "TCP option: SACK permitted\n";
+    }
+    for (const auto &[left, right] : sack) {
+        ss << "TCP option: SACK " << left << "-" << right << '\n';
+    }
+    if (timestamps.has_value()) {
+        ss << "TCP option: timestamps " << timestamps->first << " " << timestamps->second << '\n';
+    }
     return ss.str();
 }
 
@@ -104,5 +226,6 @@ bool TCPHeader::operator==(const TCPHeader &other) const {
     // TODO(aozdemir) more complete check (right now we omit cksum, src, dst
     return seqno == other.seqno && ackno == other.ackno && doff == other.doff && urg == other.urg && ack == other.ack &&
            psh == other.psh && rst == other.rst && syn == other.syn && fin == other.fin && win == other.win &&
-           uptr == other.uptr;
+           uptr == other.uptr && mss == other.mss && wscale == other.wscale &&
+           sack_permitted == other.sack_permitted && sack == other.sack && timestamps == other.timestamps;
 }
@@ -4,10 +4,32 @@
 #include "parser.hh"
 #include "wrapping_integers.hh"
 
+#include <optional>
+#include <utility>
+#include <vector>
+
 //! \brief [TCP](\ref rfc::rfc793) segment header
-//! \note TCP options are not supported
+//! \note Of the TCP options, only the maximum segment size, window scaling and timestamps
+//! ([RFC 7323](\ref rfc::rfc7323)) and selective acknowledgments ([RFC 2018](\ref rfc::rfc2018)) are
+//! understood; other options are skipped when parsing.
 struct TCPHeader {
-    static constexpr size_t LENGTH = 20;  //!< [TCP](\ref rfc::rfc793) header length, not including options
+    static constexpr size_t LENGTH = 20;             //!< [TCP](\ref rfc::rfc793) header length, not including options
+    static constexpr size_t CKSUM_OFFSET = 16;       //!< Offset of the checksum field in the serialized header
+    static constexpr size_t MAX_OPTIONS = 40;        //!< Most bytes of options a header can carry
+    static constexpr size_t MAX_SACK_BLOCKS = 4;     //!< Most SACK blocks that fit in the options space
+    static constexpr size_t TIMESTAMPS_LENGTH = 12;  //!< Bytes the timestamps option takes, padded
+    static constexpr uint8_t MAX_WINDOW_SCALE = 14;  //!< Largest window shift count allowed by RFC 7323
+
+    //! \name TCP option kinds
+    //!@{
+    static constexpr uint8_t OPT_EOL = 0;             //!< end of option list
+    static constexpr uint8_t OPT_NOP = 1;             //!< no-operation (padding)
+    static constexpr uint8_t OPT_MSS = 2;             //!< maximum segment size, sent on a SYN
+    static constexpr uint8_t OPT_WSCALE = 3;          //!< window scale shift count, sent on a SYN
+    static constexpr uint8_t OPT_SACK_PERMITTED = 4;  //!< SACK-permitted, sent on a SYN
+    static constexpr uint8_t OPT_SACK = 5;            //!< SACK blocks
+    static constexpr uint8_t OPT_TIMESTAMPS = 8;      //!< timestamp and echoed timestamp
+    //!@}
 
     //! \struct TCPHeader
     //! ~~~{.txt}
@@ -50,10 +72,25 @@ struct TCPHeader {
     uint16_t uptr = 0;          //!< urgent pointer
     //!@}
 
+    //! \name TCP options
+    //!@{
+    std::optional<uint16_t> mss{};                                //!< largest payload the sender can receive (SYN only)
+    std::optional<uint8_t> wscale{};                              //!< window scale shift count (SYN only)
+    bool sack_permitted = false;                                  //!< SACK-permitted option (SYN only)
+    std::vector<std::pair<WrappingInt32, WrappingInt32>> sack{};  //!< SACK blocks: (left edge, right edge)
+    std::optional<std::pair<uint32_t, uint32_t>> timestamps{};    //!< timestamps option: (TSval, TSecr)
+    //!@}
+
+    //! \brief Number of bytes the set options take up when serialized (a multiple of 4)
+    //! \note serialize() only writes the options that fit in `4 * doff` bytes; to send them all, set
+    //! `doff = (LENGTH + options_length()) / 4`. SACK blocks are dropped from the end to stay within
+    //! MAX_OPTIONS.
+    size_t options_length() const;
+
     //! Parse the TCP fields from the provided NetParser
     ParseResult parse(NetParser &p);
 
-    //! Serialize the TCP fields
+    //! Serialize the TCP fields (and the options that fit in the header length given by `doff`)
     std::string serialize() const;
 
     //! Return a string containing a header in human-readable format
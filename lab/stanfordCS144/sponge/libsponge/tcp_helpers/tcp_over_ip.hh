@@ -11,6 +11,11 @@
 //! \brief A converter from TCP segments to serialized IPv4 datagrams
 class TCPOverIPv4Adapter : public FdAdapterBase {
   public:
+    //! \brief The MSS to announce for IPv4 datagrams of FdAdapterConfig::mtu bytes
+    //! \details The largest TCP payload that fits behind a header without options; as RFC 6691 has it, the
+    //! options a segment carries come out of this.
+    size_t max_segment_size() const { return config().mtu - IPv4Header::LENGTH - TCPHeader::LENGTH; }
+
     std::optional<TCPSegment> unwrap_tcp_in_ip(const InternetDatagram &ip_dgram);
 
     InternetDatagram wrap_tcp_in_ip(TCPSegment &seg);
@@ -30,15 +30,18 @@ size_t TCPSegment::length_in_sequence_space() const {
 BufferList TCPSegment::serialize(const uint32_t datagram_layer_checksum) const {
     TCPHeader header_out = _header;
     header_out.cksum = 0;
+    string header_bytes = header_out.serialize();
 
-    // calculate checksum -- taken over entire segment
+    // calculate checksum -- taken over entire segment -- and patch it into the serialized header
     InternetChecksum check(datagram_layer_checksum);
-    check.add(header_out.serialize());
+    check.add(header_bytes);
     check.add(_payload);
-    header_out.cksum = check.value();
+    const uint16_t cksum = check.value();
+    header_bytes[TCPHeader::CKSUM_OFFSET] = static_cast<char>(cksum >> 8);
+    header_bytes[TCPHeader::CKSUM_OFFSET + 1] = static_cast<char>(cksum & 0xff);
 
     BufferList ret;
-    ret.append(header_out.serialize());
+    ret.append(move(header_bytes));
     ret.append(_payload);
 
     return ret;
@@ -0,0 +1,244 @@
+#include "tcp_sponge_listener.hh"
+
+#include "byte_stream.hh"
+#include "util.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <utility>
+
+using namespace std;
+
+//! Longest the listener's thread sleeps without checking whether it should stop, in microseconds
+static constexpr uint64_t LISTENER_MAX_WAIT_US = 10000;
+
+//! Most inbound bytes handed to the application's socket at once
+static constexpr size_t MAX_WRITE_TO_APPLICATION = 65536;
+
+TCPSpongeListener::TCPSpongeListener(const TCPConfig &tcp_config,
+                                     const FdAdapterConfig &adapter_config,
+                                     const size_t backlog)
+    : _manager(tcp_config, adapter_config, {})
+    , _address(_manager.local_address())
+    , _backlog(backlog)
+    , _wakeup(SystemCall("eventfd", ::eventfd(0, EFD_CLOEXEC))) {
+    if (_backlog == 0) {
+        throw runtime_error("TCPSpongeListener: backlog must be at least 1");
+    }
+
+    TCPConnectionManager::Callbacks callbacks{};
+    callbacks.on_open = [this](const ConnectionId id) { open(id); };
+    callbacks.on_readable = [this](const ConnectionId id) { readable(id); };
+    callbacks.on_writable = [this](const ConnectionId id) { update_interest(id); };
+    callbacks.on_close = [this](const ConnectionId id) { close(id); };
+    _manager.set_callbacks(move(callbacks));
+
+    _manager.eventloop().add_rule(_wakeup, Direction::In, [this] {
+        _wakeup.read(sizeof(uint64_t));  // (resets the eventfd's count)
+        update_backlog();
+    });
+    update_backlog();
+    _manager.set_listening(true);
+
+    _thread = thread([this] { listener_main(); });
+}
+
+TCPSpongeListener::~TCPSpongeListener() {
+    try {
+        _stopping.store(true, memory_order_release);
+        signal();
+        _thread.join();
+    } catch (const exception &e) {
+        cerr << "Exception destructing TCPSpongeListener: " << e.what() << "\n";
+    }
+}
+
+void TCPSpongeListener::listener_main() {
+    try {
+        while (not _stopping.load(memory_order_acquire)) {
+            _manager.wait_next_event(chrono::microseconds{LISTENER_MAX_WAIT_US});
+        }
+    } catch (const exception &e) {
+        cerr << "Exception in TCPSpongeListener thread: " << e.what() << "\n";
+        throw;
+    }
+}
+
+void TCPSpongeListener::signal() {
+    const uint64_t one = 1;
+    SystemCall("write", static_cast<int>(::write(_wakeup.fd_num(), &one, sizeof(one))));
+}
+
+//! \details The half-open connections and the accept queue together never exceed the backlog: a SYN is
+//! admitted only while the half-open ones fit in what the accept queue leaves of it.
+void TCPSpongeListener::update_backlog() {
+    _manager.set_syn_backlog(_backlog - min(_backlog, queued()));
+}
+
+LocalStreamSocket TCPSpongeListener::accept() {
+    unique_lock<mutex> lock(_mutex);
+    _accepted.wait(lock, [&] { return not _accept_queue.empty(); });
+    LocalStreamSocket socket = move(_accept_queue.front());
+    _accept_queue.pop_front();
+    lock.unlock();
+
+    // there is room in the backlog for another SYN
+    signal();
+    return socket;
+}
+
+size_t TCPSpongeListener::queued() {
+    const lock_guard<mutex> lock(_mutex);
+    return _accept_queue.size();
+}
+
+//! \details The connection gets a pair of local stream sockets: the application's end goes to the accept
+//! queue, and the listener's end is served by two rules, like rules 2 and 3 of TCPSpongeSocket.
+void TCPSpongeListener::open(const ConnectionId id) {
+    int fds[2];
+    SystemCall("socketpair", ::socketpair(AF_UNIX, SOCK_STREAM, 0, static_cast<int *>(fds)));
+    LocalStreamSocket application{FileDescriptor{fds[0]}};
+    Stream &stream = _streams.try_emplace(id, LocalStreamSocket{FileDescriptor{fds[1]}}).first->second;
+    stream.thread_data.set_blocking(false);
+
+    EventLoop &eventloop = _manager.eventloop();
+    stream.data_in_rule = eventloop.add_rule(
+        stream.thread_data, Direction::In, [this, id] { from_application(id); }, {}, [this, id] { end_outbound(id); });
+    stream.data_out_rule = eventloop.add_rule(
+        stream.thread_data, Direction::Out, [this, id] { to_application(id); }, {}, [this, id] { drop_inbound(id); });
+    update_interest(id);
+
+    {
+        const lock_guard<mutex> lock(_mutex);
+        _accept_queue.push_back(move(application));
+    }
+    _accepted.notify_one();
+    update_backlog();
+}
+
+//! \details Just before the connection closes, what the application has not read yet is kept aside.
+void TCPSpongeListener::readable(const ConnectionId id) {
+    const auto it = _streams.find(id);
+    if (it == _streams.end()) {
+        return;  // (it was never established)
+    }
+    if (not _manager.connection(id).active()) {
+        ByteStream &inbound = _manager.inbound_stream(id);
+        it->second.leftover = inbound.read(inbound.buffer_size());
+    }
+    update_interest(id);
+}
+
+void TCPSpongeListener::close(const ConnectionId id) {
+    const auto it = _streams.find(id);
+    if (it == _streams.end()) {
+        return;
+    }
+    it->second.closed = true;
+    update_interest(id);
+}
+
+//! \details (Writing to the connection can tick it, which may close it: the stream is looked up again.)
+void TCPSpongeListener::from_application(const ConnectionId id) {
+    Stream &stream = _streams.at(id);
+    if (stream.closed) {
+        stream.thread_data.read();  // (nowhere to send it)
+        update_interest(id);
+        return;
+    }
+
+    string data = stream.thread_data.read(_manager.connection(id).remaining_outbound_capacity());
+    const bool eof = stream.thread_data.eof();
+    if (not data.empty()) {
+        _manager.write(id, move(data));
+    }
+    if (eof) {
+        end_outbound(id);
+    }
+    update_interest(id);
+}
+
+void TCPSpongeListener::end_outbound(const ConnectionId id) {
+    const auto it = _streams.find(id);
+    if (it == _streams.end() or it->second.outbound_shutdown) {
+        return;
+    }
+    it->second.outbound_shutdown = true;
+    if (not it->second.closed) {
+        _manager.end_input(id);
+    }
+    update_interest(id);
+}
+
+void TCPSpongeListener::to_application(const ConnectionId id) {
+    Stream &stream = _streams.at(id);
+    bool ended = false;
+    if (stream.closed) {
+        const size_t written = stream.thread_data.write(stream.leftover, false);
+        stream.leftover.erase(0, written);
+        ended = stream.leftover.empty();
+    } else {
+        // (straight out of the stream's buffers, without a copy)
+        ByteStream &inbound = _manager.inbound_stream(id);
+        const size_t amount_to_write = min(MAX_WRITE_TO_APPLICATION, inbound.buffer_size());
+        inbound.pop_output(stream.thread_data.write(inbound.peek_output_views(amount_to_write), false));
+        ended = inbound.eof() or inbound.error();
+    }
+
+    if (ended and not stream.inbound_shutdown) {
+        stream.thread_data.shutdown(SHUT_WR);
+        stream.inbound_shutdown = true;
+    }
+    update_interest(id);
+}
+
+//! \details (The application has closed its socket: the inbound bytes have nowhere to go.)
+void TCPSpongeListener::drop_inbound(const ConnectionId id) {
+    const auto it = _streams.find(id);
+    if (it == _streams.end()) {
+        return;
+    }
+    it->second.leftover.clear();
+    it->second.inbound_shutdown = true;
+    update_interest(id);
+}
+
+//! \details A connection's stream is let go (closing the listener's end of the application's socket) once
+//! the application has been given all the inbound bytes and their end, and has ended the outbound stream
+//! or lost the connection. Like a kernel's, a connection lingering in TIME_WAIT holds no socket.
+void TCPSpongeListener::update_interest(const ConnectionId id) {
+    const auto it = _streams.find(id);
+    if (it == _streams.end()) {
+        return;
+    }
+    Stream &stream = it->second;
+    EventLoop &eventloop = _manager.eventloop();
+
+    if (stream.inbound_shutdown and (stream.closed or stream.outbound_shutdown)) {
+        eventloop.remove_rule(stream.data_in_rule);
+        eventloop.remove_rule(stream.data_out_rule);
+        _streams.erase(it);
+        return;
+    }
+
+    if (stream.closed) {
+        eventloop.set_interest(stream.data_in_rule, false);
+        eventloop.set_interest(stream.data_out_rule, true);
+        return;
+    }
+
+    const TCPConnection &tcp = _manager.connection(id);
+    const ByteStream &inbound = _manager.inbound_stream(id);
+    eventloop.set_interest(stream.data_in_rule,
+                           not stream.outbound_shutdown and tcp.remaining_outbound_capacity() > 0);
+    eventloop.set_interest(stream.data_out_rule,
+                           not inbound.buffer_empty() or
+                               ((inbound.eof() or inbound.error()) and not stream.inbound_shutdown));
+}
@@ -0,0 +1,118 @@
+#ifndef SPONGE_LIBSPONGE_TCP_SPONGE_LISTENER_HH
+#define SPONGE_LIBSPONGE_TCP_SPONGE_LISTENER_HH
+
+#include "address.hh"
+#include "eventloop.hh"
+#include "file_descriptor.hh"
+#include "socket.hh"
+#include "tcp_config.hh"
+#include "tcp_connection_manager.hh"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+//! \brief A listening TCP socket (over UDP): accepts connections from many peers, each as its own socket
+//! \details A TCPConnectionManager on a thread of its own does the work of the kernel: it answers SYNs,
+//! keeps the connections, and moves each one's bytes to and from the application through a local stream
+//! socket, as TCPSpongeSocket does for its single connection. Once a connection is established, the
+//! application's end of that socket waits in the accept queue for accept().
+//!
+//! The backlog bounds the connections a slow application has not accepted yet: as in 4.2BSD's listen(2),
+//! it covers both the half-open connections (the SYN queue) and the established ones in the accept queue.
+//! A SYN that finds no room is dropped, so the peer retransmits it later.
+//!
+//! The listener must outlive the connections it accepts: its destructor resets any that are still open.
+class TCPSpongeListener {
+  public:
+    static constexpr size_t DEFAULT_BACKLOG = 128;  //!< (SOMAXCONN of older kernels)
+
+  private:
+    using ConnectionId = TCPConnectionManager::ConnectionId;
+
+    //! A connection's link to the application's socket (all on the listener's thread)
+    struct Stream {
+        LocalStreamSocket thread_data;       //!< the listener's end of the application's socket
+        EventLoop::RuleId data_in_rule{0};   //!< outbound bytes from the application
+        EventLoop::RuleId data_out_rule{0};  //!< inbound bytes to the application
+        std::string leftover{};              //!< inbound bytes of a closed connection, not yet delivered
+        bool closed = false;                 //!< is the connection gone?
+        bool outbound_shutdown = false;      //!< has the application ended the outbound stream?
+        bool inbound_shutdown = false;       //!< has the inbound stream's end been passed on?
+
+        explicit Stream(LocalStreamSocket &&socket) : thread_data(std::move(socket)) {}
+    };
+
+    TCPConnectionManager _manager;                        //!< the connections (used on the listener's thread)
+    Address _address;                                     //!< the UDP socket's address
+    size_t _backlog;                                      //!< most connections not yet accepted
+    std::unordered_map<ConnectionId, Stream> _streams{};  //!< of every connection the application has had
+
+    std::mutex _mutex{};                            //!< guards `_accept_queue`
+    std::condition_variable _accepted{};            //!< signaled when `_accept_queue` grows
+    std::deque<LocalStreamSocket> _accept_queue{};  //!< established connections, for accept()
+
+    FileDescriptor _wakeup;              //!< eventfd: room in a full accept queue, or stop
+    std::atomic<bool> _stopping{false};  //!< has the listener's thread been asked to return?
+    std::thread _thread{};               //!< runs the manager
+
+    //! The listener's thread
+    void listener_main();
+
+    //! Wake the listener's thread
+    void signal();
+
+    //! Bound the SYN queue by what the accept queue leaves of the backlog
+    void update_backlog();
+
+    //! \name Callbacks of the manager
+    //!@{
+    void open(const ConnectionId id);
+    void readable(const ConnectionId id);
+    void close(const ConnectionId id);
+    //!@}
+
+    //! \name Rules of each connection's socket
+    //!@{
+    void from_application(const ConnectionId id);
+    void to_application(const ConnectionId id);
+    void end_outbound(const ConnectionId id);
+    void drop_inbound(const ConnectionId id);
+    //!@}
+
+    //! Enable exactly the rules of a connection that have something to do, or let go of a finished one
+    void update_interest(const ConnectionId id);
+
+  public:
+    //! \param[in] tcp_config is the configuration of every connection
+    //! \param[in] adapter_config gives the address to listen on (`source`; a port of 0 picks one), the MTU,
+    //!            and whether to use an IoEngine
+    //! \param[in] backlog is the most connections (half-open or established) waiting for accept()
+    TCPSpongeListener(const TCPConfig &tcp_config,
+                      const FdAdapterConfig &adapter_config,
+                      const size_t backlog = DEFAULT_BACKLOG);
+
+    //! Stops listening, and resets the connections still open (see TCPConnectionManager's destructor)
+    ~TCPSpongeListener();
+
+    TCPSpongeListener(const TCPSpongeListener &other) = delete;
+    TCPSpongeListener &operator=(const TCPSpongeListener &other) = delete;
+
+    //! \brief Wait for an established connection, and take it off the accept queue
+    //! \returns the application's end of the connection's socket: it reads what the peer sends, and what is
+    //! written to it is sent; shutdown(SHUT_WR) ends the outbound stream
+    LocalStreamSocket accept();
+
+    //! \brief Number of established connections waiting for accept()
+    size_t queued();
+
+    //! \brief The address the listener's UDP socket is bound to
+    const Address &local_address() const { return _address; }
+};
+
+#endif  // SPONGE_LIBSPONGE_TCP_SPONGE_LISTENER_HH
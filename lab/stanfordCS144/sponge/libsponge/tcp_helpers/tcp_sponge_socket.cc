@@ -5,9 +5,12 @@
 #include "tun.hh"
 #include "util.hh"
 
+#include <algorithm>
+#include <chrono>
 #include <cstddef>
 #include <exception>
 #include <iostream>
+#include <limits>
 #include <stdexcept>
 #include <string>
 #include <sys/socket.h>
@@ -20,15 +23,34 @@ using namespace std;
 
 static constexpr size_t TCP_TICK_MS = 10;
 
+//! How late a paced segment may go out and still keep its place in the schedule, in microseconds
+//! (covers the event loop's wakeup latency without letting an idle connection save up a burst)
+static constexpr uint64_t PACING_SLACK_US = 1000;
+
 //! \param[in] condition is a function returning true if loop should continue
 template <typename AdaptT>
 void TCPSpongeSocket<AdaptT>::_tcp_loop(const function<bool()> &condition) {
     auto base_time = timestamp_ms();
     while (condition()) {
-        auto ret = _eventloop.wait_next_event(TCP_TICK_MS);
+        _update_interest();
+        if (_io_engine.has_value()) {
+            _io_engine->flush();
+        }
+
+        // sleep until the next tick, or until a timer (e.g. for a paced segment) is due if that is sooner
+        chrono::microseconds timeout = chrono::milliseconds{TCP_TICK_MS};
+        const auto next_timer = _timers.next_expiry();
+        if (next_timer.has_value()) {
+            const uint64_t now = timestamp_us();
+            timeout = min(timeout, chrono::microseconds{next_timer.value() > now ? next_timer.value() - now : 0});
+        }
+
+        auto ret = _eventloop.wait_next_event(timeout);
         if (ret == EventLoop::Result::Exit or _abort) {
             break;
         }
+        _timers.advance(timestamp_us());
+        _update_cork();
 
         if (_tcp.value().active()) {
             const auto next_time = timestamp_ms();
@@ -37,22 +59,69 @@ void TCPSpongeSocket<AdaptT>::_tcp_loop(const function<bool()> &condition) {
             base_time = next_time;
         }
     }
+
+    if (_io_engine.has_value()) {
+        _io_engine->flush();
+    }
+}
+
+template <typename AdaptT>
+void TCPSpongeSocket<AdaptT>::_update_interest() {
+    if (not _tcp.has_value()) {
+        return;
+    }
+    TCPConnection &tcp = _tcp.value();
+    const ByteStream &inbound = tcp.inbound_stream();
+
+    _eventloop.set_interest(_segment_in_rule, tcp.active());
+    _eventloop.set_interest(_data_in_rule,
+                            tcp.active() and not _outbound_shutdown and tcp.remaining_outbound_capacity() > 0);
+    _eventloop.set_interest(_data_out_rule,
+                            not inbound.buffer_empty() or
+                                ((inbound.eof() or inbound.error()) and not _inbound_shutdown));
+    _eventloop.set_interest(_segment_out_rule, not tcp.segments_out().empty() and not _send_timer.has_value());
+}
+
+template <typename AdaptT>
+void TCPSpongeSocket<AdaptT>::_update_cork() {
+    const bool requested = _cork_requested;
+    if (requested == _corked or not _tcp.has_value()) {
+        return;
+    }
+    _corked = requested;
+    if (_corked) {
+        _tcp->cork();
+    } else {
+        _tcp->uncork();
+    }
 }
 
 //! \param[in] data_socket_pair is a pair of connected AF_UNIX SOCK_STREAM sockets
 //! \param[in] datagram_interface is the interface for reading and writing datagrams
+//! \param[in] backend is how the event loop polls
 template <typename AdaptT>
 TCPSpongeSocket<AdaptT>::TCPSpongeSocket(pair<FileDescriptor, FileDescriptor> data_socket_pair,
-                                         AdaptT &&datagram_interface)
+                                         AdaptT &&datagram_interface,
+                                         const EventLoop::Backend backend)
     : LocalStreamSocket(move(data_socket_pair.first))
     , _thread_data(move(data_socket_pair.second))
-    , _datagram_adapter(move(datagram_interface)) {
+    , _datagram_adapter(move(datagram_interface))
+    , _eventloop(backend) {
     _thread_data.set_blocking(false);
 }
 
 template <typename AdaptT>
 void TCPSpongeSocket<AdaptT>::_initialize_TCP(const TCPConfig &config) {
-    _tcp.emplace(config);
+    // segments must fit in the adapter's datagrams
+    TCPConfig tcp_config = config;
+    tcp_config.mss = min(tcp_config.mss, _datagram_adapter.max_segment_size());
+    _tcp.emplace(tcp_config);
+    _pacing = config.pacing;
+    _fixed_pacing_rate = config.pacing_rate;
+
+    if (_datagram_adapter.config().io_uring and IoEngine::try_emplace(_io_engine)) {
+        _datagram_adapter.set_io_engine(&_io_engine.value());
+    }
 
     // Set up the event loop
 
@@ -70,33 +139,37 @@ void TCPSpongeSocket<AdaptT>::_initialize_TCP(const TCPConfig &config) {
     //    to the local stream socket back to the application)
     //
     // 4) Outbound segment generated by TCP (needs to be
-    //    given to underlying datagram socket)
+    //    given to underlying datagram socket, at the pacing rate if
+    //    pacing is enabled)
+
+    // Each callback ends by updating the rules' interest, as it may have changed what they have to do.
 
     // rule 1: read from filtered packet stream and dump into TCPConnection
-    _eventloop.add_rule(_datagram_adapter,
-                        Direction::In,
-                        [&] {
-                            auto seg = _datagram_adapter.read();
-                            if (seg) {
-                                _tcp->segment_received(move(seg.value()));
-                            }
-
-                            // debugging output:
-                            if (_thread_data.eof() and _tcp.value().bytes_in_flight() == 0 and not _fully_acked) {
-                                cerr << "DEBUG: Outbound stream to "
-                                     << _datagram_adapter.config().destination.to_string()
-                                     << " has been fully acknowledged.\n";
-                                _fully_acked = true;
-                            }
-                        },
-                        [&] { return _tcp->active(); });
+    // (with an IoEngine, every datagram of the batch the adapter read)
+    _segment_in_rule = _eventloop.add_rule(_datagram_adapter, Direction::In, [&] {
+        do {
+            auto seg = _datagram_adapter.read();
+            if (seg) {
+                _tcp->segment_received(move(seg.value()));
+            }
+        } while (_datagram_adapter.pending_reads());
+
+        // debugging output:
+        if (_thread_data.eof() and _tcp.value().bytes_in_flight() == 0 and not _fully_acked) {
+            cerr << "DEBUG: Outbound stream to " << _datagram_adapter.config().destination.to_string()
+                 << " has been fully acknowledged.\n";
+            _fully_acked = true;
+        }
+        _update_interest();
+    });
 
     // rule 2: read from pipe into outbound buffer
-    _eventloop.add_rule(
+    _data_in_rule = _eventloop.add_rule(
         _thread_data,
         Direction::In,
         [&] {
-            const auto data = _thread_data.read(_tcp->remaining_outbound_capacity());
+            _update_cork();
+            auto data = _thread_data.read(_tcp->remaining_outbound_capacity());
             const auto len = data.size();
             const auto amount_written = _tcp->write(move(data));
             if (amount_written != len) {
@@ -112,15 +185,16 @@ void TCPSpongeSocket<AdaptT>::_initialize_TCP(const TCPConfig &config) {
                      << " finished (" << _tcp.value().bytes_in_flight() << " byte"
                      << (_tcp.value().bytes_in_flight() == 1 ? "" : "s") << " still in flight).\n";
             }
+            _update_interest();
         },
-        [&] { return (_tcp->active()) and (not _outbound_shutdown) and (_tcp->remaining_outbound_capacity() > 0); },
+        {},
         [&] {
             _tcp->end_input_stream();
             _outbound_shutdown = true;
         });
 
     // rule 3: read from inbound buffer into pipe
-    _eventloop.add_rule(
+    _data_out_rule = _eventloop.add_rule(
         _thread_data,
         Direction::Out,
         [&] {
@@ -128,9 +202,9 @@ void TCPSpongeSocket<AdaptT>::_initialize_TCP(const TCPConfig &config) {
             // Write from the inbound_stream into
             // the pipe, handling the possibility of a partial
             // write (i.e., only pop what was actually written).
+            // The bytes are written straight out of the stream's buffers, without a copy.
             const size_t amount_to_write = min(size_t(65536), inbound.buffer_size());
-            const std::string buffer = inbound.peek_output(amount_to_write);
-            const auto bytes_written = _thread_data.write(move(buffer), false);
+            const auto bytes_written = _thread_data.write(inbound.peek_output_views(amount_to_write), false);
             inbound.pop_output(bytes_written);
 
             if (inbound.eof() or inbound.error()) {
@@ -144,22 +218,40 @@ void TCPSpongeSocket<AdaptT>::_initialize_TCP(const TCPConfig &config) {
                     cerr << "DEBUG: Waiting for lingering segments (e.g. retransmissions of FIN) from peer...\n";
                 }
             }
-        },
-        [&] {
-            return (not _tcp->inbound_stream().buffer_empty()) or
-                   ((_tcp->inbound_stream().eof() or _tcp->inbound_stream().error()) and not _inbound_shutdown);
+            _update_interest();
         });
 
     // rule 4: read outbound segments from TCPConnection and send as datagrams
-    _eventloop.add_rule(_datagram_adapter,
-                        Direction::Out,
-                        [&] {
-                            while (not _tcp->segments_out().empty()) {
-                                _datagram_adapter.write(_tcp->segments_out().front());
-                                _tcp->segments_out().pop();
-                            }
-                        },
-                        [&] { return not _tcp->segments_out().empty(); });
+    _segment_out_rule = _eventloop.add_rule(_datagram_adapter, Direction::Out, [&] {
+        _send_segments();
+        _update_interest();
+    });
+}
+
+template <typename AdaptT>
+void TCPSpongeSocket<AdaptT>::_send_segments() {
+    auto &segments = _tcp->segments_out();
+    while (not segments.empty()) {
+        // a closed connection's last segments are not held back
+        const uint64_t rate =
+            (_pacing and _tcp->active()) ? (_fixed_pacing_rate > 0 ? _fixed_pacing_rate : _tcp->pacing_rate()) : 0;
+        if (rate > 0) {
+            const uint64_t now = timestamp_us();
+            if (now < _next_send_us) {
+                _send_timer = _timers.schedule(_next_send_us, [&] {
+                    _send_timer.reset();
+                    _send_segments();
+                });
+                return;
+            }
+            // (the header as serialized: with its options)
+            const TCPSegment &segment = segments.front();
+            const uint64_t wire_size = 4 * segment.header().doff + segment.payload().size();
+            _next_send_us = max(_next_send_us, now - min(now, PACING_SLACK_US)) + wire_size * 1000000 / rate;
+        }
+        _datagram_adapter.write(segments.front());
+        segments.pop();
+    }
 }
 
 //! \brief Call [socketpair](\ref man2::socketpair) and return connected Unix-domain sockets of specified type
@@ -172,9 +264,10 @@ static inline pair<FileDescriptor, FileDescriptor> socket_pair_helper(const int
 }
 
 //! \param[in] datagram_interface is the underlying interface (e.g. to UDP, IP, or Ethernet)
+//! \param[in] backend is how the event loop polls
 template <typename AdaptT>
-TCPSpongeSocket<AdaptT>::TCPSpongeSocket(AdaptT &&datagram_interface)
-    : TCPSpongeSocket(socket_pair_helper(SOCK_STREAM), move(datagram_interface)) {}
+TCPSpongeSocket<AdaptT>::TCPSpongeSocket(AdaptT &&datagram_interface, const EventLoop::Backend backend)
+    : TCPSpongeSocket(socket_pair_helper(SOCK_STREAM), move(datagram_interface), backend) {}
 
 template <typename AdaptT>
 TCPSpongeSocket<AdaptT>::~TCPSpongeSocket() {
@@ -208,10 +301,10 @@ void TCPSpongeSocket<AdaptT>::connect(const TCPConfig &c_tcp, const FdAdapterCon
         throw runtime_error("connect() with TCPConnection already initialized");
     }
 
-    _initialize_TCP(c_tcp);
-
     _datagram_adapter.config_mut() = c_ad;
 
+    _initialize_TCP(c_tcp);
+
     cerr << "DEBUG: Connecting to " << c_ad.destination.to_string() << "...\n";
     _tcp->connect();
 
@@ -236,11 +329,11 @@ void TCPSpongeSocket<AdaptT>::listen_and_accept(const TCPConfig &c_tcp, const Fd
         throw runtime_error("listen_and_accept() with TCPConnection already initialized");
     }
 
-    _initialize_TCP(c_tcp);
-
     _datagram_adapter.config_mut() = c_ad;
     _datagram_adapter.set_listening(true);
 
+    _initialize_TCP(c_tcp);
+
     cerr << "DEBUG: Listening for incoming connection...\n";
     _tcp_loop([&] {
         const auto s = _tcp->state();
@@ -290,6 +383,8 @@ CS144TCPSocket::CS144TCPSocket() : TCPOverIPv4SpongeSocket(TCPOverIPv4OverTunFdA
 void CS144TCPSocket::connect(const Address &address) {
     TCPConfig tcp_config;
     tcp_config.rt_timeout = 100;
+    tcp_config.adaptive_rto = true;
+    tcp_config.mss = numeric_limits<uint16_t>::max();  // as large as the adapter's MTU allows
 
     FdAdapterConfig multiplexer_config;
     multiplexer_config.source = {"169.254.144.9", to_string(uint16_t(random_device()()))};
@@ -321,6 +416,8 @@ FullStackSocket::FullStackSocket()
 void FullStackSocket::connect(const Address &address) {
     TCPConfig tcp_config;
     tcp_config.rt_timeout = 100;
+    tcp_config.adaptive_rto = true;
+    tcp_config.mss = numeric_limits<uint16_t>::max();  // as large as the adapter's MTU allows
 
     FdAdapterConfig multiplexer_config;
     multiplexer_config.source = {LOCAL_TAP_IP_ADDRESS, to_string(uint16_t(random_device()()))};
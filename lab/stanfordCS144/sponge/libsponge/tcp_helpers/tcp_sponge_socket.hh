@@ -5,9 +5,11 @@
 #include "eventloop.hh"
 #include "fd_adapter.hh"
 #include "file_descriptor.hh"
+#include "io_engine.hh"
 #include "network_interface.hh"
 #include "tcp_config.hh"
 #include "tcp_connection.hh"
+#include "timer_wheel.hh"
 #include "tuntap_adapter.hh"
 
 #include <atomic>
@@ -35,11 +37,44 @@ class TCPSpongeSocket : public LocalStreamSocket {
     std::optional<TCPConnection> _tcp{};
 
     //! eventloop that handles all the events (new inbound datagram, new outbound bytes, new inbound bytes)
-    EventLoop _eventloop{};
+    EventLoop _eventloop;
+
+    //! \name Rules of the event loop
+    //! Their interest is set explicitly by _update_interest(), rather than asked of each rule on every
+    //! event, so the loop's fds stay registered with the kernel while nothing changes.
+    //!@{
+    EventLoop::RuleId _segment_in_rule{0};   //!< rule 1: inbound datagram
+    EventLoop::RuleId _data_in_rule{0};      //!< rule 2: outbound bytes from the owner
+    EventLoop::RuleId _data_out_rule{0};     //!< rule 3: inbound bytes to the owner
+    EventLoop::RuleId _segment_out_rule{0};  //!< rule 4: outbound segment
+
+    //! Enable exactly the rules that have something to do in the current state
+    void _update_interest();
+    //!@}
 
     //! Process events while specified condition is true
     void _tcp_loop(const std::function<bool()> &condition);
 
+    //! \brief Batches the adapter's datagram I/O (FdAdapterConfig::io_uring), if io_uring is available
+    //! \details Rule 1 takes a whole batch of inbound datagrams per wakeup, and the segments written while
+    //! handling events go out together, once per iteration of the loop, just before it waits again.
+    std::optional<IoEngine> _io_engine{};
+
+    //! \name Pacing (TCPConfig::pacing)
+    //! Outbound segments leave no faster than the pacing rate. When the next one is not yet due, rule 4
+    //! stops polling the adapter and a timer releases the segment instead, so the event loop sleeps
+    //! exactly until then rather than until the next TCP tick.
+    //!@{
+    bool _pacing{false};                               //!< pacing is enabled
+    uint64_t _fixed_pacing_rate{0};                    //!< TCPConfig::pacing_rate
+    TimerWheel _timers{};                              //!< wakeups of the TCPConnection thread
+    uint64_t _next_send_us{0};                         //!< when the next segment is due (timestamp_us())
+    std::optional<TimerWheel::TimerId> _send_timer{};  //!< pending wakeup for the next segment
+
+    //! Write outbound segments to the adapter as far as pacing allows
+    void _send_segments();
+    //!@}
+
     //! Main loop of TCPConnection thread
     void _tcp_main();
 
@@ -47,10 +82,19 @@ class TCPSpongeSocket : public LocalStreamSocket {
     std::thread _tcp_thread{};
 
     //! Construct LocalStreamSocket fds from socket pair, initialize eventloop
-    TCPSpongeSocket(std::pair<FileDescriptor, FileDescriptor> data_socket_pair, AdaptT &&datagram_interface);
+    TCPSpongeSocket(std::pair<FileDescriptor, FileDescriptor> data_socket_pair,
+                    AdaptT &&datagram_interface,
+                    const EventLoop::Backend backend);
 
     std::atomic_bool _abort{false};  //!< Flag used by the owner to force the TCPConnection thread to shut down
 
+    std::atomic_bool _cork_requested{false};  //!< Set by the owner's cork(), cleared by its uncork()
+
+    bool _corked{false};  //!< Has the TCPConnection thread corked the TCPConnection?
+
+    //! Bring the TCPConnection's cork in line with what the owner asked for
+    void _update_cork();
+
     bool _inbound_shutdown{false};  //!< Has TCPSpongeSocket shut down the incoming data to the owner?
 
     bool _outbound_shutdown{false};  //!< Has the owner shut down the outbound data to the TCP connection?
@@ -59,7 +103,9 @@ class TCPSpongeSocket : public LocalStreamSocket {
 
   public:
     //! Construct from the interface that the TCPConnection thread will use to read and write datagrams
-    explicit TCPSpongeSocket(AdaptT &&datagram_interface);
+    //! (and how its event loop polls; see EventLoop::Backend)
+    explicit TCPSpongeSocket(AdaptT &&datagram_interface,
+                             const EventLoop::Backend backend = EventLoop::Backend::Poll);
 
     //! Close socket, and wait for TCPConnection to finish
     //! \note Calling this function is only advisable if the socket has reached EOF,
@@ -72,6 +118,15 @@ class TCPSpongeSocket : public LocalStreamSocket {
     //! Listen and accept using the specified configurations; blocks until accept succeeds or fails
     void listen_and_accept(const TCPConfig &c_tcp, const FdAdapterConfig &c_ad);
 
+    //! \brief Hold back outbound data that does not fill a segment (see TCPConnection::cork())
+    //! \details Takes effect on the TCPConnection thread, before it next reads outbound data (so data
+    //! written just before the call may be held too).
+    void cork() { _cork_requested = true; }
+
+    //! \brief Send outbound data as soon as possible again, including what was held
+    //! \details Takes effect within one tick of the TCPConnection thread.
+    void uncork() { _cork_requested = false; }
+
     //! When a connected socket is destructed, it will send a RST
     ~TCPSpongeSocket();
 
@@ -17,9 +17,13 @@ TCPOverIPv4OverEthernetAdapter::TCPOverIPv4OverEthernetAdapter(TapFD &&tap,
 }
 
 optional<TCPSegment> TCPOverIPv4OverEthernetAdapter::read() {
-    // Read Ethernet frame from the raw device
+    // Read Ethernet frame from the raw device into a pooled chunk
+    _tap.read(_read_buffer);
+    string raw_frame = BufferPool::local().acquire(_read_buffer.size());
+    raw_frame.append(_read_buffer);
+
     EthernetFrame frame;
-    if (frame.parse(_tap.read()) != ParseResult::NoError) {
+    if (frame.parse(move(raw_frame)) != ParseResult::NoError) {
         return {};
     }
 
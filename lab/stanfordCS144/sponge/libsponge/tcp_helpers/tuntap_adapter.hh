@@ -13,6 +13,9 @@
 class TCPOverIPv4OverTunFdAdapter : public TCPOverIPv4Adapter {
   private:
     TunFD _tun;
+    std::string _read_buffer{};  //!< reused receive buffer
+    size_t _batch_size = 0;      //!< datagrams in the IoEngine's latest batch
+    size_t _batch_next = 0;      //!< next of them to return from read()
 
   public:
     //! Construct from a TunFD
@@ -20,15 +23,41 @@ class TCPOverIPv4OverTunFdAdapter : public TCPOverIPv4Adapter {
 
     //! Attempts to read and parse an IPv4 datagram containing a TCP segment related to the current connection
     std::optional<TCPSegment> read() {
+        std::string_view payload = _read_buffer;
+        if (io_engine() == nullptr) {
+            _tun.read(_read_buffer);
+            payload = _read_buffer;
+        } else {
+            if (_batch_next == _batch_size) {
+                _batch_size = io_engine()->read(_tun);
+                _batch_next = 0;
+                if (_batch_size == 0) {
+                    return {};
+                }
+            }
+            payload = io_engine()->payload(_batch_next++);
+        }
+        std::string datagram = BufferPool::local().acquire(payload.size());
+        datagram.append(payload);
+
         InternetDatagram ip_dgram;
-        if (ip_dgram.parse(_tun.read()) != ParseResult::NoError) {
+        if (ip_dgram.parse(std::move(datagram)) != ParseResult::NoError) {
             return {};
         }
         return unwrap_tcp_in_ip(ip_dgram);
     }
 
     //! Creates an IPv4 datagram from a TCP segment and writes it to the TUN device
-    void write(TCPSegment &seg) { _tun.write(wrap_tcp_in_ip(seg).serialize()); }
+    void write(TCPSegment &seg) {
+        if (io_engine() != nullptr) {
+            io_engine()->write(_tun, wrap_tcp_in_ip(seg).serialize());
+        } else {
+            _tun.write(wrap_tcp_in_ip(seg).serialize());
+        }
+    }
+
+    //! Are there datagrams (from the IoEngine's latest batch) that read() will return without reading the device?
+    bool pending_reads() const { return _batch_next < _batch_size; }
 
     //! Access the underlying TUN device
     operator TunFD &() { return _tun; }
@@ -43,7 +72,8 @@ using LossyTCPOverIPv4OverTunFdAdapter = LossyFdAdapter<TCPOverIPv4OverTunFdAdap
 //! \brief A FD adapter for IPv4 datagrams read from and written to a TAP device
 class TCPOverIPv4OverEthernetAdapter : public TCPOverIPv4Adapter {
   private:
-    TapFD _tap;  //!< Raw Ethernet connection
+    TapFD _tap;                  //!< Raw Ethernet connection
+    std::string _read_buffer{};  //!< reused receive buffer
 
     NetworkInterface _interface;  //!< NIC abstraction
 
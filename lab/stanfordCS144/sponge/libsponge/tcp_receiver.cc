@@ -1,5 +1,8 @@
 #include "tcp_receiver.hh"
 
+#include <algorithm>
+#include <limits>
+
 // Dummy implementation of a TCP receiver
 
 // For Lab 2, please replace with a real implementation that passes the
@@ -24,7 +27,10 @@ void TCPReceiver::segment_received(const TCPSegment &seg) {
     uint64_t checkpoint = _reassembler.stream_out().bytes_written() + 1;
     uint64_t abs_seqno = unwrap(header.seqno, _isn, checkpoint);
     uint64_t stream_index = abs_seqno - 1 + (header.syn ? 1 : 0);
-    _reassembler.push_substring(seg.payload().copy(), stream_index, header.fin);
+    _reassembler.push_substring(seg.payload(), stream_index, header.fin);
+    if (seg.payload().size() > 0) {
+        _latest = StreamReassembler::Range{stream_index, stream_index + seg.payload().size()};
+    }
 }
 
 optional<WrappingInt32> TCPReceiver::ackno() const {
@@ -36,3 +42,26 @@ optional<WrappingInt32> TCPReceiver::ackno() const {
 }
 
 size_t TCPReceiver::window_size() const { return _reassembler.stream_out().remaining_capacity(); }
+
+vector<pair<WrappingInt32, WrappingInt32>> TCPReceiver::sack_blocks(const size_t max_blocks) const {
+    vector<pair<WrappingInt32, WrappingInt32>> ret;
+    if (!_syn) {
+        return ret;
+    }
+    vector<StreamReassembler::Range> ranges = _reassembler.unassembled_ranges(numeric_limits<size_t>::max());
+    if (_latest.has_value()) {
+        const auto latest = find_if(ranges.begin(), ranges.end(), [&](const StreamReassembler::Range &range) {
+            return range.begin < _latest->end and _latest->begin < range.end;
+        });
+        if (latest != ranges.end()) {
+            rotate(ranges.begin(), latest, latest + 1);
+        }
+    }
+    ranges.resize(min(ranges.size(), max_blocks));
+
+    // stream index i has absolute sequence number i + 1 (the SYN comes first)
+    for (const auto &range : ranges) {
+        ret.emplace_back(wrap(range.begin + 1, _isn), wrap(range.end + 1, _isn));
+    }
+    return ret;
+}
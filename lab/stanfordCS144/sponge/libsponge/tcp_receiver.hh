@@ -7,6 +7,8 @@
 #include "wrapping_integers.hh"
 
 #include <optional>
+#include <utility>
+#include <vector>
 
 //! \brief The "receiver" part of a TCP implementation.
 
@@ -22,12 +24,20 @@ class TCPReceiver {
     bool _syn;
     WrappingInt32 _isn;
 
+    //! Stream indices of the payload of the most recent segment that carried one (for sack_blocks())
+    std::optional<StreamReassembler::Range> _latest{};
+
   public:
     //! \brief Construct a TCP receiver
     //!
     //! \param capacity the maximum number of bytes that the receiver will
     //!                 store in its buffers at any give time.
-    TCPReceiver(const size_t capacity) : _reassembler(capacity), _capacity(capacity), _syn(false), _isn(0) {}
+    //! \param backend the storage engine for the reassembled byte stream
+    //! \param engine the storage engine for out-of-order bytes
+    TCPReceiver(const size_t capacity,
+                const ByteStream::Backend backend = ByteStream::Backend::List,
+                const StreamReassembler::Engine engine = StreamReassembler::Engine::Map)
+        : _reassembler(capacity, backend, engine), _capacity(capacity), _syn(false), _isn(0) {}
 
     //! \name Accessors to provide feedback to the remote TCPSender
     //!@{
@@ -55,6 +65,13 @@ class TCPReceiver {
     //! \brief number of bytes stored but not yet reassembled
     size_t unassembled_bytes() const { return _reassembler.unassembled_bytes(); }
 
+    //! \brief The blocks of data received beyond a hole, for selective acknowledgment
+    //! \returns up to `max_blocks` (left edge, right edge) sequence-number pairs, or nothing if no SYN has been
+    //! received: first the block holding the most recently received segment (as [RFC 2018](\ref rfc::rfc2018),
+    //! section 4, requires, so the newest data is reported however many holes lie below it), then the others
+    //! in increasing order
+    std::vector<std::pair<WrappingInt32, WrappingInt32>> sack_blocks(const size_t max_blocks) const;
+
     //! \brief handle an inbound segment
     void segment_received(const TCPSegment &seg);
 
@@ -2,6 +2,8 @@
 
 #include "tcp_config.hh"
 
+#include <algorithm>
+#include <limits>
 #include <random>
 
 // Dummy implementation of a TCP sender
@@ -17,14 +19,37 @@ using namespace std;
 //! \param[in] capacity the capacity of the outgoing byte stream
 //! \param[in] retx_timeout the initial amount of time to wait before retransmitting the oldest outstanding segment
 //! \param[in] fixed_isn the Initial Sequence Number to use, if set (otherwise uses a random ISN)
-TCPSender::TCPSender(const size_t capacity, const uint16_t retx_timeout, const std::optional<WrappingInt32> fixed_isn)
+//! \param[in] backend the storage engine for the outgoing byte stream
+//! \param[in] mss the largest payload to put in one segment
+//! \param[in] cc the congestion control algorithm
+TCPSender::TCPSender(const size_t capacity,
+                     const uint16_t retx_timeout,
+                     const std::optional<WrappingInt32> fixed_isn,
+                     const ByteStream::Backend backend,
+                     const size_t mss,
+                     const CongestionControl::Algorithm cc)
     : _isn(fixed_isn.value_or(WrappingInt32{random_device()()}))
     , _initial_retransmission_timeout{retx_timeout}
     , _timer(retx_timeout)
-    , _stream(capacity) {}
+    , _stream(capacity, backend)
+    , _max_segment_size(max<size_t>(mss, 1))
+    , _mss(_max_segment_size)
+    , _cc(CongestionControl::make(cc, _mss)) {}
 
 uint64_t TCPSender::bytes_in_flight() const { return _bytes_in_flight; }
 
+uint64_t TCPSender::pacing_rate() const {
+    if (_cc->pacing_rate() > 0) {
+        return _cc->pacing_rate();
+    }
+    const size_t cwnd = _cc->cwnd();
+    const auto srtt = _timer.srtt();
+    if (cwnd == numeric_limits<size_t>::max() or not srtt.has_value()) {
+        return 0;
+    }
+    return 2 * uint64_t{cwnd} * 1000 / max(srtt.value(), 1U);
+}
+
 void TCPSender::fill_window() {
     if (_next_seqno == 0) {  // Status: CLOSED
         TCPSegment segment;
@@ -34,18 +59,38 @@ void TCPSender::fill_window() {
         return;
     }
 
-    size_t window_size = _window_size == 0 ? 1 : _window_size;
+    // a zero window is probed from tick(), by the persist timer
+    update_persist();
+    const size_t window_size = _window_size;
     while (window_size > _next_seqno - _abs_ackno) {
-        size_t remain = window_size - (_next_seqno - _abs_ackno);
+        const size_t flight = _next_seqno - _abs_ackno;
+        size_t remain = window_size - flight;
+        const size_t cwnd = _cc->cwnd();
+        if (cwnd < window_size) {  // the congestion window is the tighter limit
+            const size_t cwnd_room = cwnd > flight ? cwnd - flight : 0;
+            // a cwnd that is not a whole number of segments should not chop the stream into runts
+            if (cwnd_room == 0 or cwnd_room < min(_mss, _stream.buffer_size())) {
+                return;
+            }
+            remain = min(remain, cwnd_room);
+        }
+        if (_cc->pacing_rate() > 0 and _pacing_credit <= 0) {
+            return;  // tick() lets more out
+        }
+        if (hold_short_segment()) {
+            return;  // an ACK, more data, uncork() or tick() lets it out
+        }
         if (!_stream.eof()) {  // Status: SYN_ACKED
-            size_t payload_size = std::min(remain, TCPConfig::MAX_PAYLOAD_SIZE);
+            size_t payload_size = std::min(remain, _mss);
             TCPSegment segment;
-            segment.payload() = Buffer(_stream.read(payload_size));
+            segment.payload() = _stream.read_buffer(payload_size);
             // if we met eof and there is space in the window
             if (_stream.eof() && (remain - segment.length_in_sequence_space() > 0)) {
                 segment.header().fin = true;
             }
             if (segment.length_in_sequence_space() == 0) {
+                // nothing to send: rate samples until this flight is delivered understate the path
+                _app_limited_until = max<uint64_t>(_delivered + (_next_seqno - _abs_ackno), 1);
                 return;
             }
             send_no_empty_segment(segment);
@@ -60,34 +105,157 @@ void TCPSender::fill_window() {
     }
 }
 
+//! \details A short segment is one with less than an MSS of data, when that is all the stream holds and
+//! more may still be written.
+bool TCPSender::hold_short_segment() const {
+    if (_stream.buffer_size() >= _mss or _stream.input_ended() or _stream.buffer_empty()) {
+        return false;
+    }
+    if (_corked) {
+        return _time_ms - _cork_stamp < CORK_TIMEOUT_MS;
+    }
+    return _nagle and _next_seqno > _abs_ackno;
+}
+
+bool TCPSender::unsent_data() const {
+    return not _stream.buffer_empty() or (_stream.eof() and _next_seqno < _stream.bytes_written() + 2);
+}
+
+void TCPSender::update_persist() {
+    const bool probing =
+        _window_size == 0 and _abs_ackno > 0 and (not _segments_track.empty() or unsent_data());
+    if (not probing) {
+        _persist_deadline.reset();
+        if (_window_size > 0) {
+            _persist_backoff = 0;
+            if (not _segments_track.empty() and not _timer.running()) {
+                _timer.start();  // take back what a probe left outstanding
+            }
+        }
+        return;
+    }
+    // probes are neither retransmissions nor losses: the receiver is just slow to read
+    _timer.close();
+    if (not _persist_deadline.has_value()) {
+        const uint64_t interval = uint64_t{_timer.rto()} << min(_persist_backoff, 16U);
+        _persist_deadline = _time_ms + min(interval, PERSIST_MAX_MS);
+    }
+}
+
+//! \details Probing with data (rather than an empty segment) means the probe is accepted as soon as the
+//! window reopens, and an outstanding segment goes first because the receiver cannot take anything else.
+void TCPSender::send_probe() {
+    _persist_deadline.reset();
+    _unanswered_probes++;
+    if (not _segments_track.empty()) {
+        _segments_track.front().resent = true;
+        _segments_out.push(make_segment(_segments_track.front()));
+    } else {
+        TCPSegment segment;
+        if (not _stream.buffer_empty()) {
+            segment.payload() = _stream.read_buffer(PERSIST_PROBE_SIZE);
+        } else {
+            segment.header().fin = true;
+        }
+        send_no_empty_segment(segment);
+    }
+    _persist_backoff++;
+    update_persist();
+}
+
+void TCPSender::cork() {
+    if (not _corked) {
+        _corked = true;
+        _cork_stamp = _time_ms;
+    }
+}
+
+void TCPSender::uncork() {
+    _corked = false;
+    if (_next_seqno > 0) {
+        fill_window();
+    }
+}
+
 //! \param ackno The remote receiver's ackno (acknowledgment number)
-//! \param window_size The remote receiver's advertised window size
-void TCPSender::ack_received(const WrappingInt32 ackno, const uint16_t window_size) {
+//! \param window_size The remote receiver's advertised window size, in bytes (i.e. already scaled)
+//! \param sack The SACK blocks carried by the acknowledgment (empty if SACK was not negotiated)
+//! \param carries_data Whether the segment carrying the acknowledgment occupied any sequence numbers
+//! \param ts_echo The echoed timestamp carried by the acknowledgment, if timestamps are in use
+void TCPSender::ack_received(const WrappingInt32 ackno,
+                             const size_t window_size,
+                             const vector<pair<WrappingInt32, WrappingInt32>> &sack,
+                             const bool carries_data,
+                             const optional<uint32_t> ts_echo) {
     // step1: update _segments_track and window_size
     uint64_t abs_ackno = unwrap(ackno, _isn, _abs_ackno);
     // illegal abs_ackno
     if (abs_ackno > _next_seqno) {
         return;
     }
-    _window_size = static_cast<size_t>(window_size);
+    _unanswered_probes = 0;
+    const size_t old_window_size = _window_size;
+    _window_size = window_size;
+    optional<DeliveryState> newest{};
+    mark_sacked(sack, newest);
     if (abs_ackno <= _abs_ackno) {
+        sample_delivery_rate(newest);
+        // a duplicate ACK (RFC 5681, section 2) means a segment left the network (while the window is
+        // zero, ACKs only answer probes)
+        const bool dupack = abs_ackno == _abs_ackno and not carries_data and window_size == old_window_size and
+                            window_size > 0 and not _segments_track.empty();
+        if (dupack) {
+            _cc->on_dupack(_time_ms, _next_seqno - _abs_ackno);
+            // fast retransmit: the third duplicate ACK presumes the first outstanding segment lost
+            auto &front = _segments_track.front();
+            if (++_dup_acks == DUP_THRESH and not front.retransmitted and not front.sacked) {
+                retransmit(front);
+                enter_recovery();
+            }
+        }
+        // a duplicate ACK can still carry news about what arrived out of order, and a window update
+        // (e.g. reopening a zero window) lets more out
+        retransmit_lost();
+        if (dupack or (abs_ackno == _abs_ackno and window_size != old_window_size)) {
+            fill_window();
+        }
         return;
     }
 
+    const size_t bytes_acked = abs_ackno - _abs_ackno;
     _abs_ackno = abs_ackno;
-    // remove fully-acknowledged segments
-    while (!_segments_track.empty()) {
-        const auto segment = _segments_track.front();
-        uint64_t max_seg_ackno = unwrap(segment.header().seqno, _isn, _abs_ackno) + segment.length_in_sequence_space();
-        if (abs_ackno < max_seg_ackno) {
-            break;
+    _dup_acks = 0;
+    // remove fully-acknowledged segments, timing the newest one (unless it was resent: Karn's rule)
+    optional<uint64_t> rtt_ms{};
+    const size_t acked = segments_before(abs_ackno);
+    if (acked > 0) {
+        for (size_t i = 0; i < acked; i++) {
+            deliver(_segments_track[i], newest);
+        }
+        const auto &last = _segments_track[acked - 1];
+        if (not last.resent) {
+            rtt_ms = _time_ms - last.sent.time_ms;
         }
-        _segments_track.pop();
-        _bytes_in_flight -= segment.length_in_sequence_space();
+        // an echoed timestamp says when the data that prompted this ACK was sent, resent or not
+        // (RFC 7323, section 4); one from the future is bogus
+        if (ts_echo.has_value()) {
+            const uint32_t elapsed = static_cast<uint32_t>(_time_ms) - ts_echo.value();
+            rtt_ms.reset();
+            if (elapsed <= _time_ms) {
+                rtt_ms = elapsed;
+            }
+        }
+        _bytes_in_flight -= last.abs_seqno + last.length() - _segments_track.front().abs_seqno;
+        _segments_track.pop_front(acked);
     }
+    if (rtt_ms.has_value()) {
+        _timer.rtt_sample(rtt_ms.value());
+        _min_rtt = min(_min_rtt.value_or(rtt_ms.value()), rtt_ms.value());
+    }
+    const optional<uint64_t> delivery_rate = sample_delivery_rate(newest);
 
     // step 3: If there is any outstanding data, restart the retransmission timer
-    // (in start(), we also reset rto to init_rto)
+    // (in start(), we also reset rto to init_rto, or to the estimate from measured RTTs)
     // step 4: reset consecutive retransmissions to zero
     if (!_segments_track.empty()) {
         _timer.start();
@@ -95,12 +263,182 @@ void TCPSender::ack_received(const WrappingInt32 ackno, const uint16_t window_si
         _timer.close();
     }
 
+    const bool app_limited = newest.has_value() and newest->app_limited;
+    _cc->on_ack({_time_ms, abs_ackno, bytes_acked, _next_seqno - _abs_ackno, rtt_ms, delivery_rate, app_limited});
+
+    // a partial ACK during recovery means the next segment was lost too: an algorithm still in recovery
+    // (NewReno's) resends it right away, while Reno's has left recovery and waits for duplicate ACKs
+    if (_recovery_point.has_value()) {
+        if (abs_ackno >= _recovery_point.value()) {
+            _recovery_point.reset();
+        } else if (_cc->in_recovery() and not _segments_track.empty()) {
+            auto &front = _segments_track.front();
+            if (not front.retransmitted and not front.sacked) {
+                retransmit(front);
+            }
+        }
+    }
+    retransmit_lost();
+
     // The TCPSender should fill the window again if new space has opened up.
     fill_window();
 }
 
+//! \details A segment is marked once a single block covers all of it. The scoreboard is only
+//! advisory: a receiver may discard SACKed data, so SACKed segments stay outstanding until
+//! they are cumulatively acknowledged.
+void TCPSender::mark_sacked(const vector<pair<WrappingInt32, WrappingInt32>> &sack,
+                            optional<DeliveryState> &newest) {
+    for (const auto &[left, right] : sack) {
+        const uint64_t begin = unwrap(left, _isn, _abs_ackno);
+        const uint64_t end = unwrap(right, _isn, _abs_ackno);
+        if (begin >= end or end > _next_seqno) {
+            continue;  // malformed or acknowledges data never sent
+        }
+        for (size_t i = segments_before(begin); i < _segments_track.size(); i++) {
+            auto &outstanding = _segments_track[i];
+            if (outstanding.abs_seqno + outstanding.length() > end) {
+                break;
+            }
+            if (outstanding.abs_seqno >= begin) {
+                outstanding.sacked = true;
+                deliver(outstanding, newest);
+            }
+        }
+    }
+}
+
+size_t TCPSender::segments_before(const uint64_t abs_seqno) const {
+    size_t lo = 0;
+    size_t hi = _segments_track.size();
+    while (lo < hi) {
+        const size_t mid = lo + (hi - lo) / 2;
+        const auto &outstanding = _segments_track[mid];
+        if (outstanding.abs_seqno + outstanding.length() <= abs_seqno) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+TCPSegment TCPSender::make_segment(const OutstandingSegment &outstanding) const {
+    TCPSegment segment;
+    segment.header().seqno = wrap(outstanding.abs_seqno, _isn);
+    segment.header().syn = outstanding.syn;
+    segment.header().fin = outstanding.fin;
+    segment.payload() = outstanding.payload;
+    return segment;
+}
+
+void TCPSender::deliver(OutstandingSegment &outstanding, optional<DeliveryState> &newest) {
+    if (outstanding.delivered) {
+        return;  // SACKed earlier
+    }
+    outstanding.delivered = true;
+    _delivered += outstanding.length();
+    _delivered_at = _time_ms;
+    if (_app_limited_until > 0 and _delivered > _app_limited_until) {
+        _app_limited_until = 0;
+    }
+    // a resent segment's delivery cannot be matched to one of its sends
+    if (not outstanding.resent and (not newest.has_value() or outstanding.sent.time_ms >= newest->time_ms)) {
+        newest = outstanding.sent;
+    }
+}
+
+//! \details The rate is the data delivered between the sends of the newest delivered segment and the
+//! segment whose delivery preceded it, over the longer of the send and the ACK intervals (so neither
+//! a burst of sends nor a burst of ACKs inflates it).
+optional<uint64_t> TCPSender::sample_delivery_rate(const optional<DeliveryState> &newest) {
+    if (not newest.has_value()) {
+        return {};
+    }
+    _first_sent_at = newest->time_ms;
+    const uint64_t send_elapsed = newest->time_ms - newest->first_sent_at;
+    const uint64_t ack_elapsed = _delivered_at - newest->delivered_at;
+    // the clock ticks in milliseconds: a shorter interval counts as one
+    const uint64_t interval = max<uint64_t>({send_elapsed, ack_elapsed, 1});
+    if (_min_rtt.has_value() and interval < _min_rtt.value()) {
+        return {};  // compressed ACKs: the interval is too short to mean anything
+    }
+    _delivery_rate = (_delivered - newest->delivered) * 1000 / interval;
+    return _delivery_rate;
+}
+
+//! \details Following [RFC 6675](\ref rfc::rfc6675), a hole is presumed lost once DUP_THRESH
+//! SACKed segments lie above it. Each lost segment is resent once per timeout, and the
+//! congestion control algorithm hears of the loss.
+void TCPSender::retransmit_lost() {
+    size_t sacked_above = 0;
+    for (const auto &outstanding : _segments_track) {
+        sacked_above += outstanding.sacked;
+    }
+
+    bool resent = false;
+    for (auto &outstanding : _segments_track) {
+        if (sacked_above < DUP_THRESH) {
+            break;
+        }
+        if (outstanding.sacked) {
+            sacked_above--;
+        } else if (not outstanding.retransmitted) {
+            retransmit(outstanding);
+            resent = true;
+        }
+    }
+
+    if (resent) {
+        enter_recovery();
+    }
+}
+
+void TCPSender::retransmit(OutstandingSegment &outstanding) {
+    outstanding.retransmitted = true;
+    outstanding.resent = true;
+    _segments_out.push(make_segment(outstanding));
+}
+
+//! \details The congestion control algorithm hears of the first loss of an episode only: the losses that
+//! follow, up to the recovery point, belong to the same congestion event.
+void TCPSender::enter_recovery() {
+    if (not _recovery_point.has_value()) {
+        _recovery_point = _next_seqno;
+        _cc->on_loss(_time_ms, _next_seqno - _abs_ackno, _next_seqno);
+    }
+}
+
+//! \details At least one byte of payload fits, however many bytes of options there are.
+void TCPSender::update_mss() {
+    _mss = _max_segment_size > _options_length ? _max_segment_size - _options_length : 1;
+    _cc->set_mss(_mss);
+}
+
 //! \param[in] ms_since_last_tick the number of milliseconds since the last call to this method
 void TCPSender::tick(const size_t ms_since_last_tick) {
+    _time_ms += ms_since_last_tick;
+
+    // pacing: earn credit at the algorithm's rate, and spend it on whatever the window allows
+    const uint64_t pacing_rate = _cc->pacing_rate();
+    if (pacing_rate > 0) {
+        const auto refill = static_cast<int64_t>(pacing_rate * ms_since_last_tick / 1000);
+        _pacing_credit = min(_pacing_credit + refill, max(refill, static_cast<int64_t>(PACING_BURST * _mss)));
+        if (_next_seqno > 0) {
+            fill_window();
+        }
+    }
+
+    // a corked sender lets a short segment out once it has waited long enough
+    if (_corked and _next_seqno > 0 and _time_ms - _cork_stamp >= CORK_TIMEOUT_MS) {
+        fill_window();
+    }
+
+    // probe a zero window
+    if (_persist_deadline.has_value() and _time_ms >= _persist_deadline.value()) {
+        send_probe();
+    }
+
     // do following steps only if the retransmission timer has expired
     if (!_timer.running() || !_timer.timeout(ms_since_last_tick)) {
         return;
@@ -111,13 +449,40 @@ void TCPSender::tick(const size_t ms_since_last_tick) {
         _timer.close();
         return;
     }
-    _segments_out.push(_segments_track.front());
+    // the receiver may have discarded what it SACKed, so forget the scoreboard (RFC 2018, section 8)
+    for (auto &outstanding : _segments_track) {
+        outstanding.sacked = false;
+        outstanding.retransmitted = false;
+    }
+    _dup_acks = 0;
+    _recovery_point.reset();
+    _segments_track.front().resent = true;
+    _segments_out.push(make_segment(_segments_track.front()));
+    _cc->on_rto(_time_ms, _next_seqno - _abs_ackno);
 
     // step 2: Reset the retransmission timer
-    //  2.1 double rto if window_size is non zero
+    //  2.1 double rto
     //  2.2 increase _consecutive_retransmissions
-    // _timer.reset_timer(_window_size, _next_seqno == _bytes_in_flight);
-    _timer.reset_timer(_window_size);
+    _timer.reset_timer();
+}
+
+optional<uint64_t> TCPSender::next_timeout() const {
+    optional<uint64_t> next{};
+    const auto sooner = [&next](const uint64_t ms) { next = min(next.value_or(ms), ms); };
+    if (_timer.running()) {
+        sooner(_timer.time_left());
+    }
+    if (_persist_deadline.has_value()) {
+        sooner(_persist_deadline.value() > _time_ms ? _persist_deadline.value() - _time_ms : 0);
+    }
+    if (_corked and _next_seqno > 0 and hold_short_segment()) {
+        sooner(CORK_TIMEOUT_MS - (_time_ms - _cork_stamp));
+    }
+    // (credit is earned tick by tick, so a paced sender with data waiting ticks every millisecond)
+    if (_cc->pacing_rate() > 0 and _next_seqno > 0 and unsent_data()) {
+        sooner(1);
+    }
+    return next;
 }
 
 unsigned int TCPSender::consecutive_retransmissions() const { return _timer.consecutive_retransmissions(); }
@@ -130,11 +495,27 @@ void TCPSender::send_empty_segment() {
 
 void TCPSender::send_no_empty_segment(TCPSegment &segment) {
     segment.header().seqno = next_seqno();
+    if (_segments_track.empty()) {
+        // nothing in flight: the next rate sample's interval starts now, not at the last delivery
+        _first_sent_at = _delivered_at = _time_ms;
+    }
+    if (_cc->pacing_rate() > 0) {
+        _pacing_credit -= static_cast<int64_t>(segment.length_in_sequence_space());
+    }
+    if (_corked and segment.payload().size() < _mss) {
+        _cork_stamp = _time_ms;  // the next short segment waits its own CORK_TIMEOUT_MS
+    }
+    OutstandingSegment outstanding{};
+    outstanding.abs_seqno = _next_seqno;
+    outstanding.payload = segment.payload();
+    outstanding.syn = segment.header().syn;
+    outstanding.fin = segment.header().fin;
+    outstanding.sent = {_time_ms, _delivered, _delivered_at, _first_sent_at, _app_limited_until > 0};
+    _segments_track.push_back(move(outstanding));
     _next_seqno += segment.length_in_sequence_space();
     _bytes_in_flight += segment.length_in_sequence_space();
     _segments_out.push(segment);
-    _segments_track.push(segment);
-    if (!_timer.running()) {
+    if (!_timer.running() and not _persist_deadline.has_value() and _window_size > 0) {
         _timer.start();
     }
 }
@@ -2,12 +2,19 @@
 #define SPONGE_LIBSPONGE_TCP_SENDER_HH
 
 #include "byte_stream.hh"
+#include "congestion_control.hh"
+#include "ring_queue.hh"
 #include "tcp_config.hh"
 #include "tcp_segment.hh"
 #include "wrapping_integers.hh"
 
+#include <algorithm>
 #include <functional>
+#include <memory>
+#include <optional>
 #include <queue>
+#include <utility>
+#include <vector>
 
 // !
 class RetransmissionTimer {
@@ -18,9 +25,21 @@ class RetransmissionTimer {
     unsigned int _rto;
     unsigned int _consecutive_retransmissions{0};
 
+    //! \name Round-trip time estimation ([RFC 6298](\ref rfc::rfc6298))
+    //!@{
+    static constexpr uint64_t GRANULARITY_US = 1000;  //!< clock granularity (G): the sender ticks in milliseconds
+    bool _adaptive{false};                            //!< derive the RTO from the estimate (else keep _init_rto)
+    unsigned int _min_rto{0};                         //!< lower bound for an adaptive RTO
+    unsigned int _max_rto{0};                         //!< upper bound for an adaptive RTO, also after backoff
+    unsigned int _base_rto;                           //!< the RTO a (re)started timer begins with
+    bool _have_rtt{false};                            //!< has any round-trip time been measured?
+    uint64_t _srtt_us{0};                             //!< smoothed round-trip time (SRTT), in microseconds
+    uint64_t _rttvar_us{0};                           //!< round-trip time variation (RTTVAR), in microseconds
+    //!@}
+
   public:
     RetransmissionTimer(const unsigned int retx_timeout)
-        : _running(false), _init_rto(retx_timeout), _ms_since_running(0), _rto(retx_timeout) {}
+        : _running(false), _init_rto(retx_timeout), _ms_since_running(0), _rto(retx_timeout), _base_rto(retx_timeout) {}
     bool timeout(const size_t ms_since_last_tick) {
         if (_ms_since_running + ms_since_last_tick >= _rto) {
             return true;
@@ -28,27 +47,26 @@ class RetransmissionTimer {
         _ms_since_running += ms_since_last_tick;
         return false;
     }
-    bool running() { return _running; }
-    // void reset_timer(const size_t window_size, const bool syn_sent) {
-    void reset_timer(const size_t window_size) {
+    bool running() const { return _running; }
+
+    //! Milliseconds of ticks until the timer expires (if it is running)
+    unsigned int time_left() const { return _rto > _ms_since_running ? _rto - _ms_since_running : 0; }
+    //! Restart after a retransmission, doubling the RTO (a zero window is the persist timer's business)
+    void reset_timer() {
         if (!running()) {
             return;  // this line should never be executed
         }
         _ms_since_running = 0;
         ++_consecutive_retransmissions;
-        // If the window size is nonzero, Double the value of RTO
-        if (window_size > 0) {
-            _rto <<= 1;
+        _rto <<= 1;
+        if (_adaptive) {
+            _rto = std::min(_rto, _max_rto);
         }
-
-        // if (syn_sent && _rto < 3000) {
-        //     _rto = 3000;
-        // }
     }
     void start() {
         _running = true;
         _ms_since_running = 0;
-        _rto = _init_rto;
+        _rto = _base_rto;
         _consecutive_retransmissions = 0;
     }
     void close() {
@@ -56,6 +74,45 @@ class RetransmissionTimer {
         _consecutive_retransmissions = 0;
     }
     unsigned int consecutive_retransmissions() const { return _consecutive_retransmissions; };
+
+    //! Derive the RTO from measured round-trip times from now on, within [min_rto, max_rto] milliseconds
+    void adapt(const unsigned int min_rto, const unsigned int max_rto) {
+        _adaptive = true;
+        _min_rto = min_rto;
+        _max_rto = std::max(min_rto, max_rto);
+        _base_rto = std::clamp(_base_rto, _min_rto, _max_rto);
+    }
+
+    //! Feed one round-trip time measurement (which must not come from a retransmitted segment)
+    void rtt_sample(const uint64_t rtt_ms) {
+        const uint64_t rtt_us = rtt_ms * 1000;
+        if (not _have_rtt) {
+            _have_rtt = true;
+            _srtt_us = rtt_us;
+            _rttvar_us = rtt_us / 2;
+        } else {
+            const uint64_t error_us = _srtt_us > rtt_us ? _srtt_us - rtt_us : rtt_us - _srtt_us;
+            _rttvar_us = (3 * _rttvar_us + error_us) / 4;
+            _srtt_us = (7 * _srtt_us + rtt_us) / 8;
+        }
+
+        if (_adaptive) {
+            const uint64_t rto_us = _srtt_us + std::max(GRANULARITY_US, 4 * _rttvar_us);
+            const uint64_t rto_ms = (rto_us + 999) / 1000;
+            _base_rto = static_cast<unsigned int>(std::clamp<uint64_t>(rto_ms, _min_rto, _max_rto));
+        }
+    }
+
+    //! Smoothed round-trip time in milliseconds, if any round trip has been measured
+    std::optional<unsigned int> srtt() const {
+        if (not _have_rtt) {
+            return {};
+        }
+        return static_cast<unsigned int>((_srtt_us + 500) / 1000);
+    }
+
+    //! Current retransmission timeout in milliseconds (including any backoff)
+    unsigned int rto() const { return _running ? _rto : _base_rto; }
 };
 
 //! \brief The "sender" part of a TCP implementation.
@@ -71,7 +128,38 @@ class TCPSender {
 
     //! outbound queue of segments that the TCPSender wants sent
     std::queue<TCPSegment> _segments_out{};
-    std::queue<TCPSegment> _segments_track{};
+
+    //! The sender's state when a segment was first sent, from which its delivery yields a rate sample
+    struct DeliveryState {
+        uint64_t time_ms = 0;        //!< value of `_time_ms`
+        uint64_t delivered = 0;      //!< value of `_delivered`
+        uint64_t delivered_at = 0;   //!< value of `_delivered_at`
+        uint64_t first_sent_at = 0;  //!< value of `_first_sent_at`
+        bool app_limited = false;    //!< whether the sender was app-limited
+    };
+
+    //! \brief A segment that has been sent but not yet cumulatively acknowledged
+    //! \details Only what the sender decided is kept: the payload is a reference to the bytes taken from
+    //! the stream (shared with the segment that was sent), and the header is rebuilt for a retransmission.
+    struct OutstandingSegment {
+        uint64_t abs_seqno = 0;      //!< absolute seqno of its first byte
+        Buffer payload{};            //!< its payload
+        bool syn = false;            //!< it carried SYN
+        bool fin = false;            //!< it carried FIN
+        bool sacked = false;         //!< the receiver has reported holding it in a SACK block
+        bool retransmitted = false;  //!< resent as lost since the last timeout
+        bool resent = false;         //!< resent at all (so its ACK cannot be timed, by Karn's rule)
+        bool delivered = false;      //!< counted in `_delivered`
+        DeliveryState sent{};        //!< the sender's state when it was first sent
+
+        //! sequence numbers it occupies
+        size_t length() const { return payload.size() + syn + fin; }
+    };
+
+    //! \brief The scoreboard: outstanding segments in sequence order
+    //! \details Their sequence numbers are contiguous, so the segment holding a given seqno is found by a
+    //! binary search (segments_before()), and a cumulative ACK releases its whole range with one pop_front().
+    RingQueue<OutstandingSegment> _segments_track{};
 
     //! retransmission timer for the connection
     unsigned int _initial_retransmission_timeout;
@@ -83,16 +171,121 @@ class TCPSender {
     //! the (absolute) sequence number for the next byte to be sent
     uint64_t _next_seqno{0};
     uint64_t _abs_ackno{0};
-    uint16_t _window_size{1};
+    size_t _window_size{1};
     uint64_t _bytes_in_flight{0};
 
+    //! largest payload plus options to put in one segment (the MSS, as negotiated)
+    size_t _max_segment_size;
+
+    //! bytes of options every segment after the SYN carries
+    size_t _options_length{0};
+
+    //! largest payload to put in one segment: the MSS less `_options_length`
+    size_t _mss;
+
+    //! milliseconds of ticks since the sender was created (timestamps segments for RTT measurement)
+    uint64_t _time_ms{0};
+
+    //! congestion control algorithm: bounds the bytes in flight alongside the receiver's window
+    std::unique_ptr<CongestionControl> _cc;
+
+    //! \name Delivery rate estimation (draft-cheng-iccrg-delivery-rate-estimation)
+    //!@{
+    uint64_t _delivered{0};                    //!< sequence numbers cumulatively acknowledged or SACKed
+    uint64_t _delivered_at{0};                 //!< value of `_time_ms` when `_delivered` last grew
+    uint64_t _first_sent_at{0};                //!< send time of the newest segment in the latest rate sample
+    uint64_t _app_limited_until{0};            //!< `_delivered` beyond which sends are no longer app-limited
+    std::optional<uint64_t> _delivery_rate{};  //!< latest rate sample, in bytes per second
+    std::optional<uint64_t> _min_rtt{};        //!< smallest round-trip time measured, in milliseconds
+    //!@}
+
+    //! bytes that may still be sent before pacing holds the sender back (only when the algorithm paces)
+    int64_t _pacing_credit{0};
+
+    //! \name Fast retransmit and fast recovery ([RFC 5681](\ref rfc::rfc5681), [RFC 6582](\ref rfc::rfc6582))
+    //!@{
+    size_t _dup_acks{0};                        //!< duplicate ACKs since the ackno last advanced
+    std::optional<uint64_t> _recovery_point{};  //!< while recovering from a loss, the seqno that ends recovery
+    //!@}
+
+    //! \name Coalescing small writes
+    //!@{
+    bool _nagle{false};       //!< hold back a short segment while data is unacknowledged (RFC 896)
+    bool _corked{false};      //!< hold back short segments until uncork() (or CORK_TIMEOUT_MS)
+    uint64_t _cork_stamp{0};  //!< `_time_ms` when the sender was corked or last sent a short segment
+    //!@}
+
+    //! \name Persist timer: probing a zero window ([RFC 9293](\ref rfc::rfc9293) 3.8.6.1)
+    //! While the peer's window is zero, the persist timer stands in for the retransmission timer
+    //!@{
+    std::optional<uint64_t> _persist_deadline{};  //!< `_time_ms` at which the next probe is due (empty: not running)
+    unsigned int _persist_backoff{0};             //!< doublings of the probe interval since the window closed
+    unsigned int _unanswered_probes{0};           //!< probes sent since an acknowledgment last arrived
+    //!@}
+
+    //! Should fill_window() wait for more data before sending what the stream holds?
+    bool hold_short_segment() const;
+
+    //! Is there data (or a FIN) that has not been sent yet?
+    bool unsent_data() const;
+
+    //! Start the persist timer if the window is zero and there is something to send, or stop it
+    void update_persist();
+
+    //! Send a zero-window probe: the oldest outstanding segment, or else PERSIST_PROBE_SIZE new bytes
+    void send_probe();
+
     void send_no_empty_segment(TCPSegment &segment);
 
+    //! Number of outstanding segments that end at or before `abs_seqno`
+    size_t segments_before(const uint64_t abs_seqno) const;
+
+    //! The segment to put on the wire for `outstanding`
+    TCPSegment make_segment(const OutstandingSegment &outstanding) const;
+    void mark_sacked(const std::vector<std::pair<WrappingInt32, WrappingInt32>> &sack,
+                     std::optional<DeliveryState> &newest);
+    void retransmit_lost();
+
+    //! Resend a segment presumed lost
+    void retransmit(OutstandingSegment &outstanding);
+
+    //! Derive the largest payload from the MSS and the options, and tell the congestion control
+    void update_mss();
+
+    //! Start recovery from a loss, unless it is under way, and tell the congestion control
+    void enter_recovery();
+
+    //! Count `outstanding` as delivered, keeping in `newest` the state of the most recently sent such segment
+    void deliver(OutstandingSegment &outstanding, std::optional<DeliveryState> &newest);
+
+    //! Take a delivery rate sample ending at the segment whose state is `newest`
+    std::optional<uint64_t> sample_delivery_rate(const std::optional<DeliveryState> &newest);
+
   public:
+    //! \brief Number of SACKed segments above an unacknowledged one, or of duplicate ACKs, before it
+    //! is considered lost
+    //! \details The duplicate-ACK threshold of [RFC 5681](\ref rfc::rfc5681) and [RFC 6675](\ref rfc::rfc6675)
+    static constexpr size_t DUP_THRESH = 3;
+
+    //! \brief Segments a pacing sender may send back to back after being held back
+    static constexpr size_t PACING_BURST = 2;
+
+    //! \brief Longest a corked sender holds back a short segment, in milliseconds (as Linux's TCP_CORK)
+    static constexpr uint64_t CORK_TIMEOUT_MS = 200;
+
+    //! \brief Most new bytes a zero-window probe puts in flight
+    static constexpr size_t PERSIST_PROBE_SIZE = 1;
+
+    //! \brief Longest interval between zero-window probes, in milliseconds
+    static constexpr uint64_t PERSIST_MAX_MS = 60000;
+
     //! Initialize a TCPSender
     TCPSender(const size_t capacity = TCPConfig::DEFAULT_CAPACITY,
               const uint16_t retx_timeout = TCPConfig::TIMEOUT_DFLT,
-              const std::optional<WrappingInt32> fixed_isn = {});
+              const std::optional<WrappingInt32> fixed_isn = {},
+              const ByteStream::Backend backend = ByteStream::Backend::List,
+              const size_t mss = TCPConfig::MAX_PAYLOAD_SIZE,
+              const CongestionControl::Algorithm cc = CongestionControl::Algorithm::None);
 
     //! \name "Input" interface for the writer
     //!@{
@@ -100,11 +293,46 @@ class TCPSender {
     const ByteStream &stream_in() const { return _stream; }
     //!@}
 
+    //! \brief Lower the MSS (e.g. to the one the peer announced)
+    void limit_mss(const size_t mss) {
+        _max_segment_size = std::min(_max_segment_size, std::max<size_t>(mss, 1));
+        update_mss();
+    }
+
+    //! \brief Set the bytes of options every segment after the SYN will carry (e.g. timestamps, once negotiated)
+    //! \details As RFC 6691 has it, they come out of the MSS, and the payload shrinks.
+    void set_options_length(const size_t options_length) {
+        _options_length = options_length;
+        update_mss();
+    }
+
+    //! \brief The MSS: largest payload plus options per segment
+    size_t max_segment_size() const { return _max_segment_size; }
+
+    //! \brief Largest payload per segment: the MSS less the options every segment carries
+    size_t mss() const { return _mss; }
+
+    //! \brief Derive the retransmission timeout from measured round-trip times, within [min_rto, max_rto] ms
+    //! \details Without this, every (re)started timer begins at the initial `retx_timeout`.
+    void adapt_rto(const unsigned int min_rto, const unsigned int max_rto) { _timer.adapt(min_rto, max_rto); }
+
+    //! \brief Enable or disable Nagle's algorithm ([RFC 896](\ref rfc::rfc896))
+    //! \details While enabled, less than a full segment of data is not sent as long as earlier data is
+    //! unacknowledged, so a run of small writes goes out as full segments (or with the next ACK).
+    void set_nagle(const bool enabled) { _nagle = enabled; }
+
     //! \name Methods that can cause the TCPSender to send a segment
     //!@{
 
-    //! \brief A new acknowledgment was received
-    void ack_received(const WrappingInt32 ackno, const uint16_t window_size);
+    //! \brief A new acknowledgment was received, optionally with [SACK](\ref rfc::rfc2018) blocks
+    //! \details `carries_data` tells whether the segment occupied sequence numbers (so it is not a duplicate
+    //! ACK). `ts_echo` is the segment's echoed timestamp (TSecr), a time_ms() value, if timestamps
+    //! ([RFC 7323](\ref rfc::rfc7323)) are in use: it times the ACK even when the data it covers was resent.
+    void ack_received(const WrappingInt32 ackno,
+                      const size_t window_size,
+                      const std::vector<std::pair<WrappingInt32, WrappingInt32>> &sack = {},
+                      const bool carries_data = false,
+                      const std::optional<uint32_t> ts_echo = {});
 
     //! \brief Generate an empty-payload segment (useful for creating empty ACK segments)
     void send_empty_segment();
@@ -112,6 +340,14 @@ class TCPSender {
     //! \brief create and send segments to fill as much of the window as possible
     void fill_window();
 
+    //! \brief Send only full segments until uncork(), like Linux's TCP_CORK
+    //! \details Data that does not fill a segment is held back for at most CORK_TIMEOUT_MS. Ending the
+    //! stream sends whatever is held, with the FIN.
+    void cork();
+
+    //! \brief Stop holding back short segments, and send what was held
+    void uncork();
+
     //! \brief Notifies the TCPSender of the passage of time
     void tick(const size_t ms_since_last_tick);
     //!@}
@@ -125,8 +361,43 @@ class TCPSender {
     size_t bytes_in_flight() const;
 
     //! \brief Number of consecutive retransmissions that have occurred in a row
+    //! \note Zero-window probes are not retransmissions: see unanswered_probes()
     unsigned int consecutive_retransmissions() const;
 
+    //! \brief Number of zero-window probes sent since an acknowledgment last arrived
+    unsigned int unanswered_probes() const { return _unanswered_probes; }
+
+    //! \brief Is the persist timer running (the window is zero and there is data to send)?
+    bool persisting() const { return _persist_deadline.has_value(); }
+
+    //! \brief Smoothed round-trip time in milliseconds (empty until a round trip has been measured)
+    std::optional<unsigned int> srtt() const { return _timer.srtt(); }
+
+    //! \brief Current retransmission timeout in milliseconds
+    unsigned int rto() const { return _timer.rto(); }
+
+    //! \brief Milliseconds of ticks so far (the clock for timestamps)
+    uint64_t time_ms() const { return _time_ms; }
+
+    //! \brief Milliseconds of ticks until tick() next has something to do (empty: not until another event)
+    //! \details A timer expires (retransmission, persist, cork), or pacing credit lets held data out.
+    std::optional<uint64_t> next_timeout() const;
+
+    //! \brief Latest delivery rate sample in bytes per second (empty until data has been acknowledged)
+    std::optional<uint64_t> delivery_rate() const { return _delivery_rate; }
+
+    //! \brief Smallest round-trip time measured, in milliseconds
+    std::optional<uint64_t> min_rtt() const { return _min_rtt; }
+
+    //! \brief The congestion control algorithm in use
+    const CongestionControl &congestion_control() const { return *_cc; }
+
+    //! \brief Rate at which to put segments on the wire, in bytes per second (0: no limit)
+    //! \details The algorithm's own pacing rate if it has one. Otherwise, once the RTT is known, twice the
+    //! congestion window per round trip: a window is spread over half the RTT, which still lets slow start
+    //! double it every round.
+    uint64_t pacing_rate() const;
+
     //! \brief TCPSegments that the TCPSender has enqueued for transmission.
     //! \note These must be dequeued and sent by the TCPConnection,
     //! which will need to fill in the fields that are set by the TCPReceiver
@@ -7,15 +7,31 @@ void Buffer::remove_prefix(const size_t n) {
         throw out_of_range("Buffer::remove_prefix");
     }
     _starting_offset += n;
-    if (_storage and _starting_offset == _storage->size()) {
+    if (_storage and str().empty()) {
         _storage.reset();
     }
 }
 
+void Buffer::remove_suffix(const size_t n) {
+    if (n > str().size()) {
+        throw out_of_range("Buffer::remove_suffix");
+    }
+    _ending_trim += n;
+    if (_storage and str().empty()) {
+        _storage.reset();
+    }
+}
+
+void BufferList::append(Buffer buffer) {
+    _size += buffer.size();
+    _buffers.push_back(move(buffer));
+}
+
 void BufferList::append(const BufferList &other) {
     for (const auto &buf : other._buffers) {
         _buffers.push_back(buf);
     }
+    _size += other._size;
 }
 
 BufferList::operator Buffer() const {
@@ -41,8 +57,7 @@ string BufferList::concatenate() const {
 }
 
 string BufferList::concatenate(size_t n) const {
-    std::string ret;
-    ret.reserve(n);
+    std::string ret = BufferPool::local().acquire(n);
     for (const auto &buf : _buffers) {
         if (ret.size() + buf.size() <= n) {
             ret.append(buf);
@@ -53,15 +68,11 @@ string BufferList::concatenate(size_t n) const {
     return ret;
 }
 
-size_t BufferList::size() const {
-    size_t ret = 0;
-    for (const auto &buf : _buffers) {
-        ret += buf.size();
-    }
-    return ret;
-}
-
 void BufferList::remove_prefix(size_t n) {
+    if (n > _size) {
+        throw std::out_of_range("BufferList::remove_prefix");
+    }
+    _size -= n;
     while (n > 0) {
         if (_buffers.empty()) {
             throw std::out_of_range("BufferList::remove_prefix");
@@ -81,9 +92,21 @@ BufferViewList::BufferViewList(const BufferList &buffers) {
     for (const auto &x : buffers.buffers()) {
         _views.push_back(x);
     }
+    _size = buffers.size();
+}
+
+void BufferViewList::append(std::string_view str) {
+    if (not str.empty()) {
+        _views.push_back(str);
+        _size += str.size();
+    }
 }
 
 void BufferViewList::remove_prefix(size_t n) {
+    if (n > _size) {
+        throw std::out_of_range("BufferListView::remove_prefix");
+    }
+    _size -= n;
     while (n > 0) {
         if (_views.empty()) {
             throw std::out_of_range("BufferListView::remove_prefix");
@@ -99,14 +122,6 @@ void BufferViewList::remove_prefix(size_t n) {
     }
 }
 
-size_t BufferViewList::size() const {
-    size_t ret = 0;
-    for (const auto &buf : _views) {
-        ret += buf.size();
-    }
-    return ret;
-}
-
 vector<iovec> BufferViewList::as_iovecs() const {
     vector<iovec> ret;
     ret.reserve(_views.size());
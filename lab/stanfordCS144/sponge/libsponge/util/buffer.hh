@@ -1,14 +1,17 @@
 #ifndef SPONGE_LIBSPONGE_BUFFER_HH
 #define SPONGE_LIBSPONGE_BUFFER_HH
 
+#include "buffer_pool.hh"
+#include "small_queue.hh"
+
 #include <algorithm>
-#include <deque>
 #include <memory>
 #include <numeric>
 #include <stdexcept>
 #include <string>
 #include <string_view>
 #include <sys/uio.h>
+#include <utility>
 #include <vector>
 
 //! \brief A reference-counted read-only string that can discard bytes from the front
@@ -16,12 +19,14 @@ class Buffer {
   private:
     std::shared_ptr<std::string> _storage{};
     size_t _starting_offset{};
+    size_t _ending_trim{};  //!< bytes at the end of `_storage` that are not part of this Buffer
 
   public:
     Buffer() = default;
 
     //! \brief Construct by taking ownership of a string
-    Buffer(std::string &&str) noexcept : _storage(std::make_shared<std::string>(std::move(str))) {}
+    //! \note The string's storage is released to the BufferPool once no Buffer refers to it
+    Buffer(std::string &&str) noexcept : _storage(BufferPool::make_shared(std::move(str))) {}
 
     //! \name Expose contents as a std::string_view
     //!@{
@@ -29,7 +34,7 @@ class Buffer {
         if (not _storage) {
             return {};
         }
-        return {_storage->data() + _starting_offset, _storage->size() - _starting_offset};
+        return {_storage->data() + _starting_offset, _storage->size() - _starting_offset - _ending_trim};
     }
 
     operator std::string_view() const { return str(); }
@@ -47,6 +52,11 @@ class Buffer {
     //! \brief Discard the first `n` bytes of the string (does not require a copy or move)
     //! \note Doesn't free any memory until the whole string has been discarded in all copies of the Buffer.
     void remove_prefix(const size_t n);
+
+    //! \brief Discard the last `n` bytes of the string (does not require a copy or move)
+    //! \note Lets a Buffer refer to a slice of storage it shares with others (e.g. a segment's payload
+    //! inside a ByteStream's chunk).
+    void remove_suffix(const size_t n);
 };
 
 //! \brief A reference-counted discontiguous string that can discard bytes from the front
@@ -55,8 +65,13 @@ class Buffer {
 //! encapsulate a TCP payload in a TCPSegment, and then encapsulate
 //! the TCPSegment in an IPv4Datagram) without copying the payload.
 class BufferList {
+  public:
+    //! Fragments of a BufferList; headers + payload fit without allocating
+    using Fragments = SmallQueue<Buffer, 3>;
+
   private:
-    std::deque<Buffer> _buffers{};
+    Fragments _buffers{};
+    size_t _size{0};  //!< total bytes in `_buffers`
 
   public:
     //! \name Constructors
@@ -65,17 +80,39 @@ class BufferList {
     BufferList() = default;
 
     //! \brief Construct from a Buffer
-    BufferList(Buffer buffer) : _buffers{buffer} {}
+    BufferList(Buffer buffer) { append(std::move(buffer)); }
 
     //! \brief Construct by taking ownership of a std::string
-    BufferList(std::string &&str) noexcept {
-        Buffer buf{std::move(str)};
-        append(buf);
+    BufferList(std::string &&str) noexcept { append(Buffer{std::move(str)}); }
+    //!@}
+
+    //! \name Copy/move constructor/assignment operators
+    //! A moved-from BufferList is empty
+    //!@{
+    BufferList(const BufferList &other) = default;
+    BufferList &operator=(const BufferList &other) = default;
+    BufferList(BufferList &&other) noexcept : _buffers(std::move(other._buffers)), _size(other._size) {
+        other._size = 0;
+    }
+    BufferList &operator=(BufferList &&other) noexcept {
+        if (this != &other) {
+            _buffers = std::move(other._buffers);
+            _size = std::exchange(other._size, 0);
+        }
+        return *this;
     }
     //!@}
 
+    ~BufferList() = default;
+
     //! \brief Access the underlying queue of Buffers
-    const std::deque<Buffer> &buffers() const { return _buffers; }
+    const Fragments &buffers() const { return _buffers; }
+
+    //! \brief Append a Buffer
+    void append(Buffer buffer);
+
+    //! \brief Append a std::string, taking ownership of it
+    void append(std::string &&str) { append(Buffer{std::move(str)}); }
 
     //! \brief Append a BufferList
     void append(const BufferList &other);
@@ -88,7 +125,7 @@ class BufferList {
     void remove_prefix(size_t n);
 
     //! \brief Size of the string
-    size_t size() const;
+    size_t size() const { return _size; }
 
     //! \brief Make a copy to a new std::string
     std::string concatenate() const;
@@ -97,12 +134,15 @@ class BufferList {
 
 //! \brief A non-owning temporary view (similar to std::string_view) of a discontiguous string
 class BufferViewList {
-    std::deque<std::string_view> _views{};
+    SmallQueue<std::string_view, 3> _views{};
+    size_t _size{0};  //!< total bytes in `_views`
 
   public:
     //! \name Constructors
     //!@{
 
+    BufferViewList() = default;
+
     //! \brief Construct from a std::string
     BufferViewList(const std::string &str) : BufferViewList(std::string_view(str)) {}
 
@@ -113,14 +153,17 @@ class BufferViewList {
     BufferViewList(const BufferList &buffers);
 
     //! \brief Construct from a std::string_view
-    BufferViewList(std::string_view str) { _views.push_back({const_cast<char *>(str.data()), str.size()}); }
+    BufferViewList(std::string_view str) : _size(str.size()) { _views.push_back(str); }
     //!@}
 
+    //! \brief Append a view to the end of the list (empty views are skipped)
+    void append(std::string_view str);
+
     //! \brief Discard the first `n` bytes of the string (does not require a copy or move)
     void remove_prefix(size_t n);
 
     //! \brief Size of the string
-    size_t size() const;
+    size_t size() const { return _size; }
 
     //! \brief Convert to a vector of `iovec` structures
     //! \note used for system calls that write discontiguous buffers,
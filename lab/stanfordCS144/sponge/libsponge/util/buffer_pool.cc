@@ -0,0 +1,161 @@
+#include "buffer_pool.hh"
+
+#include <new>
+#include <utility>
+
+using namespace std;
+
+namespace {
+
+//! Set once the calling thread's pool has been destroyed (Buffers may outlive it during thread exit)
+thread_local bool pool_destroyed = false;
+
+//! A string whose storage goes back to the pool when it is destroyed
+struct PooledString {
+    string str;
+
+    explicit PooledString(string &&s) : str(move(s)) {}
+    ~PooledString() {
+        if (not pool_destroyed) {
+            BufferPool::local().release(move(str));
+        }
+    }
+
+    PooledString(const PooledString &other) = delete;
+    PooledString &operator=(const PooledString &other) = delete;
+};
+
+//! An allocator that takes the shared_ptr control block (and its PooledString) from the pool
+template <typename T>
+class BlockAllocator {
+  public:
+    using value_type = T;
+
+    BlockAllocator() = default;
+
+    template <typename U>
+    BlockAllocator(const BlockAllocator<U> &) noexcept {}
+
+    T *allocate(const size_t n) {
+        if (pool_destroyed) {
+            return static_cast<T *>(::operator new(n * sizeof(T)));
+        }
+        return static_cast<T *>(BufferPool::local().allocate_block(n * sizeof(T)));
+    }
+
+    void deallocate(T *p, const size_t n) noexcept {
+        if (pool_destroyed) {
+            ::operator delete(p);
+            return;
+        }
+        BufferPool::local().free_block(p, n * sizeof(T));
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const BlockAllocator<T> &, const BlockAllocator<U> &) {
+    return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const BlockAllocator<T> &, const BlockAllocator<U> &) {
+    return false;
+}
+
+//! Whether a string's storage belongs to the pool's size class
+bool is_chunk(const string &str) {
+    return str.capacity() >= BufferPool::CHUNK_SIZE and str.capacity() < 2 * BufferPool::CHUNK_SIZE;
+}
+
+}  // namespace
+
+BufferPool &BufferPool::local() {
+    thread_local BufferPool pool;
+    return pool;
+}
+
+string BufferPool::acquire(const size_t size_hint) {
+    string ret;
+    if (size_hint > CHUNK_SIZE) {
+        ret.reserve(size_hint);
+        return ret;
+    }
+
+    if (_free_chunks.empty()) {
+        _stats.misses++;
+        ret.reserve(CHUNK_SIZE);
+        return ret;
+    }
+
+    _stats.hits++;
+    ret = move(_free_chunks.back());
+    _free_chunks.pop_back();
+    return ret;
+}
+
+void BufferPool::release(string &&chunk) {
+    if (not is_chunk(chunk) or _free_chunks.size() >= MAX_FREE) {
+        return;
+    }
+    chunk.clear();
+    _free_chunks.push_back(move(chunk));
+}
+
+shared_ptr<string> BufferPool::make_shared(string &&str) {
+    if (pool_destroyed) {
+        return std::make_shared<string>(move(str));
+    }
+    auto owner = allocate_shared<PooledString>(BlockAllocator<PooledString>{}, move(str));
+    return {owner, &owner->str};
+}
+
+void *BufferPool::allocate_block(const size_t size) {
+    if (size > BLOCK_SIZE) {
+        _stats.misses++;
+        return ::operator new(size);
+    }
+
+    if (++_stats.in_use > _stats.high_water) {
+        _stats.high_water = _stats.in_use;
+    }
+
+    if (_free_blocks.empty()) {
+        _stats.misses++;
+        return ::operator new(BLOCK_SIZE);
+    }
+
+    _stats.hits++;
+    void *ret = _free_blocks.back();
+    _free_blocks.pop_back();
+    return ret;
+}
+
+void BufferPool::free_block(void *block, const size_t size) noexcept {
+    if (size > BLOCK_SIZE) {
+        ::operator delete(block);
+        return;
+    }
+
+    if (_stats.in_use > 0) {
+        _stats.in_use--;
+    }
+
+    if (_free_blocks.size() >= MAX_FREE) {
+        ::operator delete(block);
+        return;
+    }
+
+    // the free list's capacity only ever grows to MAX_FREE, so this push_back cannot allocate after warm-up
+    try {
+        _free_blocks.push_back(block);
+    } catch (const bad_alloc &) {
+        ::operator delete(block);
+    }
+}
+
+BufferPool::~BufferPool() {
+    pool_destroyed = true;
+    for (void *block : _free_blocks) {
+        ::operator delete(block);
+    }
+}
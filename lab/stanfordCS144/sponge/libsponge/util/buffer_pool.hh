@@ -0,0 +1,80 @@
+#ifndef SPONGE_LIBSPONGE_BUFFER_POOL_HH
+#define SPONGE_LIBSPONGE_BUFFER_POOL_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+//! \brief A per-thread pool of fixed-size chunks that back Buffer storage
+//! \details A Buffer built from a string needs two allocations: the shared
+//! control block (with the string object) and the string's characters. The pool
+//! keeps a free list of each. Control blocks always come from the pool; character
+//! storage is recycled when it was handed out by acquire() (or happens to have the
+//! same size class), so a segment can go from producer to wire and back without
+//! touching the system allocator.
+//!
+//! Every thread has its own pool (see BufferPool::local()), so no locking is needed.
+//! A Buffer freed on a different thread than the one that created it simply
+//! returns its memory to the freeing thread's pool.
+class BufferPool {
+  public:
+    //! Capacity of a pooled string chunk: fits a TCPConfig::MAX_PAYLOAD_SIZE payload or an MTU-sized frame
+    static constexpr size_t CHUNK_SIZE = 2048;
+
+    //! Size of a pooled block holding a Buffer's control block and string object
+    static constexpr size_t BLOCK_SIZE = 128;
+
+    //! Maximum number of idle chunks (and idle blocks) kept per thread
+    static constexpr size_t MAX_FREE = 1024;
+
+    //! Allocation counters for one thread's pool
+    struct Stats {
+        uint64_t hits = 0;      //!< blocks and chunks served from a free list
+        uint64_t misses = 0;    //!< blocks and chunks that fell through to the system allocator
+        size_t in_use = 0;      //!< pooled blocks currently backing a Buffer
+        size_t high_water = 0;  //!< largest value that `in_use` has reached
+    };
+
+  private:
+    std::vector<void *> _free_blocks{};        //!< idle blocks of BLOCK_SIZE bytes
+    std::vector<std::string> _free_chunks{};   //!< idle empty strings with chunk-sized capacity
+    Stats _stats{};
+
+  public:
+    //! The calling thread's pool
+    static BufferPool &local();
+
+    //! \brief An empty string with capacity for at least `size_hint` bytes
+    //! \details Strings for up to CHUNK_SIZE bytes come from the free list; larger requests are not pooled.
+    std::string acquire(const size_t size_hint = CHUNK_SIZE);
+
+    //! Return a string's storage to the pool (storage outside the chunk size class is just freed)
+    void release(std::string &&chunk);
+
+    //! Wrap a string in a shared_ptr whose control block comes from the calling thread's pool
+    //! and whose storage is released back to the pool when the last reference goes away
+    static std::shared_ptr<std::string> make_shared(std::string &&str);
+
+    //! \name Block allocation (used by the pool's allocator)
+    //!@{
+    void *allocate_block(const size_t size);
+    void free_block(void *block, const size_t size) noexcept;
+    //!@}
+
+    //! Counters for this pool
+    const Stats &stats() const { return _stats; }
+
+    BufferPool() = default;
+    ~BufferPool();
+
+    //! \name Copy constructor/assignment operator
+    //! A BufferPool belongs to one thread and cannot be copied
+    //!@{
+    BufferPool(const BufferPool &other) = delete;             //!< \brief copy construction is forbidden
+    BufferPool &operator=(const BufferPool &other) = delete;  //!< \brief copy assignment is forbidden
+    //!@}
+};
+
+#endif  // SPONGE_LIBSPONGE_BUFFER_POOL_HH
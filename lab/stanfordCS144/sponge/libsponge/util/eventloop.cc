@@ -2,45 +2,204 @@
 
 #include "util.hh"
 
+#include <algorithm>
+#include <atomic>
 #include <cerrno>
+#include <cstdint>
+#include <iterator>
+#include <limits>
 #include <stdexcept>
 #include <system_error>
 #include <utility>
 #include <vector>
 
+// epoll_pwait2() came with glibc 2.35 (and Linux 5.11)
+#if defined(__GLIBC__) && defined(__GLIBC_PREREQ)
+#if __GLIBC_PREREQ(2, 35)
+#define SPONGE_HAVE_EPOLL_PWAIT2
+#endif
+#endif
+
 using namespace std;
 
 unsigned int EventLoop::Rule::service_count() const {
     return direction == Direction::In ? fd.read_count() : fd.write_count();
 }
 
+EventLoop::EventLoop(const Backend backend) : _backend(backend) {
+    if (_backend == Backend::Epoll) {
+        _epoll.emplace(SystemCall("epoll_create1", ::epoll_create1(EPOLL_CLOEXEC)));
+    }
+}
+
 //! \param[in] fd is the FileDescriptor to be polled
 //! \param[in] direction indicates whether to poll for reading (Direction::In) or writing (Direction::Out)
 //! \param[in] callback is called when `fd` is ready.
-//! \param[in] interest is called by EventLoop::wait_next_event. If it returns `true`, `fd` will
+//! \param[in] interest if set, is called by EventLoop::wait_next_event. If it returns `true`, `fd` will
 //!                     be polled, otherwise `fd` will be ignored only for this execution of `wait_next_event.
+//!                     If not set, `fd` is polled until EventLoop::set_interest says otherwise.
 //! \param[in] cancel is called when the rule is cancelled (e.g. on hangup, EOF, or closure).
-void EventLoop::add_rule(const FileDescriptor &fd,
-                         const Direction direction,
-                         const CallbackT &callback,
-                         const InterestT &interest,
-                         const CallbackT &cancel) {
-    _rules.push_back({fd.duplicate(), direction, callback, interest, cancel});
+EventLoop::RuleId EventLoop::add_rule(const FileDescriptor &fd,
+                                      const Direction direction,
+                                      const CallbackT &callback,
+                                      const InterestT &interest,
+                                      const CallbackT &cancel) {
+    const RuleId id = _next_id++;
+    if (_backend == Backend::Epoll) {
+        auto [reg, added] = _registrations.try_emplace(fd.fd_num());
+        if (added) {
+            reg->second.serial = _next_serial++;
+        }
+        RuleId &slot = direction == Direction::In ? reg->second.in : reg->second.out;
+        if (slot != 0) {
+            throw runtime_error("EventLoop: fd already has a rule in that direction");
+        }
+        slot = id;
+        if (interest) {
+            _polled_rules.push_back(id);
+        }
+    }
+
+    _rules.push_back({id, fd.duplicate(), direction, callback, interest, cancel});
+    _index.emplace(id, prev(_rules.end()));
+    if (_backend == Backend::Epoll) {
+        update_registration(_rules.back());
+    }
+    return id;
+}
+
+//! \details A disabled rule is not polled, whatever its interest callback returns. Enabling a rule whose fd
+//! has been closed (or, for Direction::In, has reached EOF) cancels it.
+bool EventLoop::set_interest(const RuleId id, const bool interested) {
+    const auto it = _index.find(id);
+    if (it == _index.end()) {
+        return false;
+    }
+    Rule &rule = *it->second;
+    if (interested and (rule.fd.closed() or (rule.direction == Direction::In and rule.fd.eof()))) {
+        cancel(it->second);
+        return false;
+    }
+    if (rule.enabled != interested) {
+        rule.enabled = interested;
+        if (_backend == Backend::Epoll) {
+            update_registration(rule);
+        }
+    }
+    return true;
+}
+
+bool EventLoop::remove_rule(const RuleId id) {
+    const auto it = _index.find(id);
+    if (it == _index.end()) {
+        return false;
+    }
+    retire(it->second);
+    return true;
+}
+
+void EventLoop::update_registration(const Rule &rule) {
+    const int fd_num = rule.fd.fd_num();
+    Registration &reg = _registrations.at(fd_num);
+    const auto armed = [&](const RuleId id) { return id != 0 and _index.at(id)->interested(); };
+    const uint32_t events = (armed(reg.in) ? uint32_t{EPOLLIN} : 0) | (armed(reg.out) ? uint32_t{EPOLLOUT} : 0);
+    if (events == reg.events) {
+        return;
+    }
+
+    // a closed fd has already left the epoll instance
+    if (not rule.fd.closed()) {
+        epoll_event event{};
+        event.events = events;
+        event.data.u64 = (uint64_t{reg.serial} << 32) | static_cast<uint32_t>(fd_num);
+        const int op = reg.events == 0 ? EPOLL_CTL_ADD : events == 0 ? EPOLL_CTL_DEL : EPOLL_CTL_MOD;
+        SystemCall("epoll_ctl", ::epoll_ctl(_epoll->fd_num(), op, fd_num, &event));
+    }
+    _registered = _registered + (events != 0) - (reg.events != 0);
+    reg.events = events;
+}
+
+void EventLoop::retire(const list<Rule>::iterator it) {
+    Rule &rule = *it;
+    if (_backend == Backend::Epoll) {
+        rule.enabled = false;
+        update_registration(rule);
+        const auto reg = _registrations.find(rule.fd.fd_num());
+        (rule.direction == Direction::In ? reg->second.in : reg->second.out) = 0;
+        if (reg->second.in == 0 and reg->second.out == 0) {
+            _registrations.erase(reg);
+        }
+    }
+    _index.erase(rule.id);
+    // the rule's callback may be the one running
+    _retired.splice(_retired.end(), _rules, it);
+}
+
+void EventLoop::cancel(const list<Rule>::iterator it) {
+    it->cancel();
+    // (the cancel callback may have removed the rule itself)
+    if (_index.count(it->id)) {
+        retire(it);
+    }
+}
+
+void EventLoop::serve(const RuleId id, const bool ready, const bool hangup) {
+    const auto it = _index.find(id);
+    if (it == _index.end()) {
+        return;
+    }
+    Rule &rule = *it->second;
+
+    if (hangup and not ready) {
+        // if we asked for the status, and the _only_ condition was a hangup, this FD is defunct:
+        //   - if it was POLLIN and nothing is readable, no more will ever be readable
+        //   - if it was POLLOUT, it will not be writable again
+        cancel(it->second);
+        return;
+    }
+
+    // we only want to call callback if revents includes the event we asked for (and the rule was not
+    // disabled by an earlier callback)
+    if (not ready or not rule.enabled) {
+        return;
+    }
+    const auto count_before = rule.service_count();
+    rule.callback();
+    if (_index.count(id) == 0) {
+        return;  // the callback removed its own rule
+    }
+
+    if (rule.fd.closed() or (rule.direction == Direction::In and rule.fd.eof())) {
+        cancel(it->second);
+        return;
+    }
+
+    if (rule.interest) {
+        rule.polled = rule.interest();
+        if (_backend == Backend::Epoll) {
+            update_registration(rule);
+        }
+    }
+
+    // only check for busy wait if we're not canceling or exiting
+    if (count_before == rule.service_count() and rule.interested()) {
+        throw runtime_error("EventLoop: busy wait detected: callback did not read/write fd and is still interested");
+    }
 }
 
 //! \param[in] timeout_ms is the timeout value passed to [poll(2)](\ref man2::poll); `wait_next_event`
 //!                       returns Result::Timeout if no fd is ready after the timeout expires.
 //! \returns Eventloop::Result indicating success, timeout, or no more Rule objects to poll.
 //!
-//! For each Rule, this function first calls Rule::interest; if `true`, Rule::fd is added to the
-//! list of file descriptors to be polled for readability (if Rule::direction == Direction::In) or
-//! writability (if Rule::direction == Direction::Out) unless Rule::fd has reached EOF, in which case
-//! the Rule is canceled (i.e., deleted from EventLoop::_rules).
+//! For each Rule, this function first calls Rule::interest (if set); if `true` and the Rule is enabled,
+//! Rule::fd is added to the list of file descriptors to be polled for readability (if Rule::direction ==
+//! Direction::In) or writability (if Rule::direction == Direction::Out) unless Rule::fd has reached EOF,
+//! in which case the Rule is canceled (i.e., deleted from EventLoop::_rules). With Backend::Epoll, only
+//! the rules with an interest callback are visited, and the list of file descriptors is already in the kernel.
 //!
 //! Next, this function calls [poll(2)](\ref man2::poll) with timeout value `timeout_ms`.
 //!
-//! Then, for each ready file descriptor, this function calls Rule::callback. If fd reaches EOF or
-//! if the Rule was registered using EventLoop::add_cancelable_rule and Rule::callback returns true,
+//! Then, for each ready file descriptor, this function calls Rule::callback. If fd reaches EOF,
 //! this Rule is canceled.
 //!
 //! If an error occurs during polling, this function throws a std::runtime_error.
@@ -52,40 +211,72 @@ void EventLoop::add_rule(const FileDescriptor &fd,
 //!
 //! Otherwise, this function returns Result::Success.
 //!
-//! \b IMPORTANT: every call to Rule::callback must read from or write to Rule::fd, or the `interest`
-//! callback must stop returning true after the callback completes.
-//! If none of these conditions occur, EventLoop::wait_next_event will throw std::runtime_error. This is
-//! because [poll(2)](\ref man2::poll) is level triggered, so failing to act on a ready file descriptor
-//! will result in a busy loop (poll returns on a ready file descriptor; file descriptor is not read or
-//! written, so it is still ready; the next call to poll will immediately return).
 EventLoop::Result EventLoop::wait_next_event(const int timeout_ms) {
+    return wait_next_event(timeout_ms < 0 ? chrono::microseconds{-1} : chrono::milliseconds{timeout_ms});
+}
+
+//! \param[in] timeout is how long [ppoll(2)](\ref man2::poll) or epoll_wait() may wait for a ready fd
+//!                    (negative: no limit)
+//! \returns as for the overload in milliseconds
+//!
+//! \b IMPORTANT: every call to Rule::callback must read from or write to Rule::fd, or the Rule must be
+//! disabled (or its `interest` callback must stop returning true) by the time the callback completes.
+//! If none of these conditions occur, EventLoop::wait_next_event will throw std::runtime_error. This is
+//! because [poll(2)](\ref man2::poll) (like the epoll backend) is level triggered, so failing to act on a
+//! ready file descriptor will result in a busy loop (poll returns on a ready file descriptor; file descriptor
+//! is not read or written, so it is still ready; the next call to poll will immediately return).
+EventLoop::Result EventLoop::wait_next_event(const chrono::microseconds timeout) {
+    _retired.clear();
+    const Result result = _backend == Backend::Epoll ? wait_epoll(timeout) : wait_poll(timeout);
+    _retired.clear();
+    return result;
+}
+
+//! Timeout for ppoll() or epoll_pwait2(): `nullptr` to wait indefinitely, or else `storage` set to `timeout`
+static const timespec *timeout_spec(const chrono::microseconds timeout, timespec &storage) {
+    if (timeout.count() < 0) {
+        return nullptr;
+    }
+    const auto seconds = chrono::duration_cast<chrono::seconds>(timeout);
+    storage = {seconds.count(), chrono::duration_cast<chrono::nanoseconds>(timeout - seconds).count()};
+    return &storage;
+}
+
+EventLoop::Result EventLoop::wait_poll(const chrono::microseconds timeout) {
     vector<pollfd> pollfds{};
+    vector<RuleId> ids{};
     pollfds.reserve(_rules.size());
+    ids.reserve(_rules.size());
     bool something_to_poll = false;
 
     // set up the pollfd for each rule
-    for (auto it = _rules.cbegin(); it != _rules.cend();) {  // NOTE: it gets erased or incremented in loop body
-        const auto &this_rule = *it;
+    for (auto it = _rules.begin(); it != _rules.end();) {  // NOTE: it gets erased or incremented in loop body
+        auto &this_rule = *it;
+        const auto next = std::next(it);
         if (this_rule.direction == Direction::In && this_rule.fd.eof()) {
             // no more reading on this rule, it's reached eof
-            this_rule.cancel();
-            it = _rules.erase(it);
+            cancel(it);
+            it = next;
             continue;
         }
 
         if (this_rule.fd.closed()) {
-            this_rule.cancel();
-            it = _rules.erase(it);
+            cancel(it);
+            it = next;
             continue;
         }
 
-        if (this_rule.interest()) {
+        if (this_rule.interest) {
+            this_rule.polled = this_rule.interest();
+        }
+        if (this_rule.interested()) {
             pollfds.push_back({this_rule.fd.fd_num(), static_cast<short>(this_rule.direction), 0});
             something_to_poll = true;
         } else {
             pollfds.push_back({this_rule.fd.fd_num(), 0, 0});  // placeholder --- we still want errors
         }
-        ++it;
+        ids.push_back(this_rule.id);
+        it = next;
     }
 
     // quit if there is nothing left to poll
@@ -94,8 +285,10 @@ EventLoop::Result EventLoop::wait_next_event(const int timeout_ms) {
     }
 
     // call poll -- wait until one of the fds satisfies one of the rules (writeable/readable)
+    timespec timeout_ts{};
     try {
-        if (0 == SystemCall("poll", ::poll(pollfds.data(), pollfds.size(), timeout_ms))) {
+        if (0 ==
+            SystemCall("ppoll", ::ppoll(pollfds.data(), pollfds.size(), timeout_spec(timeout, timeout_ts), nullptr))) {
             return Result::Timeout;
         }
     } catch (unix_error const &e) {
@@ -105,8 +298,7 @@ EventLoop::Result EventLoop::wait_next_event(const int timeout_ms) {
     }
 
     // go through the poll results
-
-    for (auto [it, idx] = make_pair(_rules.begin(), size_t(0)); it != _rules.end(); ++idx) {
+    for (size_t idx = 0; idx < pollfds.size(); idx++) {
         const auto &this_pollfd = pollfds[idx];
 
         const auto poll_error = static_cast<bool>(this_pollfd.revents & (POLLERR | POLLNVAL));
@@ -114,31 +306,100 @@ EventLoop::Result EventLoop::wait_next_event(const int timeout_ms) {
             throw runtime_error("EventLoop: error on polled file descriptor");
         }
 
-        const auto &this_rule = *it;
         const auto poll_ready = static_cast<bool>(this_pollfd.revents & this_pollfd.events);
         const auto poll_hup = static_cast<bool>(this_pollfd.revents & POLLHUP);
-        if (poll_hup && this_pollfd.events && !poll_ready) {
-            // if we asked for the status, and the _only_ condition was a hangup, this FD is defunct:
-            //   - if it was POLLIN and nothing is readable, no more will ever be readable
-            //   - if it was POLLOUT, it will not be writable again
-            this_rule.cancel();
-            it = _rules.erase(it);
+        serve(ids[idx], poll_ready, poll_hup and this_pollfd.events);
+    }
+
+    return Result::Success;
+}
+
+//! \details Waits with epoll_pwait2(), which takes the timeout to the nanosecond, where the C library and the
+//! kernel have it; elsewhere, with [epoll_wait(2)](\ref man2::epoll_wait) and the timeout rounded up to whole
+//! milliseconds (so the wait is never cut short).
+//! \returns as for epoll_wait()
+static int epoll_wait_for(const int epfd,
+                          epoll_event *events,
+                          const int max_events,
+                          const chrono::microseconds timeout) {
+#ifdef SPONGE_HAVE_EPOLL_PWAIT2
+    static atomic<bool> pwait2_unsupported{false};  // by the kernel
+    if (not pwait2_unsupported.load(memory_order_relaxed)) {
+        timespec timeout_ts{};
+        const int ret = ::epoll_pwait2(epfd, events, max_events, timeout_spec(timeout, timeout_ts), nullptr);
+        if (ret >= 0 or errno != ENOSYS) {
+            return ret;
+        }
+        pwait2_unsupported.store(true, memory_order_relaxed);
+    }
+#endif
+    int timeout_ms = -1;
+    if (timeout.count() >= 0) {
+        timeout_ms = static_cast<int>(
+            min<int64_t>(chrono::ceil<chrono::milliseconds>(timeout).count(), numeric_limits<int>::max()));
+    }
+    return ::epoll_wait(epfd, events, max_events, timeout_ms);
+}
+
+//! \details Rules with an interest callback are brought up to date first; then only the ready fds
+//! (as reported by [epoll_wait(2)](\ref man2::epoll_wait)) are visited.
+EventLoop::Result EventLoop::wait_epoll(const chrono::microseconds timeout) {
+    for (size_t i = 0; i < _polled_rules.size();) {  // NOTE: removed rules are dropped from the list here
+        const auto it = _index.find(_polled_rules[i]);
+        if (it == _index.end()) {
+            _polled_rules[i] = _polled_rules.back();
+            _polled_rules.pop_back();
             continue;
         }
+        Rule &rule = *it->second;
+        if (rule.fd.closed() or (rule.direction == Direction::In and rule.fd.eof())) {
+            cancel(it->second);
+            continue;
+        }
+        rule.polled = rule.interest();
+        update_registration(rule);
+        i++;
+    }
 
-        if (poll_ready) {
-            // we only want to call callback if revents includes the event we asked for
-            const auto count_before = this_rule.service_count();
-            this_rule.callback();
+    // quit if there is nothing left to poll
+    if (_registered == 0) {
+        return Result::Exit;
+    }
 
-            // only check for busy wait if we're not canceling or exiting
-            if (count_before == this_rule.service_count() and this_rule.interest()) {
-                throw runtime_error(
-                    "EventLoop: busy wait detected: callback did not read/write fd and is still interested");
-            }
+    _ready.resize(max(_registered, size_t{1}));
+    const int max_events = static_cast<int>(_ready.size());
+    int count = 0;
+    try {
+        count = SystemCall("epoll_wait", epoll_wait_for(_epoll->fd_num(), _ready.data(), max_events, timeout));
+    } catch (unix_error const &e) {
+        if (e.code().value() == EINTR) {
+            return Result::Exit;
+        }
+        throw;
+    }
+    if (count == 0) {
+        return Result::Timeout;
+    }
+
+    for (int i = 0; i < count; i++) {
+        const epoll_event &event = _ready[i];
+        const auto reg = _registrations.find(static_cast<int>(event.data.u64 & 0xffffffff));
+        if (reg == _registrations.end() or reg->second.serial != event.data.u64 >> 32) {
+            continue;  // its rules were removed by an earlier callback
+        }
+        if (event.events & EPOLLERR) {
+            throw runtime_error("EventLoop: error on polled file descriptor");
         }
 
-        ++it;  // if we got here, it means we didn't call _rules.erase()
+        // (the callback of the first rule may remove the registration)
+        const Registration rules = reg->second;
+        const bool hup = event.events & EPOLLHUP;
+        if (rules.in != 0) {
+            serve(rules.in, event.events & EPOLLIN, hup and (rules.events & EPOLLIN));
+        }
+        if (rules.out != 0) {
+            serve(rules.out, event.events & EPOLLOUT, hup and (rules.events & EPOLLOUT));
+        }
     }
 
     return Result::Success;
@@ -3,10 +3,16 @@
 
 #include "file_descriptor.hh"
 
+#include <chrono>
+#include <cstdint>
 #include <cstdlib>
 #include <functional>
 #include <list>
+#include <optional>
 #include <poll.h>
+#include <sys/epoll.h>
+#include <unordered_map>
+#include <vector>
 
 //! Waits for events on file descriptors and executes corresponding callbacks.
 class EventLoop {
@@ -17,60 +23,146 @@ class EventLoop {
         Out = POLLOUT  //!< Callback will be triggered when Rule::fd is writable.
     };
 
+    //! How the EventLoop asks the kernel which fds are ready
+    enum class Backend {
+        Poll,   //!< build a [poll(2)](\ref man2::poll) set from every Rule on each call to wait_next_event
+        Epoll,  //!< keep the fds registered in an [epoll(7)](\ref man7::epoll) instance between calls
+    };
+
+    //! Returned by each call to EventLoop::wait_next_event.
+    enum class Result {
+        Success,  //!< At least one Rule was triggered.
+        Timeout,  //!< No rules were triggered before timeout.
+        Exit  //!< All rules have been canceled or were uninterested; make no further calls to EventLoop::wait_next_event.
+    };
+
+    using RuleId = uint64_t;  //!< Handle for EventLoop::set_interest() and EventLoop::remove_rule()
+
   private:
     using CallbackT = std::function<void(void)>;  //!< Callback for ready Rule::fd
     using InterestT = std::function<bool(void)>;  //!< `true` return indicates Rule::fd should be polled.
 
     //! \brief Specifies a condition and callback that an EventLoop should handle.
-    //! \details Created by calling EventLoop::add_rule() or EventLoop::add_cancelable_rule().
+    //! \details Created by calling EventLoop::add_rule().
     class Rule {
       public:
+        RuleId id;            //!< Handle returned by EventLoop::add_rule()
         FileDescriptor fd;    //!< FileDescriptor to monitor for activity.
         Direction direction;  //!< Direction::In for reading from fd, Direction::Out for writing to fd.
         CallbackT callback;   //!< A callback that reads or writes fd.
-        InterestT interest;   //!< A callback that returns `true` whenever fd should be polled.
+        InterestT interest;   //!< If set, a callback that returns `true` whenever fd should be polled.
         CallbackT cancel;     //!< A callback that is called when the rule is cancelled (e.g. on hangup)
+        bool enabled{true};   //!< Interest set by EventLoop::set_interest()
+        bool polled{true};    //!< Result of the latest call to Rule::interest
 
         //! Returns the number of times fd has been read or written, depending on the value of Rule::direction.
         //! \details This function is used internally by EventLoop; you will not need to call it
         unsigned int service_count() const;
+
+        //! Should fd be polled? (as of the latest call to Rule::interest)
+        bool interested() const { return enabled and polled; }
     };
 
-    std::list<Rule> _rules{};  //!< All rules that have been added and not canceled.
+    //! The rules on one fd, and what the epoll instance is asked to watch it for
+    struct Registration {
+        RuleId in{0};        //!< Rule for Direction::In (0: none)
+        RuleId out{0};       //!< Rule for Direction::Out (0: none)
+        uint32_t events{0};  //!< events registered with the kernel (0: not registered)
+        uint32_t serial{0};  //!< tells a registration apart from an earlier one of the same fd number
+    };
+
+    Backend _backend;                                                //!< how fds are polled
+    std::list<Rule> _rules{};                                        //!< rules that have been added and not canceled
+    std::unordered_map<RuleId, std::list<Rule>::iterator> _index{};  //!< rules by id
+    std::list<Rule> _retired{};                                      //!< removed rules, kept until callbacks return
+    RuleId _next_id{1};                                              //!< id of the next rule
+
+    //! \name Epoll backend
+    //!@{
+    std::optional<FileDescriptor> _epoll{};                  //!< the epoll instance
+    std::unordered_map<int, Registration> _registrations{};  //!< by fd number
+    uint32_t _next_serial{0};                                //!< Registration::serial of the next registration
+    size_t _registered{0};                                   //!< registrations with events
+    std::vector<RuleId> _polled_rules{};                     //!< rules with a Rule::interest callback (or removed)
+    std::vector<epoll_event> _ready{};                       //!< events returned by the kernel
+    //!@}
+
+    //! Bring the kernel's registration of Rule::fd in line with its rules' interest (epoll backend)
+    void update_registration(const Rule &rule);
+
+    //! Take a rule out of the loop, without calling Rule::cancel
+    void retire(const std::list<Rule>::iterator it);
+
+    //! Call Rule::cancel, then take the rule out of the loop
+    void cancel(const std::list<Rule>::iterator it);
+
+    //! \brief Act on what the kernel reported for a rule
+    //! \param[in] id is the rule (which an earlier callback may have removed)
+    //! \param[in] ready is whether the fd is ready in the rule's Direction
+    //! \param[in] hangup is whether the fd hung up while the rule was interested
+    void serve(const RuleId id, const bool ready, const bool hangup);
+
+    Result wait_poll(const std::chrono::microseconds timeout);   //!< wait_next_event with Backend::Poll
+    Result wait_epoll(const std::chrono::microseconds timeout);  //!< wait_next_event with Backend::Epoll
 
   public:
-    //! Returned by each call to EventLoop::wait_next_event.
-    enum class Result {
-        Success,  //!< At least one Rule was triggered.
-        Timeout,  //!< No rules were triggered before timeout.
-        Exit  //!< All rules have been canceled or were uninterested; make no further calls to EventLoop::wait_next_event.
-    };
+    //! \param[in] backend selects how the kernel is asked which fds are ready
+    explicit EventLoop(const Backend backend = Backend::Poll);
+
+    //! \brief Add a rule whose callback will be called when `fd` is ready in the specified Direction.
+    //! \returns a handle for set_interest() and remove_rule()
+    RuleId add_rule(const FileDescriptor &fd,
+                    const Direction direction,
+                    const CallbackT &callback,
+                    const InterestT &interest = {},
+                    const CallbackT &cancel = [] {});
+
+    //! \brief Start or stop polling a rule's fd
+    //! \returns `false` if the rule has been canceled or removed
+    bool set_interest(const RuleId id, const bool interested);
 
-    //! Add a rule whose callback will be called when `fd` is ready in the specified Direction.
-    void add_rule(const FileDescriptor &fd,
-                  const Direction direction,
-                  const CallbackT &callback,
-                  const InterestT &interest = [] { return true; },
-                  const CallbackT &cancel = [] {});
+    //! \name Shorthands for set_interest()
+    //!@{
+    bool enable_rule(const RuleId id) { return set_interest(id, true); }
+    bool disable_rule(const RuleId id) { return set_interest(id, false); }
+    //!@}
 
-    //! Calls [poll(2)](\ref man2::poll) and then executes callback for each ready fd.
+    //! \brief Stop handling a rule (without calling its cancel callback)
+    //! \returns `false` if the rule has already been canceled or removed
+    bool remove_rule(const RuleId id);
+
+    //! Number of rules that have been added and not canceled or removed
+    size_t size() const { return _index.size(); }
+
+    //! Waits for fds to be ready (see Backend) and then executes callback for each ready fd.
     Result wait_next_event(const int timeout_ms);
+
+    //! \brief Same, with a timeout of microsecond resolution (negative: wait indefinitely)
+    //! \details Uses [ppoll(2)](\ref man2::poll) or epoll_pwait2(), for callers (like a pacing timer) that
+    //! must wake up sooner than the next millisecond. Where epoll_pwait2() is missing (before glibc 2.35 or
+    //! Linux 5.11), the epoll backend rounds the timeout up to whole milliseconds.
+    Result wait_next_event(const std::chrono::microseconds timeout);
 };
 
 using Direction = EventLoop::Direction;
 
 //! \class EventLoop
 //!
-//! An EventLoop holds a std::list of Rule objects. Each time EventLoop::wait_next_event is
-//! executed, the EventLoop uses the Rule objects to construct a call to [poll(2)](\ref man2::poll).
+//! An EventLoop holds a std::list of Rule objects. With Backend::Poll, each time EventLoop::wait_next_event
+//! is executed, the EventLoop uses the Rule objects to construct a call to [poll(2)](\ref man2::poll).
 //!
 //! When a Rule is installed using EventLoop::add_rule, it will be polled for the specified Rule::direction
-//! whenver the Rule::interest callback returns `true`, until Rule::fd is no longer readable
-//! (for Rule::direction == Direction::In) or writable (for Rule::direction == Direction::Out).
-//! Once this occurs, the Rule is canceled, i.e., the EventLoop deletes it.
+//! while it is enabled (see EventLoop::set_interest) and the Rule::interest callback, if any, returns `true`,
+//! until Rule::fd is no longer readable (for Rule::direction == Direction::In) or writable
+//! (for Rule::direction == Direction::Out). Once this occurs, the Rule is canceled, i.e., the EventLoop
+//! deletes it.
 //!
-//! A Rule installed using EventLoop::add_cancelable_rule will be polled and canceled under the
-//! same conditions, with the additional condition that if Rule::callback returns `true`, the
-//! Rule will be canceled.
+//! With Backend::Epoll, the fds stay registered with the kernel, and a call to EventLoop::wait_next_event
+//! costs time in proportion to the fds that are ready rather than to all of the rules. The registration of
+//! an fd changes (with [epoll_ctl(2)](\ref man2::epoll_ctl)) only when the interest of one of its rules does.
+//! A Rule given an interest callback still has it called on every EventLoop::wait_next_event, so a caller
+//! with many rules should leave it out and call EventLoop::set_interest when its interest changes instead.
+//! Each fd may have at most one Rule per Direction, and a caller must remove the rules of an fd before
+//! closing it (the kernel drops a closed fd silently, so its rules would never be canceled).
 
 #endif  // SPONGE_LIBSPONGE_EVENTLOOP_HH
@@ -47,6 +47,9 @@ class FileDescriptor {
   protected:
     void register_read() { ++_internal_fd->_read_count; }    //!< increment read count
     void register_write() { ++_internal_fd->_write_count; }  //!< increment write count
+    void set_eof() { _internal_fd->_eof = true; }            //!< record that a read reached EOF
+
+    friend class IoEngine;  //!< reads and writes on behalf of FileDescriptor objects
 
   public:
     //! Construct from a file descriptor number returned by the kernel
@@ -0,0 +1,190 @@
+#include "io_engine.hh"
+
+#include "util.hh"
+
+#include <cerrno>
+#include <stdexcept>
+#include <unistd.h>
+#include <utility>
+
+using namespace std;
+
+IoEngine::IoEngine(const size_t slot_size)
+    : _ring(BATCH), _slot_size(slot_size), _read_buffers(BATCH * slot_size) {
+    vector<iovec> buffers{};
+    for (size_t i = 0; i < BATCH; i++) {
+        ReadSlot &slot = _slots[i];
+        slot.buffer = {&_read_buffers[i * _slot_size], _slot_size};
+        slot.message.msg_iov = &slot.buffer;
+        slot.message.msg_iovlen = 1;
+        buffers.push_back(slot.buffer);
+    }
+    _ring.register_buffers(buffers);
+}
+
+bool IoEngine::try_emplace(optional<IoEngine> &engine, const size_t slot_size) {
+    try {
+        engine.emplace(slot_size);
+        return true;
+    } catch (const unix_error &) {
+        return false;
+    }
+}
+
+//! \details The reads do not wait: they take what is already queued on the fd, so the batch ends at the
+//! first read that finds nothing. For a socket, the reads are linked, so the kernel skips the rest of the
+//! batch once that happens. An fd that cannot be read without waiting (its driver does not support it) is
+//! read once, directly, as FileDescriptor::read would.
+size_t IoEngine::read_batch(FileDescriptor &fd, const bool socket) {
+    for (size_t i = 0; i < BATCH; i++) {
+        ReadSlot &slot = _slots[i];
+        io_uring_sqe *const sqe = _ring.prepare();
+        sqe->fd = fd.fd_num();
+        sqe->user_data = i;
+        if (socket) {
+            slot.message.msg_name = static_cast<sockaddr *>(slot.source);
+            slot.message.msg_namelen = sizeof(slot.source.storage);
+            sqe->opcode = IORING_OP_RECVMSG;
+            sqe->addr = reinterpret_cast<uint64_t>(&slot.message);
+            sqe->len = 1;
+            sqe->msg_flags = MSG_DONTWAIT | MSG_TRUNC;
+            if (i + 1 < BATCH) {
+                sqe->flags = IOSQE_IO_LINK;
+            }
+        } else {
+            // (a read shorter than the buffer would break a link, so these are not linked)
+            sqe->opcode = IORING_OP_READ_FIXED;
+            sqe->addr = reinterpret_cast<uint64_t>(slot.buffer.iov_base);
+            sqe->len = static_cast<uint32_t>(_slot_size);
+            sqe->off = static_cast<uint64_t>(-1);
+            sqe->buf_index = static_cast<uint16_t>(i);
+            sqe->rw_flags = RWF_NOWAIT;
+        }
+    }
+
+    // take the datagrams in the order they were queued on the fd, i.e., in the order of the slots
+    array<int, BATCH> results{};
+    _ring.complete(BATCH, [&](const uint64_t slot, const int32_t res) { results.at(slot) = res; });
+
+    _received_count = 0;
+    bool eof = false;
+    for (size_t i = 0; i < BATCH; i++) {
+        const int res = results[i];
+        if (res == -EAGAIN or res == -ECANCELED or res == -EOPNOTSUPP) {
+            continue;
+        }
+        if (res < 0) {
+            throw unix_error(socket ? "recvmsg" : "read", -res);
+        }
+        if (static_cast<size_t>(res) > _slot_size) {
+            throw runtime_error("recvfrom (oversized datagram)");
+        }
+        if (res == 0 and not socket) {
+            eof = true;
+            break;
+        }
+        _received[_received_count] = i;
+        _lengths[i] = static_cast<size_t>(res);
+        _received_count++;
+    }
+
+    // (the kernel also says EAGAIN when the fd cannot be read without waiting at all)
+    if (_received_count == 0 and not socket and not eof) {
+        void *const buffer = _slots[0].buffer.iov_base;
+        const int res = SystemCall("read", static_cast<int>(::read(fd.fd_num(), buffer, _slot_size)));
+        eof = res == 0;
+        if (not eof) {
+            _received[0] = 0;
+            _lengths[0] = static_cast<size_t>(res);
+            _received_count = 1;
+        }
+    }
+
+    if (eof) {
+        fd.set_eof();
+    }
+    fd.register_read();
+    return _received_count;
+}
+
+string_view IoEngine::payload(const size_t n) const {
+    const size_t slot = _received.at(n);
+    return {static_cast<const char *>(_slots[slot].buffer.iov_base), _lengths[slot]};
+}
+
+Address IoEngine::source(const size_t n) const {
+    const ReadSlot &slot = _slots[_received.at(n)];
+    return {static_cast<const sockaddr *>(slot.source), slot.message.msg_namelen};
+}
+
+void IoEngine::sendto(UDPSocket &sock, const Address &destination, BufferList payload) {
+    if (_writes.size() == BATCH) {
+        flush();
+    }
+    _writes.push_back({sock.fd_num(), move(payload), destination});
+    static_cast<FileDescriptor &>(sock).register_write();
+}
+
+void IoEngine::write(FileDescriptor &fd, BufferList payload) {
+    if (_writes.size() == BATCH) {
+        flush();
+    }
+    _writes.push_back({fd.fd_num(), move(payload), {}});
+    fd.register_write();
+}
+
+//! \details The writes are linked, so each starts only once the one before it has finished: a datagram
+//! that has to wait for room in the socket's buffer does not let the next one overtake it. This waits
+//! until all of them have been sent, and throws unix_error if one of them failed.
+void IoEngine::flush() {
+    if (_writes.empty()) {
+        return;
+    }
+
+    for (size_t i = 0; i < _writes.size(); i++) {
+        QueuedWrite &write = _writes[i];
+        write.iovecs = BufferViewList(write.payload).as_iovecs();
+        io_uring_sqe *const sqe = _ring.prepare();
+        sqe->fd = write.fd;
+        sqe->user_data = i;
+        if (write.destination.has_value()) {
+            write.message.msg_name = const_cast<sockaddr *>(static_cast<const sockaddr *>(write.destination.value()));
+            write.message.msg_namelen = write.destination->size();
+            write.message.msg_iov = write.iovecs.data();
+            write.message.msg_iovlen = write.iovecs.size();
+            sqe->opcode = IORING_OP_SENDMSG;
+            sqe->addr = reinterpret_cast<uint64_t>(&write.message);
+            sqe->len = 1;
+        } else {
+            sqe->opcode = IORING_OP_WRITEV;
+            sqe->addr = reinterpret_cast<uint64_t>(write.iovecs.data());
+            sqe->len = static_cast<uint32_t>(write.iovecs.size());
+            sqe->off = static_cast<uint64_t>(-1);
+        }
+        if (i + 1 < _writes.size()) {
+            sqe->flags = IOSQE_IO_LINK;
+        }
+    }
+
+    optional<pair<size_t, int>> failed{};  // write and errno
+    bool too_big = false;
+    _ring.complete(static_cast<unsigned>(_writes.size()), [&](const uint64_t index, const int32_t res) {
+        // (the writes after a failed one are canceled: report the failure itself)
+        if (res < 0 and (not failed.has_value() or failed->second == ECANCELED)) {
+            failed = {index, -res};
+        } else if (res >= 0 and static_cast<size_t>(res) != _writes.at(index).payload.size()) {
+            too_big = true;
+        }
+    });
+
+    if (failed.has_value()) {
+        const bool socket = _writes.at(failed->first).destination.has_value();
+        _writes.clear();
+        throw unix_error(socket ? "sendmsg" : "writev", failed->second);
+    }
+    _writes.clear();
+
+    if (too_big) {
+        throw runtime_error("datagram payload too big for sendmsg()");
+    }
+}
@@ -0,0 +1,101 @@
+#ifndef SPONGE_LIBSPONGE_IO_ENGINE_HH
+#define SPONGE_LIBSPONGE_IO_ENGINE_HH
+
+#include "address.hh"
+#include "buffer.hh"
+#include "file_descriptor.hh"
+#include "io_uring.hh"
+#include "socket.hh"
+
+#include <array>
+#include <cstddef>
+#include <optional>
+#include <string_view>
+#include <sys/socket.h>
+#include <vector>
+
+//! \brief Datagram reads and writes in batches, many per system call, over an [io_uring](\ref man7::io_uring)
+//! \details A read fetches every datagram already waiting on an fd (up to BATCH), with one system call,
+//! into buffers registered with the kernel; the caller then takes them one at a time. Writes are queued,
+//! and go out together on flush() (or once BATCH are queued), in the order they were queued.
+//!
+//! The constructor throws unix_error where io_uring is unavailable (try_emplace() does not); the caller
+//! then reads and writes its fds directly, as it would without an IoEngine.
+class IoEngine {
+  public:
+    static constexpr size_t BATCH = 32;  //!< most datagrams read, or written, per system call
+
+  private:
+    //! A buffer for one received datagram
+    struct ReadSlot {
+        msghdr message{};       //!< for a socket: where recvmsg() puts the datagram and its sender
+        iovec buffer{};         //!< this slot's part of `_read_buffers`
+        Address::Raw source{};  //!< sender of the datagram (for a socket)
+    };
+
+    //! A datagram waiting for flush()
+    struct QueuedWrite {
+        int fd;                              //!< where to write it
+        BufferList payload;                  //!< the datagram
+        std::optional<Address> destination;  //!< for a socket: where to send it
+        std::vector<iovec> iovecs{};         //!< `payload`, for the kernel
+        msghdr message{};                    //!< for a socket: the sendmsg() request
+    };
+
+    IoUring _ring;                          //!< requests to the kernel
+    size_t _slot_size;                      //!< largest datagram that can be read
+    std::vector<char> _read_buffers;        //!< BATCH slots of `_slot_size` bytes, registered with `_ring`
+    std::array<ReadSlot, BATCH> _slots{};   //!< the read slots
+    std::array<size_t, BATCH> _received{};  //!< slot of each datagram of the latest batch, in order
+    std::array<size_t, BATCH> _lengths{};   //!< length of the datagram in each slot
+    size_t _received_count{0};              //!< datagrams in the latest batch
+    std::vector<QueuedWrite> _writes{};     //!< datagrams waiting for flush()
+
+    //! Read up to BATCH datagrams from `fd`, a socket (with recvmsg()) or not (with read())
+    size_t read_batch(FileDescriptor &fd, const bool socket);
+
+  public:
+    //! \param[in] slot_size is the largest datagram that will be read
+    explicit IoEngine(const size_t slot_size = 65536);
+
+    //! \brief Construct an IoEngine in `engine`, if io_uring is available
+    //! \returns whether it was; if not, `engine` stays empty and the caller reads and writes its fds directly
+    static bool try_emplace(std::optional<IoEngine> &engine, const size_t slot_size = 65536);
+
+    //! \name Reads
+    //! Each call replaces the previous batch; a datagram's payload stays valid until the next call.
+    //!@{
+
+    //! \brief Receive the datagrams waiting on `sock` (up to BATCH, and at least one unless none is waiting)
+    //! \returns the number received
+    size_t recv(UDPSocket &sock) { return read_batch(sock, true); }
+
+    //! \brief Read the datagrams waiting on `fd` (e.g. a TUN device), which must not be a socket
+    //! \returns the number read
+    size_t read(FileDescriptor &fd) { return read_batch(fd, false); }
+
+    //! Payload of datagram `n` of the latest batch
+    std::string_view payload(const size_t n) const;
+
+    //! Sender of datagram `n` of the latest batch (from recv())
+    Address source(const size_t n) const;
+    //!@}
+
+    //! \name Writes
+    //!@{
+
+    //! Queue a datagram for `sock` to send to `destination`
+    void sendto(UDPSocket &sock, const Address &destination, BufferList payload);
+
+    //! Queue a datagram to write to `fd`, which must not be a socket
+    void write(FileDescriptor &fd, BufferList payload);
+
+    //! Send all queued datagrams, with one system call
+    void flush();
+
+    //! Number of datagrams waiting for flush()
+    size_t queued() const { return _writes.size(); }
+    //!@}
+};
+
+#endif  // SPONGE_LIBSPONGE_IO_ENGINE_HH
@@ -0,0 +1,124 @@
+#include "io_uring.hh"
+
+#include "util.hh"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace std;
+
+//! Map a region of the ring's memory
+static void *map_ring(const int ring_fd, const size_t length, const off_t offset) {
+    void *const ptr = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, offset);
+    if (ptr == MAP_FAILED) {
+        throw unix_error("mmap");
+    }
+    return ptr;
+}
+
+//! Address `offset` bytes into a mapping
+template <typename T>
+static T *at(void *base, const uint32_t offset) {
+    return reinterpret_cast<T *>(static_cast<char *>(base) + offset);
+}
+
+//! Call [io_uring_setup(2)](\ref man2::io_uring_setup), filling in `params`
+static int setup_ring(const unsigned entries, io_uring_params &params) {
+    return SystemCall("io_uring_setup", static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params)));
+}
+
+IoUring::IoUring(const unsigned entries) : IoUring(entries, io_uring_params{}) {}
+
+//! \param[in] entries is the least number of requests that can be prepared before they are submitted
+//! \param[in] params is filled in by the kernel with the layout of the rings
+IoUring::IoUring(const unsigned entries, io_uring_params params) : _ring(setup_ring(entries, params)) {
+    try {
+        _sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        _cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single_mmap) {
+            _sq_ring_size = _cq_ring_size = max(_sq_ring_size, _cq_ring_size);
+        }
+
+        _sq_ring = map_ring(_ring.fd_num(), _sq_ring_size, IORING_OFF_SQ_RING);
+        _cq_ring = single_mmap ? _sq_ring : map_ring(_ring.fd_num(), _cq_ring_size, IORING_OFF_CQ_RING);
+        _sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        _sqes = static_cast<io_uring_sqe *>(map_ring(_ring.fd_num(), _sqes_size, IORING_OFF_SQES));
+    } catch (...) {
+        unmap();
+        throw;
+    }
+
+    _sq_tail = at<unsigned>(_sq_ring, params.sq_off.tail);
+    _sq_array = at<unsigned>(_sq_ring, params.sq_off.array);
+    _sq_mask = *at<unsigned>(_sq_ring, params.sq_off.ring_mask);
+    _cq_head = at<unsigned>(_cq_ring, params.cq_off.head);
+    _cq_tail = at<unsigned>(_cq_ring, params.cq_off.tail);
+    _cqes = at<io_uring_cqe>(_cq_ring, params.cq_off.cqes);
+    _cq_mask = *at<unsigned>(_cq_ring, params.cq_off.ring_mask);
+    _entries = params.sq_entries;
+}
+
+IoUring::~IoUring() { unmap(); }
+
+void IoUring::unmap() {
+    if (_sqes != nullptr) {
+        ::munmap(_sqes, _sqes_size);
+    }
+    if (_cq_ring != nullptr and _cq_ring != _sq_ring) {
+        ::munmap(_cq_ring, _cq_ring_size);
+    }
+    if (_sq_ring != nullptr) {
+        ::munmap(_sq_ring, _sq_ring_size);
+    }
+    _sqes = nullptr;
+    _sq_ring = _cq_ring = nullptr;
+}
+
+//! \details Uses [io_uring_register(2)](\ref man2::io_uring_register). The buffers must outlive the
+//! requests that use them; request `n` of a fixed-buffer operation names buffer `n` in `buf_index`.
+void IoUring::register_buffers(const vector<iovec> &buffers) {
+    SystemCall("io_uring_register",
+               static_cast<int>(::syscall(
+                   __NR_io_uring_register, _ring.fd_num(), IORING_REGISTER_BUFFERS, buffers.data(), buffers.size())));
+}
+
+io_uring_sqe *IoUring::prepare() {
+    if (_prepared == _entries) {
+        return nullptr;
+    }
+    // the kernel consumes the whole submission queue on each io_uring_enter(), so the tail is ours
+    const unsigned tail = *_sq_tail + _prepared;
+    const unsigned index = tail & _sq_mask;
+    io_uring_sqe *const sqe = &_sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    _sq_array[index] = index;
+    _prepared++;
+    return sqe;
+}
+
+void IoUring::enter(const unsigned wait_nr) {
+    const unsigned to_submit = _prepared;
+    if (to_submit > 0) {
+        __atomic_store_n(_sq_tail, *_sq_tail + to_submit, __ATOMIC_RELEASE);
+        _prepared = 0;
+    }
+
+    unsigned submitted = 0;
+    while (true) {
+        const int ret = static_cast<int>(::syscall(
+            __NR_io_uring_enter, _ring.fd_num(), to_submit - submitted, wait_nr, IORING_ENTER_GETEVENTS, nullptr, 0));
+        if (ret >= 0) {
+            submitted += static_cast<unsigned>(ret);
+            if (submitted == to_submit) {
+                return;
+            }
+        } else if (errno != EINTR) {
+            throw unix_error("io_uring_enter");
+        }
+    }
+}
@@ -0,0 +1,97 @@
+#ifndef SPONGE_LIBSPONGE_IO_URING_HH
+#define SPONGE_LIBSPONGE_IO_URING_HH
+
+#include "file_descriptor.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <linux/io_uring.h>
+#include <sys/uio.h>
+#include <vector>
+
+//! \brief An [io_uring(7)](\ref man7::io_uring) instance: a submission queue and a completion queue shared
+//! with the kernel
+//! \details Requests are prepared in submission queue entries (SQEs), handed to the kernel in bulk by one
+//! [io_uring_enter(2)](\ref man2::io_uring_enter), and their results read from completion queue entries
+//! (CQEs), without a system call per request. This is the raw kernel interface (there is no liburing);
+//! the constructor throws unix_error where the kernel does not offer io_uring (or forbids it).
+class IoUring {
+  private:
+    FileDescriptor _ring;  //!< the instance
+
+    //! \name Memory shared with the kernel
+    //!@{
+    void *_sq_ring{nullptr};       //!< submission queue ring
+    size_t _sq_ring_size{0};       //!< its length
+    void *_cq_ring{nullptr};       //!< completion queue ring (the same mapping, on most kernels)
+    size_t _cq_ring_size{0};       //!< its length
+    io_uring_sqe *_sqes{nullptr};  //!< submission queue entries
+    size_t _sqes_size{0};          //!< their length
+    //!@}
+
+    //! \name Pointers into the rings
+    //!@{
+    unsigned *_sq_tail{nullptr};
+    unsigned *_sq_array{nullptr};
+    unsigned _sq_mask{0};
+    unsigned *_cq_head{nullptr};
+    unsigned *_cq_tail{nullptr};
+    io_uring_cqe *_cqes{nullptr};
+    unsigned _cq_mask{0};
+    //!@}
+
+    unsigned _entries{0};   //!< size of the submission queue
+    unsigned _prepared{0};  //!< SQEs prepared and not yet submitted
+
+    //! Map the rings whose layout the kernel described in `params`
+    IoUring(const unsigned entries, io_uring_params params);
+
+    //! Release the mappings
+    void unmap();
+
+    //! Hand prepared SQEs to the kernel and wait for `wait_nr` completions
+    void enter(const unsigned wait_nr);
+
+  public:
+    //! \param[in] entries is the least number of requests that can be prepared before they are submitted
+    explicit IoUring(const unsigned entries);
+    ~IoUring();
+
+    //! \brief Register buffers with the kernel, for requests with fixed buffers (e.g. IORING_OP_READ_FIXED)
+    //! \details The kernel pins them once, instead of mapping the memory for each request.
+    void register_buffers(const std::vector<iovec> &buffers);
+
+    //! \brief An SQE to fill in (cleared), or `nullptr` if all of them are prepared already
+    io_uring_sqe *prepare();
+
+    //! \brief Submit the prepared SQEs and wait for `count` completions, calling `on_completion(user_data, res)`
+    //! for each in the order they complete
+    template <typename F>
+    void complete(const unsigned count, F &&on_completion) {
+        unsigned done = 0;
+        while (done < count) {
+            enter(count - done);
+            unsigned head = *_cq_head;
+            const unsigned tail = __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE);
+            for (; head != tail and done < count; head++, done++) {
+                const io_uring_cqe &cqe = _cqes[head & _cq_mask];
+                on_completion(cqe.user_data, cqe.res);
+            }
+            __atomic_store_n(_cq_head, head, __ATOMIC_RELEASE);
+        }
+    }
+
+    //! \brief Number of SQEs that can be prepared before they are submitted
+    unsigned entries() const { return _entries; }
+
+    //! \name
+    //! An IoUring owns memory mapped from the kernel, and cannot be copied or moved
+    //!@{
+    IoUring(const IoUring &other) = delete;
+    IoUring &operator=(const IoUring &other) = delete;
+    IoUring(IoUring &&other) = delete;
+    IoUring &operator=(IoUring &&other) = delete;
+    //!@}
+};
+
+#endif  // SPONGE_LIBSPONGE_IO_URING_HH
@@ -0,0 +1,104 @@
+#ifndef SPONGE_LIBSPONGE_RING_QUEUE_HH
+#define SPONGE_LIBSPONGE_RING_QUEUE_HH
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+//! \brief A FIFO queue in a ring of slots, with indexed access from the front
+//! \details The ring's capacity is a power of two and only grows (doubling, when a push finds it full),
+//! so a queue that is filled and drained repeatedly stops allocating once it has reached its working
+//! size. Elements are reached by position in O(1), which allows binary searches over sorted contents.
+//! Popped slots are reset to `T{}` right away (so a popped Buffer releases its storage).
+template <typename T>
+class RingQueue {
+  private:
+    static constexpr size_t INITIAL_CAPACITY = 16;  //!< slots allocated by the first push
+
+    std::vector<T> _slots{};  //!< the ring (empty, or a power of two in size)
+    size_t _head{0};          //!< slot of the front element
+    size_t _size{0};          //!< number of elements
+
+    size_t slot(const size_t n) const { return (_head + n) & (_slots.size() - 1); }
+
+    //! Double the ring, moving the elements to the start of the new one in order
+    void grow() {
+        std::vector<T> slots(std::max(INITIAL_CAPACITY, 2 * _slots.size()));
+        for (size_t i = 0; i < _size; i++) {
+            slots[i] = std::move(_slots[slot(i)]);
+        }
+        _slots = std::move(slots);
+        _head = 0;
+    }
+
+    //! Iterator from front to back, by position
+    template <typename Queue, typename Value>
+    class Iterator {
+      private:
+        Queue *_queue;
+        size_t _index;
+
+      public:
+        Iterator(Queue *queue, const size_t index) : _queue(queue), _index(index) {}
+        Iterator(const Iterator &other) = default;
+        Iterator &operator=(const Iterator &other) = default;
+        ~Iterator() = default;
+
+        Value &operator*() const { return (*_queue)[_index]; }
+        Value *operator->() const { return &(*_queue)[_index]; }
+        Iterator &operator++() {
+            ++_index;
+            return *this;
+        }
+        bool operator==(const Iterator &other) const { return _index == other._index; }
+        bool operator!=(const Iterator &other) const { return _index != other._index; }
+    };
+
+  public:
+    using iterator = Iterator<RingQueue, T>;
+    using const_iterator = Iterator<const RingQueue, const T>;
+
+    bool empty() const { return _size == 0; }
+    size_t size() const { return _size; }
+
+    //! \name Element access, by position from the front
+    //!@{
+    T &operator[](const size_t n) { return _slots[slot(n)]; }
+    const T &operator[](const size_t n) const { return _slots[slot(n)]; }
+    T &front() { return (*this)[0]; }
+    const T &front() const { return (*this)[0]; }
+    T &back() { return (*this)[_size - 1]; }
+    const T &back() const { return (*this)[_size - 1]; }
+    //!@}
+
+    //! \name Iteration from front to back
+    //!@{
+    iterator begin() { return {this, 0}; }
+    iterator end() { return {this, _size}; }
+    const_iterator begin() const { return {this, 0}; }
+    const_iterator end() const { return {this, _size}; }
+    //!@}
+
+    void push_back(T value) {
+        if (_size == _slots.size()) {
+            grow();
+        }
+        _slots[slot(_size)] = std::move(value);
+        _size++;
+    }
+
+    //! Remove the first `n` elements (all of them, if there are fewer)
+    void pop_front(const size_t n = 1) {
+        const size_t count = std::min(n, _size);
+        for (size_t i = 0; i < count; i++) {
+            _slots[slot(i)] = T{};
+        }
+        _head = _size == count ? 0 : slot(count);
+        _size -= count;
+    }
+
+    void clear() { pop_front(_size); }
+};
+
+#endif  // SPONGE_LIBSPONGE_RING_QUEUE_HH
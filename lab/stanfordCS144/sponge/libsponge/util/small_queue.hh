@@ -0,0 +1,146 @@
+#ifndef SPONGE_LIBSPONGE_SMALL_QUEUE_HH
+#define SPONGE_LIBSPONGE_SMALL_QUEUE_HH
+
+#include <array>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+//! \brief A FIFO queue that stores up to `N` elements inline before spilling to the heap
+//! \details Used for the fragments of a BufferList or BufferViewList: a packet is usually
+//! one to three pieces (headers + payload), so building one should not allocate. Elements
+//! are contiguous, so the queue can be iterated with plain pointers. Popped slots are reset
+//! to `T{}` right away (so a popped Buffer releases its storage).
+template <typename T, size_t N>
+class SmallQueue {
+  private:
+    std::array<T, N> _inline{};  //!< storage while the queue has never held more than N elements
+    std::vector<T> _heap{};      //!< storage once it has (until it drains)
+    bool _spilled = false;       //!< whether `_heap` is the active storage
+    size_t _head = 0;            //!< index of the first live element in the active storage
+    size_t _tail = 0;            //!< one past the index of the last live element
+
+    T *storage() { return _spilled ? _heap.data() : _inline.data(); }
+    const T *storage() const { return _spilled ? _heap.data() : _inline.data(); }
+
+    //! Move the live elements of a full inline array to the heap
+    void spill() {
+        _heap.reserve(2 * N);
+        for (size_t i = _head; i < _tail; i++) {
+            _heap.push_back(std::move(_inline[i]));
+            _inline[i] = T{};
+        }
+        _tail -= _head;
+        _head = 0;
+        _spilled = true;
+    }
+
+    //! Move the live elements to the front of the active storage
+    void compact() {
+        T *const data = storage();
+        for (size_t i = _head; i < _tail; i++) {
+            data[i - _head] = std::move(data[i]);
+            data[i] = T{};
+        }
+        _tail -= _head;
+        _head = 0;
+        if (_spilled) {
+            _heap.resize(_tail);
+        }
+    }
+
+    void reset_indices() {
+        _head = _tail = 0;
+        if (_spilled) {
+            _heap.clear();  // keeps capacity for the next burst
+            _spilled = false;
+        }
+    }
+
+  public:
+    SmallQueue() = default;
+
+    //! \name Copy/move constructor/assignment operators
+    //! A moved-from SmallQueue is empty
+    //!@{
+    SmallQueue(const SmallQueue &other) = default;
+    SmallQueue &operator=(const SmallQueue &other) = default;
+
+    SmallQueue(SmallQueue &&other) noexcept
+        : _inline(std::move(other._inline))
+        , _heap(std::move(other._heap))
+        , _spilled(other._spilled)
+        , _head(other._head)
+        , _tail(other._tail) {
+        other._heap.clear();
+        other._spilled = false;
+        other._head = other._tail = 0;
+    }
+
+    SmallQueue &operator=(SmallQueue &&other) noexcept {
+        if (this != &other) {
+            _inline = std::move(other._inline);
+            _heap = std::move(other._heap);
+            _spilled = other._spilled;
+            _head = other._head;
+            _tail = other._tail;
+            other._heap.clear();
+            other._spilled = false;
+            other._head = other._tail = 0;
+        }
+        return *this;
+    }
+    //!@}
+
+    ~SmallQueue() = default;
+
+    bool empty() const { return _head == _tail; }
+    size_t size() const { return _tail - _head; }
+
+    //! \name Element access
+    //!@{
+    T &front() { return storage()[_head]; }
+    const T &front() const { return storage()[_head]; }
+    const T &operator[](const size_t n) const { return storage()[_head + n]; }
+    //!@}
+
+    //! \name Iteration from front to back
+    //!@{
+    const T *begin() const { return storage() + _head; }
+    const T *end() const { return storage() + _tail; }
+    //!@}
+
+    void push_back(T value) {
+        if (not _spilled and _tail == N) {
+            if (_head > 0) {
+                compact();
+            } else {
+                spill();
+            }
+        } else if (_spilled and _head > 0 and 2 * _head >= _tail) {
+            compact();  // amortized: at least as many pushes happened since the last compaction
+        }
+
+        if (_spilled) {
+            _heap.push_back(std::move(value));
+        } else {
+            _inline[_tail] = std::move(value);
+        }
+        _tail++;
+    }
+
+    void pop_front() {
+        storage()[_head] = T{};
+        if (++_head == _tail) {
+            reset_indices();
+        }
+    }
+
+    void clear() {
+        while (not empty()) {
+            pop_front();
+        }
+    }
+};
+
+#endif  // SPONGE_LIBSPONGE_SMALL_QUEUE_HH
@@ -85,17 +85,31 @@ void Socket::shutdown(const int how) {
 }
 
 //! \note If `mtu` is too small to hold the received datagram, this method throws a std::runtime_error
-void UDPSocket::recv(received_datagram &datagram, const size_t mtu) {
+void UDPSocket::recv(received_datagram &datagram, const size_t mtu) { recv_with_flags(datagram, mtu, 0); }
+
+bool UDPSocket::recv_with_flags(received_datagram &datagram, const size_t mtu, const int flags) {
     // receive source address and payload
     Address::Raw datagram_source_address;
     datagram.payload.resize(mtu);
 
     socklen_t fromlen = sizeof(datagram_source_address);
 
-    const ssize_t recv_len = SystemCall(
-        "recvfrom",
-        ::recvfrom(
-            fd_num(), datagram.payload.data(), datagram.payload.size(), MSG_TRUNC, datagram_source_address, &fromlen));
+    const ssize_t recv_len = SystemCall("recvfrom",
+                                        ::recvfrom(fd_num(),
+                                                   datagram.payload.data(),
+                                                   datagram.payload.size(),
+                                                   MSG_TRUNC | flags,
+                                                   datagram_source_address,
+                                                   &fromlen),
+                                        EAGAIN);
+
+    if (recv_len < 0) {
+        if (not(flags & MSG_DONTWAIT)) {
+            throw unix_error("recvfrom");  // (a non-blocking socket with nothing to read)
+        }
+        datagram.payload.clear();
+        return false;
+    }
 
     if (recv_len > ssize_t(mtu)) {
         throw runtime_error("recvfrom (oversized datagram)");
@@ -104,6 +118,7 @@ void UDPSocket::recv(received_datagram &datagram, const size_t mtu) {
     register_read();
     datagram.source_address = {datagram_source_address, fromlen};
     datagram.payload.resize(recv_len);
+    return true;
 }
 
 UDPSocket::received_datagram UDPSocket::recv(const size_t mtu) {
@@ -166,3 +181,7 @@ void Socket::setsockopt(const int level, const int option, const option_type &op
 // allow local address to be reused sooner, at the cost of some robustness
 //! \note Using `SO_REUSEADDR` may reduce the robustness of your application
 void Socket::set_reuseaddr() { setsockopt(SOL_SOCKET, SO_REUSEADDR, int(true)); }
+
+//! \note Every socket bound to the address must set this first; the kernel spreads datagrams among them
+//! by a hash of the sender's address, so all of one sender's datagrams reach the same socket.
+void Socket::set_reuseport() { setsockopt(SOL_SOCKET, SO_REUSEPORT, int(true)); }
@@ -45,10 +45,24 @@ class Socket : public FileDescriptor {
 
     //! Allow local address to be reused sooner via [SO_REUSEADDR](\ref man7::socket)
     void set_reuseaddr();
+
+    //! Let other sockets bind the same address, sharing its traffic, via [SO_REUSEPORT](\ref man7::socket)
+    void set_reuseport();
 };
 
 //! A wrapper around [UDP sockets](\ref man7::udp)
 class UDPSocket : public Socket {
+  public:
+    //! Returned by UDPSocket::recv; carries received data and information about the sender
+    struct received_datagram {
+        Address source_address;  //!< Address from which this datagram was received
+        std::string payload;     //!< UDP datagram payload
+    };
+
+  private:
+    //! Receive a datagram with [recvfrom(2)](\ref man2::recvfrom) `flags`, returning `false` on EAGAIN
+    bool recv_with_flags(received_datagram &datagram, const size_t mtu, const int flags);
+
   protected:
     //! \brief Construct from FileDescriptor (used by TCPOverUDPSocketAdapter)
     //! \param[in] fd is the FileDescriptor from which to construct
@@ -58,18 +72,18 @@ class UDPSocket : public Socket {
     //! Default: construct an unbound, unconnected UDP socket
     UDPSocket() : Socket(AF_INET, SOCK_DGRAM) {}
 
-    //! Returned by UDPSocket::recv; carries received data and information about the sender
-    struct received_datagram {
-        Address source_address;  //!< Address from which this datagram was received
-        std::string payload;     //!< UDP datagram payload
-    };
-
     //! Receive a datagram and the Address of its sender
     received_datagram recv(const size_t mtu = 65536);
 
     //! Receive a datagram and the Address of its sender (caller can allocate storage)
     void recv(received_datagram &datagram, const size_t mtu = 65536);
 
+    //! \brief Receive a datagram if one is already waiting, without blocking (even on a blocking socket)
+    //! \returns `false` if none was
+    bool try_recv(received_datagram &datagram, const size_t mtu = 65536) {
+        return recv_with_flags(datagram, mtu, MSG_DONTWAIT);
+    }
+
     //! Send a datagram to specified Address
     void sendto(const Address &destination, const BufferViewList &payload);
 
@@ -0,0 +1,81 @@
+#ifndef SPONGE_LIBSPONGE_SPSC_QUEUE_HH
+#define SPONGE_LIBSPONGE_SPSC_QUEUE_HH
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+//! \brief A bounded FIFO queue from one producer thread to one consumer thread, without locks
+//! \details A ring of slots (its capacity rounded up to a power of two), indexed by two counters that only
+//! grow: the producer alone advances `_tail`, the consumer alone `_head`, each publishing its progress with a
+//! release store that the other side reads with an acquire load. Each counter has a cache line to itself,
+//! together with its owner's last reading of the other counter, so the two threads share a line only when
+//! the queue looks full (to the producer) or empty (to the consumer).
+//! Popped slots are reset to `T{}` right away, as in RingQueue.
+template <typename T>
+class SpscQueue {
+  private:
+    static constexpr size_t CACHE_LINE = 64;  //!< (to keep the two threads' counters apart)
+
+    std::vector<T> _slots;  //!< the ring
+    size_t _mask;           //!< capacity - 1
+
+    alignas(CACHE_LINE) std::atomic<size_t> _head{0};  //!< count of elements popped (the consumer's)
+    size_t _tail_seen{0};                              //!< the consumer's last reading of `_tail`
+
+    alignas(CACHE_LINE) std::atomic<size_t> _tail{0};  //!< count of elements pushed (the producer's)
+    size_t _head_seen{0};                              //!< the producer's last reading of `_head`
+
+    static size_t round_up(const size_t capacity) {
+        size_t rounded = 1;
+        while (rounded < capacity) {
+            rounded *= 2;
+        }
+        return rounded;
+    }
+
+  public:
+    //! \param[in] capacity is the most elements the queue holds at once (rounded up to a power of two)
+    explicit SpscQueue(const size_t capacity) : _slots(round_up(capacity)), _mask(_slots.size() - 1) {}
+
+    //! \brief Add an element at the back (from the producer thread only)
+    //! \returns false, leaving `value` alone, if the queue is full
+    bool push(T &&value) {
+        const size_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail - _head_seen == _slots.size()) {
+            _head_seen = _head.load(std::memory_order_acquire);
+            if (tail - _head_seen == _slots.size()) {
+                return false;
+            }
+        }
+        _slots[tail & _mask] = std::move(value);
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    //! \brief Take the element at the front (from the consumer thread only)
+    //! \returns false, leaving `value` alone, if the queue is empty
+    bool pop(T &value) {
+        const size_t head = _head.load(std::memory_order_relaxed);
+        if (head == _tail_seen) {
+            _tail_seen = _tail.load(std::memory_order_acquire);
+            if (head == _tail_seen) {
+                return false;
+            }
+        }
+        T &slot = _slots[head & _mask];
+        value = std::move(slot);
+        slot = T{};
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    //! \brief Whether the queue is empty (exact on the consumer thread; a snapshot on any other)
+    bool empty() const { return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_acquire); }
+
+    //! \brief The most elements the queue holds at once
+    size_t capacity() const { return _slots.size(); }
+};
+
+#endif  // SPONGE_LIBSPONGE_SPSC_QUEUE_HH
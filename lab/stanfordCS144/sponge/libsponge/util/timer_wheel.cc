@@ -0,0 +1,134 @@
+#include "timer_wheel.hh"
+
+#include <algorithm>
+
+using namespace std;
+
+//! Ticks covered by one slot at `level`
+static constexpr uint64_t span(const size_t level) { return uint64_t{1} << (TimerWheel::SLOT_BITS * level); }
+
+TimerWheel::TimerWheel(const uint64_t resolution_us, const uint64_t now_us)
+    : _resolution_us(max<uint64_t>(resolution_us, 1)), _now_tick(now_us / _resolution_us) {}
+
+void TimerWheel::place(Timer &&timer) {
+    if (timer.tick < _now_tick) {
+        _where[timer.id] = {LEVELS, 0};
+        _overdue.push_back(move(timer));
+        return;
+    }
+    const uint64_t delta = timer.tick - _now_tick;
+
+    size_t level = 0;
+    while (level + 1 < LEVELS and delta >= span(level + 1)) {
+        level++;
+    }
+    // beyond the top level's reach: park in its farthest slot, and look again when that slot cascades
+    const uint64_t slot_tick = delta >= span(LEVELS) ? _now_tick + span(LEVELS) - 1 : timer.tick;
+    const size_t slot = (slot_tick >> (SLOT_BITS * level)) & (SLOTS - 1);
+
+    _where[timer.id] = {level, slot};
+    _wheels.at(level).at(slot).push_back(move(timer));
+}
+
+void TimerWheel::cascade(const size_t level) {
+    Slot batch{};
+    swap(batch, _wheels.at(level).at((_now_tick >> (SLOT_BITS * level)) & (SLOTS - 1)));
+    for (auto &timer : batch) {
+        place(move(timer));
+    }
+}
+
+size_t TimerWheel::fire(Slot &slot) {
+    size_t fired = 0;
+    // callbacks may add timers for this same tick, so keep going until the slot stays empty
+    while (not slot.empty()) {
+        Slot batch{};
+        swap(batch, slot);
+        for (auto &timer : batch) {
+            if (_where.erase(timer.id) == 0) {
+                continue;  // cancelled by an earlier callback in this batch
+            }
+            timer.callback();
+            fired++;
+        }
+    }
+    return fired;
+}
+
+TimerWheel::TimerId TimerWheel::schedule(const uint64_t when_us, Callback callback) {
+    const TimerId id = _next_id++;
+    const uint64_t tick = when_us / _resolution_us + (when_us % _resolution_us == 0 ? 0 : 1);
+    place({id, tick, move(callback)});
+    return id;
+}
+
+bool TimerWheel::cancel(const TimerId id) {
+    const auto it = _where.find(id);
+    if (it == _where.end()) {
+        return false;
+    }
+    auto &slot = it->second.first == LEVELS ? _overdue : _wheels.at(it->second.first).at(it->second.second);
+    const auto timer = find_if(slot.begin(), slot.end(), [&](const Timer &t) { return t.id == id; });
+    if (timer != slot.end()) {  // (otherwise it is in a batch that advance() is firing)
+        slot.erase(timer);
+    }
+    _where.erase(it);
+    return true;
+}
+
+size_t TimerWheel::advance(const uint64_t now_us) {
+    const uint64_t target = now_us / _resolution_us;
+    size_t fired = 0;
+
+    while (true) {
+        fired += fire(_overdue);
+        if (_now_tick > target) {
+            break;
+        }
+
+        // skip straight to the next tick with work: slots in between are empty
+        const auto next = next_tick();
+        if (not next.has_value() or next.value() > target) {
+            _now_tick = target + 1;
+            continue;
+        }
+        _now_tick = next.value();
+
+        for (size_t level = LEVELS - 1; level > 0; level--) {
+            if (_now_tick % span(level) == 0) {
+                cascade(level);
+            }
+        }
+        fired += fire(_wheels.front().at(_now_tick & (SLOTS - 1)));
+        _now_tick++;
+    }
+
+    return fired;
+}
+
+optional<uint64_t> TimerWheel::next_tick() const {
+    optional<uint64_t> earliest{};
+    for (size_t level = 0; level < LEVELS; level++) {
+        // a level's slots are visited at multiples of its span, in index order, starting from the current tick
+        const uint64_t first = (_now_tick + span(level) - 1) / span(level);
+        for (size_t i = 0; i < SLOTS; i++) {
+            const uint64_t position = first + i;
+            if (not _wheels.at(level).at(position & (SLOTS - 1)).empty()) {
+                earliest = min(earliest.value_or(position * span(level)), position * span(level));
+                break;
+            }
+        }
+    }
+    return earliest;
+}
+
+optional<uint64_t> TimerWheel::next_expiry() const {
+    if (not _overdue.empty()) {
+        return (_now_tick > 0 ? _now_tick - 1 : 0) * _resolution_us;  // already due
+    }
+    const auto tick = next_tick();
+    if (not tick.has_value()) {
+        return {};
+    }
+    return tick.value() * _resolution_us;
+}
@@ -0,0 +1,91 @@
+#ifndef SPONGE_LIBSPONGE_TIMER_WHEEL_HH
+#define SPONGE_LIBSPONGE_TIMER_WHEEL_HH
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+//! \brief Timers with a fixed resolution, kept in a hierarchy of wheels
+//! \details Level 0 has one slot per tick for the next SLOTS ticks; each level above covers SLOTS times
+//! the span of the one below, one slot per span of the level below. A timer is filed at the lowest level
+//! whose span reaches its expiry, and moves down a level ("cascades") when the wheel below wraps around
+//! to its slot. Scheduling, cancelling and firing are then constant time, however many timers are pending,
+//! and advance() only visits the ticks that actually pass.
+//!
+//! Times are in microseconds on the caller's clock. Timers fire from advance(), in the order of their
+//! ticks; a callback may schedule or cancel timers (a timer scheduled for a tick that has already passed
+//! fires before advance() returns, and one scheduled between calls for a time already passed fires on the
+//! next call).
+class TimerWheel {
+  public:
+    using Callback = std::function<void(void)>;  //!< Action run when a timer expires
+    using TimerId = uint64_t;                    //!< Handle for cancel()
+
+    static constexpr size_t SLOT_BITS = 6;                   //!< log2 of the slots per level
+    static constexpr size_t SLOTS = size_t{1} << SLOT_BITS;  //!< slots per level
+    static constexpr size_t LEVELS = 4;                      //!< levels (with 100 us ticks: about 28 minutes ahead)
+
+  private:
+    //! A pending timer
+    struct Timer {
+        TimerId id;         //!< handle returned by schedule()
+        uint64_t tick;      //!< tick at which it expires
+        Callback callback;  //!< action to run
+    };
+
+    using Slot = std::vector<Timer>;
+
+    uint64_t _resolution_us;                                          //!< microseconds per tick
+    uint64_t _now_tick;                                               //!< first tick that has not been processed
+    std::array<std::array<Slot, SLOTS>, LEVELS> _wheels{};            //!< slots of each level
+    Slot _overdue{};                                                  //!< timers scheduled for a tick already passed
+    std::unordered_map<TimerId, std::pair<size_t, size_t>> _where{};  //!< level (LEVELS: overdue) and slot
+    TimerId _next_id{1};                                              //!< handle for the next timer
+
+    //! File a timer in the slot for its tick, relative to `_now_tick`
+    void place(Timer &&timer);
+
+    //! Re-file the timers of a slot at level `level` > 0 one or more levels down
+    void cascade(const size_t level);
+
+    //! First tick at which a slot must be processed (a level-0 slot fires, a higher one cascades)
+    std::optional<uint64_t> next_tick() const;
+
+    //! Run the timers of a slot (which callbacks may refill), returning how many ran
+    size_t fire(Slot &slot);
+
+  public:
+    //! \param[in] resolution_us is the length of a tick, in microseconds
+    //! \param[in] now_us is the current time
+    explicit TimerWheel(const uint64_t resolution_us = 100, const uint64_t now_us = 0);
+
+    //! \brief Run `callback` once the clock passed to advance() reaches `when_us`
+    //! \details Expiry is rounded up to a whole tick, so a timer never fires early.
+    TimerId schedule(const uint64_t when_us, Callback callback);
+
+    //! \brief Remove a pending timer
+    //! \returns `false` if it already fired or was cancelled
+    bool cancel(const TimerId id);
+
+    //! \brief Move the clock to `now_us`, running every timer that has expired by then
+    //! \returns the number of timers run
+    size_t advance(const uint64_t now_us);
+
+    //! \brief Earliest time advance() has work to do: a timer expires, or one must cascade
+    //! \details A caller that sleeps until then (e.g. as a poll timeout) never misses a timer.
+    //! Empty when no timers are pending.
+    std::optional<uint64_t> next_expiry() const;
+
+    //! \brief Number of pending timers
+    size_t size() const { return _where.size(); }
+
+    //! \brief Length of a tick, in microseconds
+    uint64_t resolution() const { return _resolution_us; }
+};
+
+#endif  // SPONGE_LIBSPONGE_TIMER_WHEEL_HH
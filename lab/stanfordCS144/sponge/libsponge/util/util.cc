@@ -11,11 +11,13 @@
 using namespace std;
 
 //! \returns the number of milliseconds since the program started
-uint64_t timestamp_ms() {
+uint64_t timestamp_ms() { return timestamp_us() / 1000; }
+
+uint64_t timestamp_us() {
     using time_point = std::chrono::steady_clock::time_point;
     static const time_point program_start = std::chrono::steady_clock::now();
     const time_point now = std::chrono::steady_clock::now();
-    return std::chrono::duration_cast<std::chrono::milliseconds>(now - program_start).count();
+    return std::chrono::duration_cast<std::chrono::microseconds>(now - program_start).count();
 }
 
 //! \param[in] attempt is the name of the syscall to try (for error reporting)
@@ -51,6 +51,9 @@ std::mt19937 get_random_generator();
 //! Get the time in milliseconds since the program began.
 uint64_t timestamp_ms();
 
+//! Get the time in microseconds since the program began (on the same clock as timestamp_ms()).
+uint64_t timestamp_us();
+
 //! The internet checksum algorithm
 class InternetChecksum {
   private:
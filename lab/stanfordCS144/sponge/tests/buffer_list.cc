@@ -0,0 +1,121 @@
+#include "buffer.hh"
+#include "byte_stream.hh"
+#include "test_should_be.hh"
+
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main() {
+    try {
+        // header + payload stays inline, and sizes are tracked as fragments come and go
+        {
+            BufferList list{string("header")};
+            list.append(Buffer{string("payload")});
+            test_should_be(list.size(), size_t(13));
+            test_should_be(list.buffers().size(), size_t(2));
+
+            list.remove_prefix(8);
+            test_should_be(list.size(), size_t(5));
+            test_should_be(list.buffers().size(), size_t(1));
+            test_should_be(list.concatenate() == "yload", true);
+        }
+
+        // many fragments spill to the heap, drain in order, and the list can be reused
+        {
+            BufferList list;
+            string expected;
+            for (size_t round = 0; round < 3; round++) {
+                for (size_t i = 0; i < 20; i++) {
+                    const string piece(i + 1, static_cast<char>('a' + i));
+                    list.append(string(piece));
+                    expected.append(piece);
+                    if (i % 3 == 2) {
+                        list.remove_prefix(2);
+                        expected.erase(0, 2);
+                    }
+                    test_should_be(list.size(), expected.size());
+                }
+                test_should_be(list.concatenate() == expected, true);
+
+                const BufferViewList views{list};
+                test_should_be(views.size(), expected.size());
+
+                list.remove_prefix(list.size());
+                expected.clear();
+                test_should_be(list.buffers().empty(), true);
+            }
+        }
+
+        // views track their size through appends and partial removals
+        {
+            BufferViewList views{"abc"};
+            views.append("defg");
+            views.append("");
+            views.append("hi");
+            test_should_be(views.size(), size_t(9));
+            views.remove_prefix(4);
+            test_should_be(views.size(), size_t(5));
+            test_should_be(views.as_iovecs().size(), size_t(2));
+            views.remove_prefix(5);
+            test_should_be(views.size(), size_t(0));
+        }
+
+        // copies are independent, and a moved-from list is empty
+        {
+            BufferList list{string("one")};
+            list.append(string("two"));
+            list.append(string("three"));
+            list.append(string("four"));
+
+            BufferList copy = list;
+            copy.remove_prefix(4);
+            test_should_be(list.concatenate() == "onetwothreefour", true);
+            test_should_be(copy.concatenate() == "wothreefour", true);
+
+            BufferList moved = move(copy);
+            test_should_be(moved.size(), size_t(11));
+            test_should_be(copy.size(), size_t(0));
+            test_should_be(copy.buffers().empty(), true);
+        }
+
+        // a Buffer can be trimmed at both ends, and shares its storage while it is
+        {
+            Buffer whole{string("0123456789")};
+            Buffer slice = whole;
+            slice.remove_prefix(2);
+            slice.remove_suffix(3);
+            test_should_be(slice.copy() == "23456", true);
+            test_should_be(whole.copy() == "0123456789", true);
+            test_should_be(slice.str().data() == whole.str().data() + 2, true);
+
+            slice.remove_suffix(5);
+            test_should_be(slice.size(), size_t(0));
+        }
+
+        // a stream hands out its stored bytes as slices (no copy) when they lie in one Buffer
+        {
+            ByteStream stream{100};
+            Buffer written{string("abcdefgh")};
+            stream.write(written);
+            stream.write(string("ij"));
+
+            const Buffer first = stream.read_buffer(3);
+            test_should_be(first.copy() == "abc", true);
+            test_should_be(first.str().data() == written.str().data(), true);
+
+            const Buffer across = stream.read_buffer(6);  // spans two stored Buffers: copied
+            test_should_be(across.copy() == "defghi", true);
+            test_should_be(stream.buffer_size(), size_t(1));
+            test_should_be(stream.read_buffer(5).copy() == "j", true);
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,74 @@
+#include "buffer.hh"
+#include "buffer_pool.hh"
+#include "test_should_be.hh"
+
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+int main() {
+    try {
+        auto &pool = BufferPool::local();
+
+        // a chunk-sized string handed to a Buffer comes back to the pool once the Buffer is gone
+        {
+            string chunk = pool.acquire();
+            test_should_be(chunk.empty(), true);
+            test_should_be(chunk.capacity() >= BufferPool::CHUNK_SIZE, true);
+            chunk.append("hello");
+            const char *storage = chunk.data();
+            {
+                Buffer buf{move(chunk)};
+                Buffer copy = buf;
+                copy.remove_prefix(2);
+                test_should_be(copy.str() == "llo", true);
+            }
+
+            const uint64_t hits = pool.stats().hits;
+            string again = pool.acquire(100);
+            test_should_be(pool.stats().hits, hits + 1);
+            test_should_be(again.data() == storage, true);
+            test_should_be(again.empty(), true);
+        }
+
+        // oversized requests are not pooled, and their storage is not kept
+        {
+            const uint64_t misses = pool.stats().misses;
+            string big = pool.acquire(BufferPool::CHUNK_SIZE * 4);
+            test_should_be(big.capacity() >= BufferPool::CHUNK_SIZE * 4, true);
+            test_should_be(pool.stats().misses, misses);
+            Buffer buf{move(big)};
+        }
+
+        // blocks are recycled, and the high-water mark tracks the most Buffers alive at once
+        {
+            vector<Buffer> buffers;
+            for (size_t i = 0; i < 50; i++) {
+                buffers.emplace_back(string(BufferPool::CHUNK_SIZE / 2, 'x'));
+            }
+            test_should_be(pool.stats().in_use >= 50, true);
+            test_should_be(pool.stats().high_water >= 50, true);
+            buffers.clear();
+
+            Buffer warm_up{pool.acquire()};
+            warm_up = Buffer{};
+
+            const size_t high_water = pool.stats().high_water;
+            const uint64_t misses = pool.stats().misses;
+            for (size_t i = 0; i < 50; i++) {
+                Buffer buf{pool.acquire()};
+            }
+            test_should_be(pool.stats().misses, misses);
+            test_should_be(pool.stats().high_water, high_water);
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,95 @@
+#include "byte_stream.hh"
+#include "byte_stream_test_harness.hh"
+#include "util.hh"
+
+#include <exception>
+#include <iostream>
+
+using namespace std;
+
+int main() {
+    try {
+        const auto RING = ByteStream::Backend::Ring;
+
+        {
+            ByteStreamTestHarness test{"ring: overwrite", 2, RING};
+
+            test.execute(Write{"cat"}.with_bytes_written(2));
+            test.execute(RemainingCapacity{0});
+            test.execute(BufferSize{2});
+            test.execute(Peek{"ca"});
+
+            test.execute(Write{"t"}.with_bytes_written(0));
+            test.execute(BytesWritten{2});
+            test.execute(Peek{"ca"});
+        }
+
+        {
+            ByteStreamTestHarness test{"ring: wrap around the end", 5, RING};
+
+            test.execute(Write{"abcd"}.with_bytes_written(4));
+            test.execute(Pop{3});
+            test.execute(Write{"efgh"}.with_bytes_written(4));
+
+            test.execute(BufferSize{5});
+            test.execute(RemainingCapacity{0});
+            test.execute(Peek{"defgh"});
+
+            test.execute(Pop{2});
+            test.execute(Write{"ijk"}.with_bytes_written(2));
+            test.execute(Peek{"fghij"});
+            test.execute(BytesRead{5});
+            test.execute(BytesWritten{10});
+        }
+
+        {
+            ByteStreamTestHarness test{"ring: drain and end", 3, RING};
+
+            test.execute(Write{"xyz"}.with_bytes_written(3));
+            test.execute(Pop{3});
+            test.execute(BufferEmpty{true});
+            test.execute(Write{"uv"}.with_bytes_written(2));
+            test.execute(EndInput{});
+            test.execute(Peek{"uv"});
+            test.execute(Eof{false});
+            test.execute(Pop{2});
+            test.execute(Eof{true});
+        }
+
+        {
+            ByteStreamTestHarness test{"ring: zero capacity", 0, RING};
+
+            test.execute(Write{"a"}.with_bytes_written(0));
+            test.execute(Pop{0});
+            test.execute(BufferEmpty{true});
+            test.execute(RemainingCapacity{0});
+        }
+
+        {
+            auto rd = get_random_generator();
+            const size_t CAPACITY = 97;
+            ByteStream list{CAPACITY};
+            ByteStreamTestHarness test{"ring: random writes and pops match list backend", CAPACITY, RING};
+
+            for (size_t i = 0; i < 2000; ++i) {
+                string d(rd() % 40, 0);
+                generate(d.begin(), d.end(), [&] { return 'a' + (rd() % 26); });
+                const size_t accepted = list.write(d);
+                test.execute(Write{d}.with_bytes_written(accepted));
+
+                const size_t pop = rd() % 40;
+                test.execute(Peek{list.peek_output(pop)});
+                test.execute(Pop{pop});
+                list.pop_output(pop);
+
+                test.execute(BufferSize{list.buffer_size()});
+                test.execute(BytesRead{list.bytes_read()});
+            }
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -45,8 +45,10 @@ void ByteStreamAction::execute(ByteStream &) const {}
 
 ByteStreamAction::~ByteStreamAction() {}
 
-ByteStreamTestHarness::ByteStreamTestHarness(const std::string &test_name, const size_t capacity)
-    : _test_name(test_name), _byte_stream(capacity) {
+ByteStreamTestHarness::ByteStreamTestHarness(const std::string &test_name,
+                                             const size_t capacity,
+                                             const ByteStream::Backend backend)
+    : _test_name(test_name), _byte_stream(capacity, backend) {
     std::ostringstream ss;
     ss << "Initialized with ("
        << "capacity=" << capacity << ")";
@@ -181,4 +183,13 @@ void Peek::execute(ByteStream &bs) const {
         throw ByteStreamExpectationViolation("Expected \"" + _output + "\" at the front of the stream, but found \"" +
                                              output + "\"");
     }
+
+    std::string viewed;
+    for (const auto &iov : bs.peek_output_views(_output.size()).as_iovecs()) {
+        viewed.append(static_cast<const char *>(iov.iov_base), iov.iov_len);
+    }
+    if (viewed != _output) {
+        throw ByteStreamExpectationViolation("Expected \"" + _output + "\" in the views of the stream, but found \"" +
+                                             viewed + "\"");
+    }
 }
@@ -0,0 +1,190 @@
+#include "eventloop.hh"
+#include "file_descriptor.hh"
+#include "test_should_be.hh"
+#include "util.hh"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+//! Connected, non-blocking Unix-domain stream sockets
+static pair<FileDescriptor, FileDescriptor> socket_pair() {
+    int fds[2];
+    SystemCall("socketpair", ::socketpair(AF_UNIX, SOCK_STREAM, 0, static_cast<int *>(fds)));
+    pair<FileDescriptor, FileDescriptor> ret{FileDescriptor{fds[0]}, FileDescriptor{fds[1]}};
+    ret.first.set_blocking(false);
+    ret.second.set_blocking(false);
+    return ret;
+}
+
+static constexpr chrono::microseconds NO_WAIT{0};
+
+static void test_backend(const EventLoop::Backend backend) {
+    // an enabled rule runs when its fd is ready; a disabled one does not
+    {
+        EventLoop loop{backend};
+        auto [a, b] = socket_pair();
+        string received;
+        const auto id = loop.add_rule(a, Direction::In, [&] { received += a.read(); });
+
+        test_should_be(loop.wait_next_event(NO_WAIT) == EventLoop::Result::Timeout, true);
+        b.write("hello");
+        test_should_be(loop.wait_next_event(NO_WAIT) == EventLoop::Result::Success, true);
+        test_should_be(received == "hello", true);
+
+        test_should_be(loop.disable_rule(id), true);
+        b.write("world");
+        // nothing left to poll
+        test_should_be(loop.wait_next_event(NO_WAIT) == EventLoop::Result::Exit, true);
+        test_should_be(received == "hello", true);
+
+        test_should_be(loop.enable_rule(id), true);
+        test_should_be(loop.wait_next_event(NO_WAIT) == EventLoop::Result::Success, true);
+        test_should_be(received == "helloworld", true);
+    }
+
+    // a rule on an fd at EOF is canceled, and its cancel callback runs; the other direction carries on
+    {
+        EventLoop loop{backend};
+        auto [a, b] = socket_pair();
+        bool canceled = false;
+        EventLoop::RuleId writer = 0;
+        const auto reader = loop.add_rule(
+            a, Direction::In, [&] { a.read(); }, {}, [&] { canceled = true; });
+        writer = loop.add_rule(a, Direction::Out, [&] {
+            a.write("x");
+            loop.disable_rule(writer);
+        });
+        test_should_be(loop.size(), size_t{2});
+
+        test_should_be(loop.wait_next_event(NO_WAIT) == EventLoop::Result::Success, true);
+        test_should_be(b.read() == "x", true);
+
+        b.close();
+        test_should_be(loop.wait_next_event(NO_WAIT) == EventLoop::Result::Success, true);
+        test_should_be(canceled, true);
+        test_should_be(loop.size(), size_t{1});
+        test_should_be(loop.set_interest(reader, true), false);
+        test_should_be(loop.remove_rule(writer), true);
+        test_should_be(loop.size(), size_t{0});
+    }
+
+    // a rule with an interest callback is polled only while the callback returns true
+    {
+        EventLoop loop{backend};
+        auto [a, b] = socket_pair();
+        bool want = false;
+        unsigned calls = 0;
+        loop.add_rule(
+            a,
+            Direction::In,
+            [&] {
+                a.read();
+                calls++;
+            },
+            [&] { return want; });
+
+        b.write("data");
+        test_should_be(loop.wait_next_event(NO_WAIT) == EventLoop::Result::Exit, true);
+        want = true;
+        test_should_be(loop.wait_next_event(NO_WAIT) == EventLoop::Result::Success, true);
+        test_should_be(calls, 1u);
+    }
+
+    // a callback may remove its own rule and other rules, even ones whose fds are also ready
+    {
+        EventLoop loop{backend};
+        auto [a, b] = socket_pair();
+        auto [c, d] = socket_pair();
+        unsigned calls = 0;
+        vector<EventLoop::RuleId> ids;
+        const auto callback = [&] {
+            calls++;
+            for (const auto id : ids) {
+                loop.remove_rule(id);
+            }
+        };
+        ids.push_back(loop.add_rule(a, Direction::In, callback));
+        ids.push_back(loop.add_rule(c, Direction::In, callback));
+        b.write("1");
+        d.write("2");
+        test_should_be(loop.wait_next_event(NO_WAIT) == EventLoop::Result::Success, true);
+        test_should_be(calls, 1u);
+        test_should_be(loop.size(), size_t{0});
+        test_should_be(loop.wait_next_event(NO_WAIT) == EventLoop::Result::Exit, true);
+    }
+
+    // a callback that neither reads nor loses interest would spin
+    {
+        EventLoop loop{backend};
+        auto [a, b] = socket_pair();
+        loop.add_rule(a, Direction::In, [] {});
+        b.write("stuck");
+        bool threw = false;
+        try {
+            loop.wait_next_event(NO_WAIT);
+        } catch (const runtime_error &) {
+            threw = true;
+        }
+        test_should_be(threw, true);
+    }
+
+    // among many idle fds, only the ready one's callback runs
+    {
+        EventLoop loop{backend};
+        vector<pair<FileDescriptor, FileDescriptor>> pairs;
+        vector<unsigned> calls(500);
+        pairs.reserve(calls.size());
+        for (size_t i = 0; i < calls.size(); i++) {
+            pairs.push_back(socket_pair());
+            FileDescriptor &fd = pairs.back().first;
+            loop.add_rule(fd, Direction::In, [&, i] {
+                fd.read();
+                calls[i]++;
+            });
+        }
+        for (unsigned round = 0; round < 3; round++) {
+            pairs.at(317).second.write("ping");
+            test_should_be(loop.wait_next_event(NO_WAIT) == EventLoop::Result::Success, true);
+            test_should_be(loop.wait_next_event(NO_WAIT) == EventLoop::Result::Timeout, true);
+        }
+        for (size_t i = 0; i < calls.size(); i++) {
+            test_should_be(calls[i], i == 317 ? 3u : 0u);
+        }
+    }
+}
+
+int main() {
+    try {
+        test_backend(EventLoop::Backend::Poll);
+        test_backend(EventLoop::Backend::Epoll);
+
+        // with epoll, an fd has at most one rule per direction
+        {
+            EventLoop loop{EventLoop::Backend::Epoll};
+            auto [a, b] = socket_pair();
+            loop.add_rule(a, Direction::In, [&] { a.read(); });
+            bool threw = false;
+            try {
+                loop.add_rule(a, Direction::In, [&] { a.read(); });
+            } catch (const runtime_error &) {
+                threw = true;
+            }
+            test_should_be(threw, true);
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
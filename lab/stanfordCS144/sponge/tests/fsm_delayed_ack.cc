@@ -0,0 +1,97 @@
+#include "tcp_config.hh"
+#include "tcp_expectation.hh"
+#include "tcp_fsm_test_harness.hh"
+#include "util.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+using State = TCPTestHarness::State;
+
+int main() {
+    try {
+        TCPConfig cfg{};
+        cfg.delayed_ack = true;
+        const string data(cfg.mss, 'x');
+        auto rd = get_random_generator();
+
+        // in-order data is acknowledged every second segment
+        {
+            const WrappingInt32 tx_isn(rd());
+            const WrappingInt32 rx_isn(rd());
+            TCPTestHarness test_1 = TCPTestHarness::in_established(cfg, tx_isn, rx_isn);
+
+            test_1.send_data(rx_isn + 1, tx_isn + 1, data.cbegin(), data.cend());
+            test_1.execute(ExpectNoSegment{}, "test 1 failed: first segment acknowledged at once");
+            test_1.send_data(rx_isn + 1 + data.size(), tx_isn + 1, data.cbegin(), data.cend());
+            test_1.execute(ExpectOneSegment{}.with_ack(true).with_ackno(rx_isn + 1 + 2 * data.size()),
+                           "test 1 failed: no ACK for two segments");
+
+            test_1.send_data(rx_isn + 1 + 2 * data.size(), tx_isn + 1, data.cbegin(), data.cend());
+            test_1.execute(ExpectNoSegment{}, "test 1 failed: third segment acknowledged at once");
+        }
+
+        // a lone segment is acknowledged once the delay runs out
+        {
+            const WrappingInt32 tx_isn(rd());
+            const WrappingInt32 rx_isn(rd());
+            TCPTestHarness test_2 = TCPTestHarness::in_established(cfg, tx_isn, rx_isn);
+
+            test_2.send_data(rx_isn + 1, tx_isn + 1, data.cbegin(), data.cend());
+            test_2.execute(Tick(cfg.delayed_ack_timeout - 1));
+            test_2.execute(ExpectNoSegment{}, "test 2 failed: ACK sent before the delay ran out");
+            test_2.execute(Tick(1));
+            test_2.execute(ExpectOneSegment{}.with_ack(true).with_ackno(rx_isn + 1 + data.size()),
+                           "test 2 failed: no ACK once the delay ran out");
+            test_2.execute(Tick(cfg.delayed_ack_timeout));
+            test_2.execute(ExpectNoSegment{}, "test 2 failed: ACK sent twice");
+        }
+
+        // data beyond a hole, and the data that fills it, are acknowledged at once
+        {
+            const WrappingInt32 tx_isn(rd());
+            const WrappingInt32 rx_isn(rd());
+            TCPTestHarness test_3 = TCPTestHarness::in_established(cfg, tx_isn, rx_isn);
+
+            test_3.send_data(rx_isn + 1 + data.size(), tx_isn + 1, data.cbegin(), data.cend());
+            test_3.execute(ExpectOneSegment{}.with_ack(true).with_ackno(rx_isn + 1),
+                           "test 3 failed: out-of-order data not acknowledged at once");
+            test_3.send_data(rx_isn + 1, tx_isn + 1, data.cbegin(), data.cend());
+            test_3.execute(ExpectOneSegment{}.with_ack(true).with_ackno(rx_isn + 1 + 2 * data.size()),
+                           "test 3 failed: data filling a hole not acknowledged at once");
+        }
+
+        // a FIN is acknowledged at once, covering the delayed ACK
+        {
+            const WrappingInt32 tx_isn(rd());
+            const WrappingInt32 rx_isn(rd());
+            TCPTestHarness test_4 = TCPTestHarness::in_established(cfg, tx_isn, rx_isn);
+
+            test_4.send_data(rx_isn + 1, tx_isn + 1, data.cbegin(), data.cend());
+            test_4.execute(ExpectNoSegment{}, "test 4 failed: first segment acknowledged at once");
+            test_4.send_fin(rx_isn + 1 + data.size(), tx_isn + 1);
+            test_4.execute(ExpectOneSegment{}.with_ack(true).with_ackno(rx_isn + 2 + data.size()),
+                           "test 4 failed: FIN not acknowledged at once");
+            test_4.execute(ExpectState{State::CLOSE_WAIT});
+        }
+
+        // without delayed ACKs, every segment is acknowledged at once
+        {
+            const WrappingInt32 tx_isn(rd());
+            const WrappingInt32 rx_isn(rd());
+            TCPTestHarness test_5 = TCPTestHarness::in_established(TCPConfig{}, tx_isn, rx_isn);
+
+            test_5.send_data(rx_isn + 1, tx_isn + 1, data.cbegin(), data.cend());
+            test_5.execute(ExpectOneSegment{}.with_ack(true).with_ackno(rx_isn + 1 + data.size()),
+                           "test 5 failed: segment not acknowledged at once");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,80 @@
+#include "tcp_config.hh"
+#include "tcp_expectation.hh"
+#include "tcp_fsm_test_harness.hh"
+#include "util.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+using State = TCPTestHarness::State;
+
+int main() {
+    try {
+        TCPConfig cfg{};
+        cfg.sack = false;  // losses can only be detected from duplicate ACKs or timeouts
+        const size_t MSS = cfg.mss;
+        auto rd = get_random_generator();
+
+        // one lost segment is resent after three duplicate ACKs, without waiting for the timeout
+        {
+            const WrappingInt32 tx_isn(rd());
+            const WrappingInt32 rx_isn(rd());
+            TCPTestHarness test_1 = TCPTestHarness::in_established(cfg, tx_isn, rx_isn);
+            test_1.send_ack(rx_isn + 1, tx_isn + 1, 4 * MSS);
+
+            test_1.execute(Write{string(4 * MSS, 'x')});
+            test_1.execute(Tick(1));
+            for (size_t i = 0; i < 4; i++) {
+                test_1.execute(ExpectSegment{}.with_payload_size(MSS).with_seqno(tx_isn + 1 + i * MSS),
+                               "test 1 failed: data not sent");
+            }
+
+            // the first segment was lost; the receiver acknowledges each of the others with a duplicate ACK
+            test_1.send_ack(rx_isn + 1, tx_isn + 1, 4 * MSS);
+            test_1.send_ack(rx_isn + 1, tx_isn + 1, 4 * MSS);
+            test_1.execute(ExpectNoSegment{}, "test 1 failed: fast retransmit after two duplicate ACKs");
+            test_1.send_ack(rx_isn + 1, tx_isn + 1, 4 * MSS);
+            test_1.execute(ExpectOneSegment{}.with_ack(true).with_payload_size(MSS).with_seqno(tx_isn + 1),
+                           "test 1 failed: no fast retransmit after three duplicate ACKs");
+
+            test_1.send_ack(rx_isn + 1, tx_isn + 1 + 4 * MSS, 4 * MSS);
+            test_1.execute(Tick(cfg.rt_timeout));
+            test_1.execute(ExpectNoSegment{}, "test 1 failed: retransmission after recovery");
+            test_1.execute(ExpectState{State::ESTABLISHED});
+        }
+
+        // segments that carry data are not duplicate ACKs, even with the same ackno and window
+        {
+            const WrappingInt32 tx_isn(rd());
+            const WrappingInt32 rx_isn(rd());
+            TCPTestHarness test_2 = TCPTestHarness::in_established(cfg, tx_isn, rx_isn);
+            test_2.send_ack(rx_isn + 1, tx_isn + 1, 4 * MSS);
+
+            test_2.execute(Write{string(4 * MSS, 'x')});
+            test_2.execute(Tick(1));
+            for (size_t i = 0; i < 4; i++) {
+                test_2.execute(ExpectSegment{}.with_payload_size(MSS), "test 2 failed: data not sent");
+            }
+
+            for (size_t i = 0; i < 3; i++) {
+                test_2.execute(SendSegment{}
+                                   .with_ack(true)
+                                   .with_ackno(tx_isn + 1)
+                                   .with_seqno(rx_isn + 1 + i)
+                                   .with_win(4 * MSS)
+                                   .with_payload_size(1)
+                                   .with_data(string("y")));
+                test_2.execute(ExpectOneSegment{}.with_ack(true).with_ackno(rx_isn + 2 + i).with_payload_size(0),
+                               "test 2 failed: data segment treated as a duplicate ACK");
+            }
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,137 @@
+#include "tcp_config.hh"
+#include "tcp_expectation.hh"
+#include "tcp_fsm_test_harness.hh"
+#include "tcp_header.hh"
+#include "tcp_segment.hh"
+#include "test_err_if.hh"
+#include "util.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace std;
+using State = TCPTestHarness::State;
+
+//! Listen, accept a SYN announcing `peer_mss`, then write `len` bytes and return the payload size of each segment
+static vector<size_t> segment_sizes(const TCPConfig &cfg, const optional<uint16_t> peer_mss, const size_t len) {
+    auto rd = get_random_generator();
+    const WrappingInt32 seq_base(rd());
+    TCPTestHarness test(cfg);
+
+    test.execute(Listen{});
+    SendSegment syn = SendSegment{}.with_syn(true).with_seqno(seq_base).with_win(UINT16_MAX);
+    if (peer_mss.has_value()) {
+        syn.with_mss(peer_mss.value());
+    }
+    test.execute(syn);
+
+    TCPSegment syn_ack = test.expect_seg(ExpectOneSegment{}.with_syn(true).with_ack(true).with_ackno(seq_base + 1),
+                                         "SYN/ACK invalid");
+    test_err_if(syn_ack.header().mss != cfg.mss, "SYN/ACK should announce the configured MSS");
+
+    test.send_ack(seq_base + 1, syn_ack.header().seqno + 1, UINT16_MAX);
+    test.execute(ExpectState{State::ESTABLISHED});
+    test.execute(Write{string(len, 'x')}.with_bytes_written(len));
+    test.execute(Tick(1));
+
+    vector<size_t> sizes;
+    while (test.can_read()) {
+        TCPSegment seg = test.expect_seg(ExpectSegment{}.with_ack(true), "data segment invalid");
+        test_err_if(seg.header().mss.has_value(), "MSS announced on a non-SYN");
+        sizes.push_back(seg.payload().size());
+    }
+    return sizes;
+}
+
+int main() {
+    try {
+        // test 1: the peer's smaller MSS limits our segments
+        {
+            const auto sizes = segment_sizes(TCPConfig{}, 536, 2000);
+            const vector<size_t> expected{536, 536, 536, 392};
+            test_err_if(sizes != expected, "test 1 failed: segments not cut at 536 bytes");
+        }
+
+        // test 2: no announcement from the peer -> our own MSS
+        {
+            const auto sizes = segment_sizes(TCPConfig{}, {}, 2500);
+            const vector<size_t> expected{1000, 1000, 500};
+            test_err_if(sizes != expected, "test 2 failed: segments not cut at 1000 bytes");
+        }
+
+        // test 3: our smaller MSS wins over the peer's
+        {
+            TCPConfig cfg{};
+            cfg.mss = 400;
+            const auto sizes = segment_sizes(cfg, 1460, 1000);
+            const vector<size_t> expected{400, 400, 200};
+            test_err_if(sizes != expected, "test 3 failed: segments not cut at 400 bytes");
+        }
+
+        // test 4: the timestamps option comes out of the MSS, and SACK blocks only ride where there is room
+        {
+            auto rd = get_random_generator();
+            const WrappingInt32 seq_base(rd());
+            const uint16_t peer_mss = 536;
+            TCPTestHarness test(TCPConfig{});
+
+            test.execute(Listen{});
+            test.execute(SendSegment{}
+                             .with_syn(true)
+                             .with_seqno(seq_base)
+                             .with_win(UINT16_MAX)
+                             .with_mss(peer_mss)
+                             .with_sack_permitted(true)
+                             .with_timestamps(1, 0));
+            TCPSegment syn_ack =
+                test.expect_seg(ExpectOneSegment{}.with_syn(true).with_ack(true).with_ackno(seq_base + 1),
+                                "test 4 failed: SYN/ACK invalid");
+            const WrappingInt32 ack_base = syn_ack.header().seqno + 1;
+            test.execute(SendSegment{}
+                             .with_ack(true)
+                             .with_seqno(seq_base + 1)
+                             .with_ackno(ack_base)
+                             .with_win(UINT16_MAX)
+                             .with_timestamps(2, 0));
+            test.execute(ExpectState{State::ESTABLISHED});
+
+            // three holes in what the peer sent, to be reported in SACK blocks
+            for (uint32_t i = 1; i <= 3; i++) {
+                test.execute(SendSegment{}
+                                 .with_ack(true)
+                                 .with_seqno(seq_base + 1 + 20 * i)
+                                 .with_ackno(ack_base)
+                                 .with_win(UINT16_MAX)
+                                 .with_data("0123456789")
+                                 .with_timestamps(3, 0));
+            }
+            while (test.can_read()) {
+                test.expect_seg(ExpectSegment{}.with_ack(true).with_ackno(seq_base + 1), "test 4 failed: ACK invalid");
+            }
+
+            test.execute(Write{string(2000, 'x')}.with_bytes_written(2000));
+            test.execute(Tick(1));
+            vector<size_t> sizes;
+            TCPSegment seg;
+            while (test.can_read()) {
+                seg = test.expect_seg(ExpectSegment{}.with_ack(true), "test 4 failed: data segment invalid");
+                test_err_if(seg.header().doff * 4 + seg.payload().size() > peer_mss + TCPHeader::LENGTH,
+                            "test 4 failed: segment larger than the peer's MSS allows");
+                sizes.push_back(seg.payload().size());
+            }
+            const vector<size_t> expected{524, 524, 524, 428};
+            test_err_if(sizes != expected, "test 4 failed: segments not cut at 524 bytes");
+            test_err_if(seg.header().sack.empty(), "test 4 failed: a short segment should still carry SACK blocks");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -164,7 +164,9 @@ class ReassemblerTestHarness {
     std::vector<std::string> steps_executed;
 
   public:
-    ReassemblerTestHarness(const size_t capacity) : reassembler(capacity), steps_executed() {
+    ReassemblerTestHarness(const size_t capacity,
+                           const StreamReassembler::Engine engine = StreamReassembler::Engine::Map)
+        : reassembler(capacity, ByteStream::Backend::List, engine), steps_executed() {
         steps_executed.emplace_back("Initialized (capacity = " + std::to_string(capacity) + ")");
     }
 
@@ -0,0 +1,114 @@
+#include "byte_stream.hh"
+#include "fsm_stream_reassembler_harness.hh"
+#include "stream_reassembler.hh"
+#include "util.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+static constexpr auto RING = StreamReassembler::Engine::Ring;
+
+int main() {
+    try {
+        {
+            ReassemblerTestHarness test{10, RING};
+
+            test.execute(SubmitSegment{"abcdef", 0});
+            test.execute(BytesAvailable("abcdef"));
+
+            // wraps around the end of the window
+            test.execute(SubmitSegment{"jklm", 9});
+            test.execute(UnassembledBytes(4));
+            test.execute(SubmitSegment{"ijk", 8});
+            test.execute(UnassembledBytes(5));
+            test.execute(SubmitSegment{"ghi", 6});
+            test.execute(UnassembledBytes(0));
+            test.execute(BytesAssembled(13));
+            test.execute(BytesAvailable("ghijklm"));
+        }
+
+        {
+            ReassemblerTestHarness test{4, RING};
+
+            // bytes past the window are discarded, and EOF waits for them
+            test.execute(SubmitSegment{"cdefgh", 2}.with_eof(true));
+            test.execute(UnassembledBytes(2));
+            test.execute(SubmitSegment{"ab", 0});
+            test.execute(BytesAssembled(4));
+            test.execute(NotAtEof{});
+            test.execute(BytesAvailable("abcd"));
+            test.execute(SubmitSegment{"efgh", 4}.with_eof(true));
+            test.execute(BytesAvailable("efgh"));
+            test.execute(AtEof{});
+        }
+
+        {
+            ReassemblerTestHarness test{0, RING};
+
+            test.execute(SubmitSegment{"a", 0});
+            test.execute(SubmitSegment{"b", 1});
+            test.execute(BytesAssembled(0));
+            test.execute(UnassembledBytes(0));
+        }
+
+        // random pushes match the map engine byte for byte
+        {
+            auto rd = get_random_generator();
+            for (size_t rep = 0; rep < 16; ++rep) {
+                const size_t capacity = 1 + rd() % 3000;
+                const size_t total = 20000;
+                string d(total, 0);
+                generate(d.begin(), d.end(), [&] { return rd(); });
+
+                StreamReassembler map{capacity};
+                StreamReassembler ring{capacity, ByteStream::Backend::List, RING};
+                string from_map, from_ring;
+
+                while (from_map.size() < total) {
+                    const size_t next = map.stream_out().bytes_written();
+                    const size_t index = next + rd() % (capacity + 100) - min<size_t>(next, 50);
+                    if (index >= total) {
+                        continue;
+                    }
+                    const size_t len = min<size_t>(rd() % 700, total - index);
+                    const bool eof = index + len == total;
+                    map.push_substring(d.substr(index, len), index, eof);
+                    ring.push_substring(Buffer{d.substr(index, len)}, index, eof);
+
+                    if (map.unassembled_bytes() != ring.unassembled_bytes() or
+                        map.stream_out().bytes_written() != ring.stream_out().bytes_written()) {
+                        throw runtime_error("ring engine diverged from map engine");
+                    }
+
+                    const size_t max_ranges = 1 + rd() % 4;
+                    const auto map_ranges = map.unassembled_ranges(max_ranges);
+                    const auto ring_ranges = ring.unassembled_ranges(max_ranges);
+                    const auto same = [](const auto &a, const auto &b) {
+                        return a.begin == b.begin and a.end == b.end;
+                    };
+                    if (not equal(map_ranges.begin(), map_ranges.end(), ring_ranges.begin(), ring_ranges.end(), same)) {
+                        throw runtime_error("ring engine reported different unassembled ranges than map engine");
+                    }
+
+                    const size_t pop = rd() % (capacity + 1);
+                    from_map.append(map.stream_out().read(pop));
+                    from_ring.append(ring.stream_out().read(pop));
+                }
+
+                if (from_map != d or from_ring != d or not ring.stream_out().eof()) {
+                    throw runtime_error("ring engine produced the wrong stream");
+                }
+            }
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,136 @@
+#include "tcp_config.hh"
+#include "tcp_expectation.hh"
+#include "tcp_fsm_test_harness.hh"
+#include "tcp_header.hh"
+#include "tcp_segment.hh"
+#include "test_err_if.hh"
+#include "util.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+using State = TCPTestHarness::State;
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        // test 1: the option survives a round trip through the wire format, next to SACK blocks
+        {
+            TCPSegment seg;
+            seg.header().ack = true;
+            seg.header().timestamps = {0xdeadbeef, 12345};
+            for (uint32_t i = 0; i < TCPHeader::MAX_SACK_BLOCKS; i++) {
+                seg.header().sack.emplace_back(WrappingInt32{100 * i + 10}, WrappingInt32{100 * i + 20});
+            }
+            test_err_if(seg.header().options_length() != TCPHeader::MAX_OPTIONS,
+                        "test 1 failed: options should fill the header, dropping a SACK block");
+            seg.header().doff = (TCPHeader::LENGTH + seg.header().options_length()) / 4;
+
+            TCPSegment parsed;
+            test_err_if(parsed.parse(seg.serialize().concatenate()) != ParseResult::NoError,
+                        "test 1 failed: parse error");
+            test_err_if(parsed.header().timestamps != seg.header().timestamps, "test 1 failed: timestamps differ");
+            test_err_if(parsed.header().sack.size() != 3, "test 1 failed: expected three SACK blocks");
+        }
+
+        // test 2: listen; a peer offering timestamps gets them echoed, on the SYN/ACK and after
+        {
+            const WrappingInt32 seq_base(rd());
+            TCPTestHarness test_2(TCPConfig{});
+
+            test_2.execute(Listen{});
+            test_2.execute(SendSegment{}.with_syn(true).with_seqno(seq_base).with_win(1000).with_timestamps(100, 0));
+            TCPSegment seg =
+                test_2.expect_seg(ExpectOneSegment{}.with_syn(true).with_ack(true).with_ackno(seq_base + 1),
+                                  "test 2 failed: SYN/ACK invalid");
+            test_err_if(not seg.header().timestamps.has_value() or seg.header().timestamps->second != 100,
+                        "test 2 failed: SYN/ACK should echo the SYN's timestamp");
+            const WrappingInt32 ack_base = seg.header().seqno + 1;
+
+            test_2.execute(SendSegment{}
+                               .with_ack(true)
+                               .with_seqno(seq_base + 1)
+                               .with_ackno(ack_base)
+                               .with_win(1000)
+                               .with_timestamps(110, seg.header().timestamps->first));
+            test_2.execute(ExpectState{State::ESTABLISHED});
+
+            test_2.execute(SendSegment{}
+                               .with_ack(true)
+                               .with_seqno(seq_base + 1)
+                               .with_ackno(ack_base)
+                               .with_win(1000)
+                               .with_data("hello")
+                               .with_timestamps(120, seg.header().timestamps->first));
+            seg = test_2.expect_seg(ExpectOneSegment{}.with_ack(true).with_ackno(seq_base + 6),
+                                    "test 2 failed: no ACK for data");
+            test_err_if(not seg.header().timestamps.has_value() or seg.header().timestamps->second != 120,
+                        "test 2 failed: ACK should echo the data's timestamp");
+
+            // PAWS: a segment stamped earlier than the latest is dropped (and acknowledged)
+            test_2.execute(SendSegment{}
+                               .with_ack(true)
+                               .with_seqno(seq_base + 6)
+                               .with_ackno(ack_base)
+                               .with_win(1000)
+                               .with_data("stale")
+                               .with_timestamps(115, seg.header().timestamps->first));
+            test_2.execute(ExpectOneSegment{}.with_ack(true).with_ackno(seq_base + 6),
+                           "test 2 failed: an old duplicate was accepted");
+            test_2.execute(ExpectData{}.with_data("hello"), "test 2 failed: wrong data delivered");
+        }
+
+        // test 3: an ACK echoing a retransmission's timestamp yields an RTT sample (Karn's rule does not)
+        {
+            TCPConfig cfg{};
+            const WrappingInt32 seq_base(rd());
+            TCPTestHarness test_3(cfg);
+
+            test_3.execute(Listen{});
+            test_3.execute(SendSegment{}.with_syn(true).with_seqno(seq_base).with_win(1000).with_timestamps(1, 0));
+            TCPSegment seg = test_3.expect_seg(ExpectOneSegment{}.with_syn(true).with_ack(true),
+                                               "test 3 failed: SYN/ACK invalid");
+            const WrappingInt32 ack_base = seg.header().seqno + 1;
+            test_3.execute(Tick(cfg.rt_timeout));
+            seg = test_3.expect_seg(ExpectOneSegment{}.with_syn(true).with_ack(true),
+                                    "test 3 failed: SYN/ACK not retransmitted");
+
+            test_3.execute(Tick(7));
+            test_3.execute(SendSegment{}
+                               .with_ack(true)
+                               .with_seqno(seq_base + 1)
+                               .with_ackno(ack_base)
+                               .with_win(1000)
+                               .with_timestamps(2, seg.header().timestamps->first));
+            test_3.execute(ExpectState{State::ESTABLISHED});
+            test_err_if(test_3._fsm.min_rtt() != 7, "test 3 failed: RTT not measured from the timestamp");
+        }
+
+        // test 4: a peer that does not offer timestamps gets none
+        for (const bool enabled : {true, false}) {
+            TCPConfig cfg{};
+            cfg.timestamps = enabled;
+            const WrappingInt32 seq_base(rd());
+            TCPTestHarness test_4(cfg);
+
+            test_4.execute(Connect{});
+            TCPSegment syn = test_4.expect_seg(ExpectOneSegment{}.with_syn(true), "test 4 failed: no SYN");
+            test_err_if(syn.header().timestamps.has_value() != enabled, "test 4 failed: SYN offer is wrong");
+
+            test_4.execute(
+                SendSegment{}.with_syn(true).with_ack(true).with_seqno(seq_base).with_ackno(syn.header().seqno + 1));
+            TCPSegment ack = test_4.expect_seg(ExpectOneSegment{}.with_ack(true), "test 4 failed: no ACK");
+            test_err_if(ack.header().timestamps.has_value(), "test 4 failed: timestamps sent though not negotiated");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
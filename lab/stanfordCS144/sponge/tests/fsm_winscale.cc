@@ -0,0 +1,96 @@
+#include "tcp_config.hh"
+#include "tcp_expectation.hh"
+#include "tcp_fsm_test_harness.hh"
+#include "tcp_header.hh"
+#include "tcp_segment.hh"
+#include "test_err_if.hh"
+#include "util.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+using State = TCPTestHarness::State;
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        // test 1: listen, peer offers scaling -> windows in both directions are scaled after the handshake
+        {
+            TCPConfig cfg{};
+            cfg.recv_capacity = 1 << 20;
+            cfg.send_capacity = 1 << 20;
+            const WrappingInt32 seq_base(rd());
+            TCPTestHarness test_1(cfg);
+
+            test_1.execute(Listen{});
+            test_1.execute(SendSegment{}.with_syn(true).with_seqno(seq_base).with_win(1000).with_wscale(3));
+
+            // the window in a SYN is never scaled
+            TCPSegment seg = test_1.expect_seg(
+                ExpectOneSegment{}.with_syn(true).with_ack(true).with_ackno(seq_base + 1).with_win(UINT16_MAX),
+                "test 1 failed: SYN/ACK invalid");
+            test_err_if(seg.header().wscale != 5, "test 1 failed: SYN/ACK should offer a shift of 5");
+            const WrappingInt32 ack_base = seg.header().seqno;
+
+            // the peer's 1000 means 8000 bytes
+            test_1.send_ack(seq_base + 1, ack_base + 1, 1000);
+            test_1.execute(ExpectState{State::ESTABLISHED});
+            test_1.execute(Write{string(20000, 'x')}.with_bytes_written(20000));
+            test_1.execute(Tick(1));
+
+            size_t bytes_sent = 0;
+            while (test_1.can_read()) {
+                TCPSegment data = test_1.expect_seg(ExpectSegment{}.with_ack(true).with_win((1 << 20) >> 5),
+                                                    "test 1 failed: data segment invalid");
+                test_err_if(data.header().wscale.has_value(), "test 1 failed: window scale sent on a non-SYN");
+                bytes_sent += data.payload().size();
+            }
+            test_err_if(bytes_sent != 8000, "test 1 failed: sent " + to_string(bytes_sent) + " bytes, not 8000");
+        }
+
+        // test 2: peer does not offer scaling -> no option in the SYN/ACK, window clamped to 16 bits
+        {
+            TCPConfig cfg{};
+            cfg.recv_capacity = 1 << 20;
+            const WrappingInt32 seq_base(rd());
+            TCPTestHarness test_2(cfg);
+
+            test_2.execute(Listen{});
+            test_2.send_syn(seq_base);
+            TCPSegment seg = test_2.expect_seg(ExpectOneSegment{}.with_syn(true).with_ack(true).with_win(UINT16_MAX),
+                                               "test 2 failed: SYN/ACK invalid");
+            test_err_if(seg.header().wscale.has_value(), "test 2 failed: SYN/ACK offered window scaling");
+
+            test_2.send_ack(seq_base + 1, seg.header().seqno + 1, 1000);
+            test_2.execute(Write{string(5000, 'x')}.with_bytes_written(5000));
+            test_2.execute(Tick(1));
+            test_2.execute(ExpectSegment{}.with_payload_size(1000).with_win(UINT16_MAX),
+                           "test 2 failed: data segment invalid");
+            test_2.execute(ExpectNoSegment{}, "test 2 failed: sent past an unscaled window");
+        }
+
+        // test 3: active open offers scaling, unless disabled
+        for (const bool enabled : {true, false}) {
+            TCPConfig cfg{};
+            cfg.recv_capacity = 300000;
+            cfg.window_scaling = enabled;
+            TCPTestHarness test_3(cfg);
+
+            test_3.execute(Connect{});
+            TCPSegment seg =
+                test_3.expect_seg(ExpectOneSegment{}.with_syn(true).with_ack(false), "test 3 failed: no SYN");
+            test_err_if(enabled and seg.header().wscale != 3, "test 3 failed: SYN should offer a shift of 3");
+            test_err_if(not enabled and seg.header().wscale.has_value(), "test 3 failed: SYN offered window scaling");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,92 @@
+#include "io_engine.hh"
+#include "socket.hh"
+#include "test_should_be.hh"
+#include "util.hh"
+
+#include <cstddef>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <unistd.h>
+
+using namespace std;
+
+int main() {
+    try {
+        optional<IoEngine> engine{};
+        try {
+            engine.emplace(2048);
+        } catch (const unix_error &e) {
+            cerr << "io_uring is unavailable (" << e.what() << "), skipping\n";
+            return EXIT_SUCCESS;
+        }
+
+        // a batch holds every datagram waiting on the socket, in order, with its sender
+        {
+            UDPSocket receiver, first_sender, second_sender;
+            receiver.bind({"127.0.0.1", 0});
+            receiver.set_blocking(false);
+            first_sender.bind({"127.0.0.1", 0});
+            second_sender.bind({"127.0.0.1", 0});
+
+            test_should_be(engine->recv(receiver), size_t{0});
+
+            for (unsigned i = 0; i < 10; i++) {
+                UDPSocket &sender = i % 2 ? second_sender : first_sender;
+                sender.sendto(receiver.local_address(), "datagram " + to_string(i));
+            }
+            test_should_be(engine->recv(receiver), size_t{10});
+            for (unsigned i = 0; i < 10; i++) {
+                const UDPSocket &sender = i % 2 ? second_sender : first_sender;
+                test_should_be(string{engine->payload(i)} == "datagram " + to_string(i), true);
+                test_should_be(engine->source(i) == sender.local_address(), true);
+            }
+            test_should_be(engine->recv(receiver), size_t{0});
+
+            // more than a batch: the rest wait for the next one
+            for (size_t i = 0; i < IoEngine::BATCH + 5; i++) {
+                first_sender.sendto(receiver.local_address(), to_string(i));
+            }
+            test_should_be(engine->recv(receiver), IoEngine::BATCH);
+            test_should_be(string{engine->payload(0)} == "0", true);
+            test_should_be(engine->recv(receiver), size_t{5});
+            test_should_be(string{engine->payload(4)} == to_string(IoEngine::BATCH + 4), true);
+
+            // queued datagrams are sent on flush(), in order
+            for (unsigned i = 0; i < 3; i++) {
+                engine->sendto(first_sender, receiver.local_address(), string("queued ") + to_string(i));
+            }
+            test_should_be(engine->queued(), size_t{3});
+            test_should_be(engine->recv(receiver), size_t{0});
+            engine->flush();
+            test_should_be(engine->queued(), size_t{0});
+            test_should_be(engine->recv(receiver), size_t{3});
+            test_should_be(string{engine->payload(2)} == "queued 2", true);
+            test_should_be(engine->source(2) == first_sender.local_address(), true);
+        }
+
+        // a file descriptor that is not a socket (as a TUN device is) is read and written the same way
+        {
+            int fds[2];
+            SystemCall("pipe", ::pipe(static_cast<int *>(fds)));
+            FileDescriptor read_end{fds[0]}, write_end{fds[1]};
+
+            engine->write(write_end, string("through a pipe"));
+            engine->flush();
+            test_should_be(engine->read(read_end), size_t{1});
+            test_should_be(string{engine->payload(0)} == "through a pipe", true);
+            test_should_be(read_end.eof(), false);
+
+            write_end.close();
+            test_should_be(engine->read(read_end), size_t{0});
+            test_should_be(read_end.eof(), true);
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
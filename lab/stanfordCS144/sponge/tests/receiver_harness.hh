@@ -13,6 +13,8 @@
 #include <optional>
 #include <sstream>
 #include <string>
+#include <utility>
+#include <vector>
 
 struct ReceiverTestStep {
     virtual std::string to_string() const { return "ReceiverTestStep"; }
@@ -100,6 +102,36 @@ struct ExpectUnassembledBytes : public ReceiverExpectation {
     }
 };
 
+struct ExpectSackBlocks : public ReceiverExpectation {
+    using Blocks = std::vector<std::pair<WrappingInt32, WrappingInt32>>;
+
+    Blocks _blocks;
+    size_t _max_blocks;
+
+    ExpectSackBlocks(Blocks blocks, const size_t max_blocks = 4)
+        : _blocks(std::move(blocks)), _max_blocks(max_blocks) {}
+
+    static std::string blocks_string(const Blocks &blocks) {
+        std::ostringstream ss;
+        for (const auto &[left, right] : blocks) {
+            ss << "[" << left.raw_value() << ", " << right.raw_value() << ") ";
+        }
+        return blocks.empty() ? "none" : ss.str();
+    }
+
+    std::string description() const {
+        return "SACK blocks (max " + std::to_string(_max_blocks) + ") " + blocks_string(_blocks);
+    }
+
+    void execute(TCPReceiver &receiver) const {
+        const Blocks reported = receiver.sack_blocks(_max_blocks);
+        if (reported != _blocks) {
+            throw ReceiverExpectationViolation("The TCPReceiver reported SACK blocks `" + blocks_string(reported) +
+                                               "`, but they were expected to be `" + blocks_string(_blocks) + "`");
+        }
+    }
+};
+
 struct ExpectTotalAssembledBytes : public ReceiverExpectation {
     size_t _n_bytes;
 
@@ -298,7 +330,8 @@ class TCPReceiverTestHarness {
     std::vector<std::string> steps_executed;
 
   public:
-    TCPReceiverTestHarness(size_t capacity) : receiver(capacity), steps_executed() {
+    TCPReceiverTestHarness(size_t capacity, const StreamReassembler::Engine engine = StreamReassembler::Engine::Map)
+        : receiver(capacity, ByteStream::Backend::List, engine), steps_executed() {
         std::ostringstream ss;
         ss << "Initialized with ("
            << "capacity=" << capacity << ")";
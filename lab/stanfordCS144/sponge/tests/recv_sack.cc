@@ -0,0 +1,98 @@
+#include "receiver_harness.hh"
+#include "util.hh"
+#include "wrapping_integers.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <random>
+
+using namespace std;
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        for (const auto engine : {StreamReassembler::Engine::Map, StreamReassembler::Engine::Ring}) {
+            // no SYN, no blocks; in-order data leaves nothing to report
+            {
+                uint32_t isn = uniform_int_distribution<uint32_t>{0, UINT32_MAX}(rd);
+                TCPReceiverTestHarness test{4000, engine};
+                test.execute(ExpectSackBlocks{{}});
+                test.execute(SegmentArrives{}.with_syn().with_seqno(isn).with_result(SegmentArrives::Result::OK));
+                test.execute(
+                    SegmentArrives{}.with_seqno(isn + 1).with_data("abcd").with_result(SegmentArrives::Result::OK));
+                test.execute(ExpectSackBlocks{{}});
+            }
+
+            // blocks beyond holes, merged when they touch, cleared as holes fill
+            {
+                uint32_t isn = uniform_int_distribution<uint32_t>{0, UINT32_MAX}(rd);
+                TCPReceiverTestHarness test{4000, engine};
+                test.execute(SegmentArrives{}.with_syn().with_seqno(isn).with_result(SegmentArrives::Result::OK));
+                test.execute(
+                    SegmentArrives{}.with_seqno(isn + 11).with_data("kl").with_result(SegmentArrives::Result::OK));
+                test.execute(
+                    SegmentArrives{}.with_seqno(isn + 5).with_data("ef").with_result(SegmentArrives::Result::OK));
+                test.execute(ExpectSackBlocks{{{WrappingInt32{isn + 5}, WrappingInt32{isn + 7}},
+                                               {WrappingInt32{isn + 11}, WrappingInt32{isn + 13}}}});
+                test.execute(ExpectSackBlocks{{{WrappingInt32{isn + 5}, WrappingInt32{isn + 7}}}, 1});
+
+                test.execute(
+                    SegmentArrives{}.with_seqno(isn + 7).with_data("ghij").with_result(SegmentArrives::Result::OK));
+                test.execute(ExpectSackBlocks{{{WrappingInt32{isn + 5}, WrappingInt32{isn + 13}}}});
+
+                test.execute(
+                    SegmentArrives{}.with_seqno(isn + 1).with_data("abcd").with_result(SegmentArrives::Result::OK));
+                test.execute(ExpectAckno{WrappingInt32{isn + 13}});
+                test.execute(ExpectSackBlocks{{}});
+            }
+
+            // more holes than blocks fit: the block of the latest segment comes first, then the lowest ones
+            {
+                uint32_t isn = uniform_int_distribution<uint32_t>{0, UINT32_MAX}(rd);
+                TCPReceiverTestHarness test{4000, engine};
+                test.execute(SegmentArrives{}.with_syn().with_seqno(isn).with_result(SegmentArrives::Result::OK));
+                for (const uint32_t offset : {3, 7, 11, 15}) {
+                    test.execute(SegmentArrives{}.with_seqno(isn + offset).with_data("xy").with_result(
+                        SegmentArrives::Result::OK));
+                }
+                test.execute(ExpectSackBlocks{{{WrappingInt32{isn + 15}, WrappingInt32{isn + 17}},
+                                               {WrappingInt32{isn + 3}, WrappingInt32{isn + 5}},
+                                               {WrappingInt32{isn + 7}, WrappingInt32{isn + 9}}},
+                                              3});
+
+                // (a segment that extends a block brings that whole block to the front)
+                test.execute(
+                    SegmentArrives{}.with_seqno(isn + 9).with_data("z").with_result(SegmentArrives::Result::OK));
+                test.execute(ExpectSackBlocks{{{WrappingInt32{isn + 7}, WrappingInt32{isn + 10}},
+                                               {WrappingInt32{isn + 3}, WrappingInt32{isn + 5}},
+                                               {WrappingInt32{isn + 11}, WrappingInt32{isn + 13}}},
+                                              3});
+
+                // (once the latest segment's bytes are assembled, the blocks are in increasing order)
+                test.execute(
+                    SegmentArrives{}.with_seqno(isn + 1).with_data("ab").with_result(SegmentArrives::Result::OK));
+                test.execute(ExpectSackBlocks{{{WrappingInt32{isn + 7}, WrappingInt32{isn + 10}},
+                                               {WrappingInt32{isn + 11}, WrappingInt32{isn + 13}},
+                                               {WrappingInt32{isn + 15}, WrappingInt32{isn + 17}}}});
+            }
+
+            // sequence numbers wrap around zero
+            {
+                const uint32_t isn = UINT32_MAX - 2;
+                TCPReceiverTestHarness test{4000, engine};
+                test.execute(SegmentArrives{}.with_syn().with_seqno(isn).with_result(SegmentArrives::Result::OK));
+                test.execute(SegmentArrives{}.with_seqno(isn + 4).with_data("def").with_result(
+                    SegmentArrives::Result::OK));
+                test.execute(ExpectSackBlocks{{{WrappingInt32{1}, WrappingInt32{4}}}});
+            }
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
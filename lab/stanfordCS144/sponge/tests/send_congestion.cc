@@ -0,0 +1,335 @@
+#include "congestion_control.hh"
+#include "sender_harness.hh"
+#include "wrapping_integers.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+static constexpr size_t MSS = TCPConfig::MAX_PAYLOAD_SIZE;
+static constexpr uint16_t WIN = 60000;
+
+//! Handshake, then write `n` segments' worth: the initial window lets four of them out
+static void send_initial_window(TCPSenderTestHarness &test, const WrappingInt32 isn, const size_t n) {
+    test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_payload_size(0).with_seqno(isn));
+    test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(WIN));
+    test.execute(WriteBytes{string(n * MSS, 'x')});
+    for (size_t i = 0; i < 4; i++) {
+        test.execute(ExpectSegment{}.with_payload_size(MSS).with_seqno(isn + 1 + i * MSS));
+    }
+    test.execute(ExpectNoSegment{});
+}
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.congestion_control = CongestionControl::Algorithm::Reno;
+
+            TCPSenderTestHarness test{"Slow start grows the window by a segment per ACKed segment", cfg};
+            send_initial_window(test, isn, 10);
+
+            test.execute(AckReceived{WrappingInt32{isn + 1 + MSS}}.with_win(WIN));
+            test.execute(ExpectSegment{}.with_payload_size(MSS).with_seqno(isn + 1 + 4 * MSS));
+            test.execute(ExpectSegment{}.with_payload_size(MSS).with_seqno(isn + 1 + 5 * MSS));
+            test.execute(ExpectNoSegment{});
+            test.execute(ExpectBytesInFlight{5 * MSS});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+
+            TCPSenderTestHarness test{"Without congestion control the receiver's window is the limit", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_payload_size(0).with_seqno(isn));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(WIN));
+            test.execute(WriteBytes{string(10 * MSS, 'x')});
+            for (size_t i = 0; i < 10; i++) {
+                test.execute(ExpectSegment{}.with_payload_size(MSS));
+            }
+            test.execute(ExpectNoSegment{});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.congestion_control = CongestionControl::Algorithm::Reno;
+
+            TCPSenderTestHarness test{"A SACK-detected loss halves the window", cfg};
+            send_initial_window(test, isn, 10);
+
+            // ssthresh = 4 MSS / 2, cwnd = ssthresh + 3 MSS: the repair and one new segment go out
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(WIN).with_sack(isn + 1 + MSS,
+                                                                                     isn + 1 + 4 * MSS));
+            test.execute(ExpectSegment{}.with_payload_size(MSS).with_seqno(isn + 1));
+            test.execute(ExpectSegment{}.with_payload_size(MSS).with_seqno(isn + 1 + 4 * MSS));
+            test.execute(ExpectNoSegment{});
+
+            // leaving recovery deflates the window to ssthresh
+            test.execute(AckReceived{WrappingInt32{isn + 1 + 5 * MSS}}.with_win(WIN));
+            test.execute(ExpectSegment{}.with_payload_size(MSS).with_seqno(isn + 1 + 5 * MSS));
+            test.execute(ExpectSegment{}.with_payload_size(MSS).with_seqno(isn + 1 + 6 * MSS));
+            test.execute(ExpectNoSegment{});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            uint16_t retx_timeout = uniform_int_distribution<uint16_t>{10, 10000}(rd);
+            cfg.fixed_isn = isn;
+            cfg.rt_timeout = retx_timeout;
+            cfg.congestion_control = CongestionControl::Algorithm::Reno;
+
+            TCPSenderTestHarness test{"A timeout collapses the window to one segment", cfg};
+            send_initial_window(test, isn, 10);
+
+            test.execute(Tick{retx_timeout});
+            test.execute(ExpectSegment{}.with_payload_size(MSS).with_seqno(isn + 1));
+            test.execute(ExpectNoSegment{});
+
+            // slow start again from one segment
+            test.execute(AckReceived{WrappingInt32{isn + 1 + 4 * MSS}}.with_win(WIN));
+            test.execute(ExpectSegment{}.with_payload_size(MSS).with_seqno(isn + 1 + 4 * MSS));
+            test.execute(ExpectSegment{}.with_payload_size(MSS).with_seqno(isn + 1 + 5 * MSS));
+            test.execute(ExpectNoSegment{});
+        }
+
+        for (const bool new_reno : {false, true}) {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.congestion_control =
+                new_reno ? CongestionControl::Algorithm::NewReno : CongestionControl::Algorithm::Reno;
+
+            TCPSenderTestHarness test{new_reno ? "NewReno stays in recovery across a partial ACK"
+                                               : "Reno leaves recovery on a partial ACK",
+                                      cfg};
+            send_initial_window(test, isn, 20);
+
+            // grow the window to six segments and fill it
+            test.execute(AckReceived{WrappingInt32{isn + 1 + MSS}}.with_win(WIN));
+            test.execute(ExpectSegment{}.with_payload_size(MSS).with_seqno(isn + 1 + 4 * MSS));
+            test.execute(ExpectSegment{}.with_payload_size(MSS).with_seqno(isn + 1 + 5 * MSS));
+            test.execute(AckReceived{WrappingInt32{isn + 1 + 2 * MSS}}.with_win(WIN));
+            test.execute(ExpectSegment{}.with_payload_size(MSS).with_seqno(isn + 1 + 6 * MSS));
+            test.execute(ExpectSegment{}.with_payload_size(MSS).with_seqno(isn + 1 + 7 * MSS));
+            test.execute(ExpectNoSegment{});
+
+            // two holes: both are repaired, and ssthresh = 6 MSS / 2 leaves no room for new data
+            test.execute(AckReceived{WrappingInt32{isn + 1 + 2 * MSS}}.with_win(WIN).with_sack(isn + 1 + 4 * MSS,
+                                                                                               isn + 1 + 8 * MSS));
+            test.execute(ExpectSegment{}.with_payload_size(MSS).with_seqno(isn + 1 + 2 * MSS));
+            test.execute(ExpectSegment{}.with_payload_size(MSS).with_seqno(isn + 1 + 3 * MSS));
+            test.execute(ExpectNoSegment{});
+
+            // the first repair arrives: NewReno lets one more segment out, Reno drops to ssthresh
+            test.execute(AckReceived{WrappingInt32{isn + 1 + 3 * MSS}}.with_win(WIN).with_sack(isn + 1 + 4 * MSS,
+                                                                                               isn + 1 + 8 * MSS));
+            if (new_reno) {
+                test.execute(ExpectSegment{}.with_payload_size(MSS).with_seqno(isn + 1 + 8 * MSS));
+            }
+            test.execute(ExpectNoSegment{});
+        }
+
+        for (const bool new_reno : {false, true}) {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.congestion_control =
+                new_reno ? CongestionControl::Algorithm::NewReno : CongestionControl::Algorithm::Reno;
+
+            TCPSenderTestHarness test{new_reno ? "NewReno repairs two losses in one window on the partial ACK"
+                                               : "Reno repairs two losses in one window with one reduction",
+                                      cfg};
+            send_initial_window(test, isn, 20);
+
+            // grow the window to six segments and fill it
+            test.execute(AckReceived{WrappingInt32{isn + 1 + MSS}}.with_win(WIN));
+            test.execute(ExpectSegment{}.with_payload_size(MSS).with_seqno(isn + 1 + 4 * MSS));
+            test.execute(ExpectSegment{}.with_payload_size(MSS).with_seqno(isn + 1 + 5 * MSS));
+            test.execute(AckReceived{WrappingInt32{isn + 1 + 2 * MSS}}.with_win(WIN));
+            test.execute(ExpectSegment{}.with_payload_size(MSS).with_seqno(isn + 1 + 6 * MSS));
+            test.execute(ExpectSegment{}.with_payload_size(MSS).with_seqno(isn + 1 + 7 * MSS));
+            test.execute(ExpectNoSegment{});
+
+            // the third and fourth of six segments are lost: the other four produce duplicate ACKs
+            for (size_t i = 0; i < 3; i++) {
+                test.execute(AckReceived{WrappingInt32{isn + 1 + 2 * MSS}}.with_win(WIN));
+            }
+            test.execute(ExpectSegment{}.with_payload_size(MSS).with_seqno(isn + 1 + 2 * MSS));
+            test.execute(ExpectNoSegment{});
+            test.execute(ExpectCwnd{6 * MSS});
+            test.execute(AckReceived{WrappingInt32{isn + 1 + 2 * MSS}}.with_win(WIN));
+            test.execute(ExpectSegment{}.with_payload_size(MSS).with_seqno(isn + 1 + 8 * MSS));
+            test.execute(ExpectNoSegment{});
+
+            // the repair arrives, but the next segment is still missing
+            test.execute(AckReceived{WrappingInt32{isn + 1 + 3 * MSS}}.with_win(WIN));
+            if (new_reno) {
+                test.execute(ExpectSegment{}.with_payload_size(MSS).with_seqno(isn + 1 + 3 * MSS));
+                test.execute(ExpectSegment{}.with_payload_size(MSS).with_seqno(isn + 1 + 9 * MSS));
+                test.execute(ExpectNoSegment{});
+                test.execute(ExpectCwnd{7 * MSS});
+            } else {
+                // Reno has left recovery, and needs three more duplicate ACKs to find the second loss; the
+                // window is not cut a second time
+                test.execute(ExpectNoSegment{});
+                test.execute(ExpectCwnd{3 * MSS});
+                for (size_t i = 0; i < 3; i++) {
+                    test.execute(AckReceived{WrappingInt32{isn + 1 + 3 * MSS}}.with_win(WIN));
+                }
+                test.execute(ExpectSegment{}.with_payload_size(MSS).with_seqno(isn + 1 + 3 * MSS));
+                test.execute(ExpectNoSegment{});
+                test.execute(ExpectCwnd{3 * MSS});
+            }
+
+            // everything is acknowledged: NewReno leaves recovery at half the window the losses were found in,
+            // while Reno, out of recovery already, counts the ACK toward congestion avoidance
+            test.execute(AckReceived{WrappingInt32{isn + 1 + (new_reno ? 10 : 9) * MSS}}.with_win(WIN));
+            test.execute(ExpectCwnd{(new_reno ? 3 : 4) * MSS});
+        }
+
+        // CUBIC, driven directly: a flow with a 100 ms RTT that lost a packet at a window of 100 segments
+        {
+            CubicCongestionControl cubic{MSS};
+            uint64_t now = 0;
+            uint64_t ackno = 1;
+            while (cubic.cwnd() < 100 * MSS) {
+                ackno += MSS;
+                cubic.on_ack({now, ackno, MSS, cubic.cwnd(), 100, {}, false});
+            }
+            cubic.on_loss(now, 100 * MSS, ackno + 100 * MSS);
+            if (cubic.cwnd() != 70 * MSS) {
+                throw runtime_error("CUBIC should reduce the window by 30%, to " + to_string(cubic.cwnd()));
+            }
+
+            // one round trip at a time: K = cbrt(30 / 0.4) ~ 4.2 s until the window is back at 100 segments
+            ackno += 100 * MSS;
+            size_t at_half_k = 0;
+            for (now = 100; now <= 4200; now += 100) {
+                const size_t segments = cubic.cwnd() / MSS;
+                for (size_t i = 0; i < segments; i++) {
+                    ackno += MSS;
+                    cubic.on_ack({now, ackno, MSS, cubic.cwnd(), 100, {}, false});
+                }
+                if (now == 2100) {
+                    at_half_k = cubic.cwnd();
+                }
+            }
+            if (at_half_k < 85 * MSS or at_half_k > 100 * MSS) {
+                throw runtime_error("CUBIC should regrow quickly toward the old window, but has " +
+                                    to_string(at_half_k) + " bytes halfway there");
+            }
+            if (cubic.cwnd() < 97 * MSS or cubic.cwnd() > 103 * MSS) {
+                throw runtime_error("CUBIC should be back near the old window after K, but has " +
+                                    to_string(cubic.cwnd()) + " bytes");
+            }
+
+            cubic.on_rto(now, cubic.cwnd());
+            if (cubic.cwnd() != MSS) {
+                throw runtime_error("a timeout should leave CUBIC with one segment");
+            }
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+
+            TCPSenderTestHarness test{"Delivery rate and min RTT are sampled from ACKs", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_payload_size(0).with_seqno(isn));
+            test.execute(Tick{50});
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(WIN));
+            test.execute(ExpectMinRTT{50});
+
+            // four segments sent at once and acknowledged 100 ms later
+            test.execute(WriteBytes{string(4 * MSS, 'x')});
+            for (size_t i = 0; i < 4; i++) {
+                test.execute(ExpectSegment{}.with_payload_size(MSS));
+            }
+            test.execute(Tick{100});
+            test.execute(AckReceived{WrappingInt32{isn + 1 + 2 * MSS}}.with_win(WIN));
+            test.execute(ExpectDeliveryRate{20000});
+            test.execute(ExpectMinRTT{50});
+
+            // the SACK of the last segment is delivery too: four segments in 120 ms
+            test.execute(Tick{20});
+            test.execute(AckReceived{WrappingInt32{isn + 1 + 2 * MSS}}.with_win(WIN).with_sack(isn + 1 + 3 * MSS,
+                                                                                               isn + 1 + 4 * MSS));
+            test.execute(ExpectDeliveryRate{3 * MSS * 1000 / 120});
+        }
+
+        // BBR, driven directly: a path of 1 MB/s with a 20 ms delay, ACKed one segment per millisecond
+        {
+            BbrCongestionControl bbr{MSS};
+            const size_t bdp = 20 * MSS;
+            uint64_t now = 0;
+            uint64_t ackno = 1;
+            for (; now < 2000; now++) {
+                ackno += MSS;
+                bbr.on_ack({now, ackno, MSS, bdp, 20, 1000000, false});
+            }
+            if (bbr.bandwidth() != 1000000 or bbr.min_rtt() != 20) {
+                throw runtime_error("BBR's path model is off: " + to_string(bbr.bandwidth()) + " bytes/s");
+            }
+            if (bbr.mode() != BbrCongestionControl::Mode::ProbeBW) {
+                throw runtime_error("BBR should have left Startup once the bandwidth stopped growing");
+            }
+            if (bbr.cwnd() != 2 * bdp) {
+                throw runtime_error("BBR should keep two BDPs in flight, not " + to_string(bbr.cwnd()));
+            }
+            if (bbr.pacing_rate() < 750000 or bbr.pacing_rate() > 1250000) {
+                throw runtime_error("BBR should pace near the bandwidth, not " + to_string(bbr.pacing_rate()));
+            }
+
+            // losses do not shrink the window
+            bbr.on_loss(now, bdp, ackno + bdp);
+            if (bbr.cwnd() != 2 * bdp) {
+                throw runtime_error("a loss should not change BBR's window");
+            }
+
+            // a queue hides the delay for ten seconds: BBR drains it to measure again
+            bool probed_rtt = false;
+            for (; now < 13000; now++) {
+                ackno += MSS;
+                bbr.on_ack({now, ackno, MSS, min(bbr.cwnd(), 2 * bdp), 40, 1000000, false});
+                if (bbr.mode() == BbrCongestionControl::Mode::ProbeRTT) {
+                    probed_rtt = true;
+                    if (bbr.cwnd() != 4 * MSS) {
+                        throw runtime_error("ProbeRTT should hold four segments, not " + to_string(bbr.cwnd()));
+                    }
+                }
+            }
+            if (not probed_rtt or bbr.mode() != BbrCongestionControl::Mode::ProbeBW or bbr.min_rtt() != 40) {
+                throw runtime_error("BBR should have refreshed its min RTT in ProbeRTT");
+            }
+        }
+
+        for (const string name : {"none", "reno", "newreno", "cubic", "bbr"}) {
+            const auto algorithm = CongestionControl::parse(name);
+            if (not algorithm.has_value() or CongestionControl::make(algorithm.value(), MSS)->name() != name) {
+                throw runtime_error("congestion control \"" + name + "\" did not round-trip");
+            }
+        }
+        if (CongestionControl::parse("vegas").has_value()) {
+            throw runtime_error("parsed an unknown congestion control");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -1,6 +1,7 @@
 #include "sender_harness.hh"
 #include "wrapping_integers.hh"
 
+#include <algorithm>
 #include <cstdint>
 #include <cstdlib>
 #include <exception>
@@ -305,53 +306,45 @@ int main() {
             cfg.fixed_isn = isn;
             cfg.rt_timeout = rto;
 
-            TCPSenderTestHarness test{
-                "When filling window, treat a '0' window size as equal to '1' but don't back off RTO", cfg};
+            TCPSenderTestHarness test{"A '0' window size is probed one byte at a time, backing off the probes", cfg};
             test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_payload_size(0).with_seqno(isn));
             test.execute(WriteBytes("abc"));
             test.execute(ExpectNoSegment{});
             test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(0));
             test.execute(ExpectState{TCPSenderStateSummary::SYN_ACKED});
-            test.execute(ExpectSegment{}.with_payload_size(1).with_data("a").with_seqno(isn + 1).with_no_flags());
+            test.execute(ExpectNoSegment{});
             test.execute(Close{});
             test.execute(ExpectNoSegment{});
 
-            for (unsigned int i = 0; i < 5; i++) {
-                test.execute(Tick{rto - 1});
+            // the probe is resent until it is acknowledged, each interval twice the last
+            unsigned int backoff = 0;
+            auto interval = [&] { return min<size_t>(rto << backoff, TCPSender::PERSIST_MAX_MS); };
+            for (unsigned int i = 0; i <= TCPConfig::MAX_RETX_ATTEMPTS; i++, backoff++) {
+                test.execute(Tick{interval() - 1});
                 test.execute(ExpectNoSegment{});
-                test.execute(Tick{1});
+                test.execute(Tick{1}.with_max_retx_exceeded(false));
                 test.execute(ExpectSegment{}.with_payload_size(1).with_data("a").with_seqno(isn + 1).with_no_flags());
+                test.execute(ExpectBytesInFlight{1});
             }
 
+            // acknowledged but the window is still closed: the next byte waits for the next probe
             test.execute(AckReceived{isn + 2}.with_win(0));
+            test.execute(ExpectNoSegment{});
+            test.execute(Tick{interval() - 1});
+            test.execute(ExpectNoSegment{});
+            test.execute(Tick{1});
             test.execute(ExpectSegment{}.with_payload_size(1).with_data("b").with_seqno(isn + 2).with_no_flags());
 
-            for (unsigned int i = 0; i < 5; i++) {
-                test.execute(Tick{rto - 1});
-                test.execute(ExpectNoSegment{});
-                test.execute(Tick{1});
-                test.execute(ExpectSegment{}.with_payload_size(1).with_data("b").with_seqno(isn + 2).with_no_flags());
-            }
-
-            test.execute(AckReceived{isn + 3}.with_win(0));
-            test.execute(ExpectSegment{}.with_payload_size(1).with_data("c").with_seqno(isn + 3).with_no_flags());
-
-            for (unsigned int i = 0; i < 5; i++) {
-                test.execute(Tick{rto - 1});
-                test.execute(ExpectNoSegment{});
-                test.execute(Tick{1});
-                test.execute(ExpectSegment{}.with_payload_size(1).with_data("c").with_seqno(isn + 3).with_no_flags());
-            }
-
-            test.execute(AckReceived{isn + 4}.with_win(0));
-            test.execute(ExpectSegment{}.with_payload_size(0).with_data("").with_seqno(isn + 4).with_fin(true));
-
-            for (unsigned int i = 0; i < 5; i++) {
-                test.execute(Tick{rto - 1});
-                test.execute(ExpectNoSegment{});
-                test.execute(Tick{1});
-                test.execute(ExpectSegment{}.with_payload_size(0).with_data("").with_seqno(isn + 4).with_fin(true));
-            }
+            // the window reopens: the rest goes out, and the probe is back under the retransmission timer
+            test.execute(AckReceived{isn + 2}.with_win(3));
+            test.execute(ExpectSegment{}.with_payload_size(1).with_data("c").with_seqno(isn + 3).with_fin(true));
+            test.execute(ExpectBytesInFlight{3});
+            test.execute(Tick{rto - 1});
+            test.execute(ExpectNoSegment{});
+            test.execute(Tick{1});
+            test.execute(ExpectSegment{}.with_payload_size(1).with_data("b").with_seqno(isn + 2).with_no_flags());
+            test.execute(AckReceived{isn + 5}.with_win(3));
+            test.execute(ExpectState{TCPSenderStateSummary::FIN_ACKED});
         }
 
         {
@@ -422,6 +415,9 @@ int main() {
             test.execute(AckReceived{WrappingInt32{isn + 8}}.with_win(1000));
             test.execute(AckReceived{WrappingInt32{isn + 8}}.with_win(1000));
             test.execute(AckReceived{WrappingInt32{isn + 8}}.with_win(1000));
+            // with data outstanding, three duplicate ACKs trigger a fast retransmit
+            test.execute(ExpectSegment{}.with_payload_size(4).with_data("ijkl").with_seqno(isn + 8).with_fin(true));
+            test.execute(ExpectNoSegment{});
             test.execute(AckReceived{WrappingInt32{isn + 12}}.with_win(1000));
             test.execute(AckReceived{WrappingInt32{isn + 12}}.with_win(1000));
             test.execute(AckReceived{WrappingInt32{isn + 12}}.with_win(1000));
@@ -0,0 +1,125 @@
+#include "sender_harness.hh"
+#include "wrapping_integers.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <string>
+
+using namespace std;
+
+//! Five full segments outstanding after the handshake, starting at `isn + 1`
+static void send_five_segments(TCPSenderTestHarness &test, const WrappingInt32 isn) {
+    const size_t MSS = TCPConfig::MAX_PAYLOAD_SIZE;
+    test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_payload_size(0).with_seqno(isn));
+    test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(5 * MSS));
+    test.execute(WriteBytes{string(5 * MSS, 'x')});
+    for (size_t i = 0; i < 5; i++) {
+        test.execute(ExpectSegment{}.with_payload_size(MSS).with_seqno(isn + 1 + i * MSS));
+    }
+    test.execute(ExpectNoSegment{});
+}
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+        const size_t MSS = TCPConfig::MAX_PAYLOAD_SIZE;
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+
+            TCPSenderTestHarness test{"Third duplicate ACK triggers a fast retransmit", cfg};
+            send_five_segments(test, isn);
+
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(5 * MSS));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(5 * MSS));
+            test.execute(ExpectNoSegment{});
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(5 * MSS));
+            test.execute(ExpectSegment{}.with_payload_size(MSS).with_seqno(isn + 1));
+            test.execute(ExpectNoSegment{});
+
+            // further duplicates do not resend it again
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(5 * MSS));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(5 * MSS));
+            test.execute(ExpectNoSegment{});
+
+            test.execute(AckReceived{WrappingInt32{isn + 1 + 5 * MSS}}.with_win(5 * MSS));
+            test.execute(ExpectBytesInFlight{0});
+            test.execute(ExpectNoSegment{});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+
+            TCPSenderTestHarness test{"Window updates are not duplicate ACKs", cfg};
+            send_five_segments(test, isn);
+
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(5 * MSS));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(5 * MSS - 1));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(5 * MSS));
+            test.execute(ExpectNoSegment{});
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(5 * MSS));
+            test.execute(ExpectNoSegment{});
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(5 * MSS));
+            test.execute(ExpectSegment{}.with_payload_size(MSS).with_seqno(isn + 1));
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+
+            TCPSenderTestHarness test{"Without congestion control, a partial ACK waits for duplicate ACKs", cfg};
+            send_five_segments(test, isn);
+
+            for (size_t i = 0; i < 3; i++) {
+                test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(5 * MSS));
+            }
+            test.execute(ExpectSegment{}.with_payload_size(MSS).with_seqno(isn + 1));
+
+            // the repair was acknowledged, but not everything sent before it: the next segment was lost too,
+            // and only NewReno's recovery resends it on the partial ACK alone
+            test.execute(AckReceived{WrappingInt32{isn + 1 + MSS}}.with_win(4 * MSS));
+            test.execute(ExpectNoSegment{});
+            for (size_t i = 0; i < 3; i++) {
+                test.execute(AckReceived{WrappingInt32{isn + 1 + MSS}}.with_win(4 * MSS));
+            }
+            test.execute(ExpectSegment{}.with_payload_size(MSS).with_seqno(isn + 1 + MSS));
+            test.execute(ExpectNoSegment{});
+
+            // recovery ends once everything sent before the loss is acknowledged
+            test.execute(AckReceived{WrappingInt32{isn + 1 + 5 * MSS}}.with_win(5 * MSS));
+            test.execute(ExpectBytesInFlight{0});
+            test.execute(ExpectNoSegment{});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            uint16_t retx_timeout = uniform_int_distribution<uint16_t>{10, 10000}(rd);
+            cfg.fixed_isn = isn;
+            cfg.rt_timeout = retx_timeout;
+
+            TCPSenderTestHarness test{"A timeout resets the duplicate ACK count", cfg};
+            send_five_segments(test, isn);
+
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(5 * MSS));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(5 * MSS));
+            test.execute(Tick{retx_timeout});
+            test.execute(ExpectSegment{}.with_payload_size(MSS).with_seqno(isn + 1));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(5 * MSS));
+            test.execute(ExpectNoSegment{});
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
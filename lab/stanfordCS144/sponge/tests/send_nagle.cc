@@ -0,0 +1,120 @@
+#include "sender_harness.hh"
+#include "wrapping_integers.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <string>
+
+using namespace std;
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+        const size_t MSS = TCPConfig::MAX_PAYLOAD_SIZE;
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.nagle = true;
+
+            TCPSenderTestHarness test{"Nagle holds small writes while data is unacknowledged", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_payload_size(0).with_seqno(isn));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(10 * MSS));
+
+            // nothing is outstanding, so the first small write goes out at once
+            test.execute(WriteBytes{string(100, 'a')});
+            test.execute(ExpectSegment{}.with_payload_size(100).with_seqno(isn + 1));
+
+            // later ones wait for its acknowledgment, and then go out together
+            test.execute(WriteBytes{string(100, 'b')});
+            test.execute(WriteBytes{string(100, 'c')});
+            test.execute(ExpectNoSegment{});
+            test.execute(AckReceived{WrappingInt32{isn + 101}}.with_win(10 * MSS));
+            test.execute(ExpectSegment{}.with_payload_size(200).with_data(string(100, 'b') + string(100, 'c')));
+            test.execute(ExpectNoSegment{});
+
+            // a full segment is not held back, but the short remainder is
+            test.execute(WriteBytes{string(MSS + 50, 'd')});
+            test.execute(ExpectSegment{}.with_payload_size(MSS).with_seqno(isn + 301));
+            test.execute(ExpectNoSegment{});
+
+            // the end of the stream sends what is held, with the FIN
+            test.execute(Close{});
+            test.execute(ExpectSegment{}.with_payload_size(50).with_fin(true).with_seqno(isn + 301 + MSS));
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+
+            TCPSenderTestHarness test{"Without Nagle every write goes out at once", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_payload_size(0).with_seqno(isn));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(10 * MSS));
+            test.execute(WriteBytes{string(100, 'a')});
+            test.execute(WriteBytes{string(100, 'b')});
+            test.execute(ExpectSegment{}.with_payload_size(100).with_seqno(isn + 1));
+            test.execute(ExpectSegment{}.with_payload_size(100).with_seqno(isn + 101));
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+
+            TCPSenderTestHarness test{"A corked sender sends only full segments until uncorked", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_payload_size(0).with_seqno(isn));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(10 * MSS));
+
+            test.execute(Cork{});
+            for (size_t i = 0; i < 10; i++) {
+                test.execute(WriteBytes{string(MSS / 4, 'x')});
+            }
+            // ten quarter segments: two full segments go out, half of one is held
+            test.execute(ExpectSegment{}.with_payload_size(MSS).with_seqno(isn + 1));
+            test.execute(ExpectSegment{}.with_payload_size(MSS).with_seqno(isn + 1 + MSS));
+            test.execute(ExpectNoSegment{});
+
+            test.execute(Uncork{});
+            test.execute(ExpectSegment{}.with_payload_size(10 * (MSS / 4) - 2 * MSS).with_seqno(isn + 1 + 2 * MSS));
+            test.execute(ExpectNoSegment{});
+
+            // uncorked, small writes go out at once again
+            test.execute(WriteBytes{string(10, 'y')});
+            test.execute(ExpectSegment{}.with_payload_size(10));
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+
+            TCPSenderTestHarness test{"Corked data is not held longer than the cork timeout", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_payload_size(0).with_seqno(isn));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(10 * MSS));
+
+            test.execute(Cork{});
+            test.execute(WriteBytes{string(100, 'x')});
+            test.execute(Tick{TCPSender::CORK_TIMEOUT_MS - 1});
+            test.execute(ExpectNoSegment{});
+            test.execute(Tick{1});
+            test.execute(ExpectSegment{}.with_payload_size(100).with_seqno(isn + 1));
+
+            // still corked: the next short segment waits its own timeout
+            test.execute(WriteBytes{string(100, 'y')});
+            test.execute(Tick{TCPSender::CORK_TIMEOUT_MS - 1});
+            test.execute(ExpectNoSegment{});
+            test.execute(Tick{1});
+            test.execute(ExpectSegment{}.with_payload_size(100).with_seqno(isn + 101));
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
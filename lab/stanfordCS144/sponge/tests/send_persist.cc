@@ -0,0 +1,110 @@
+#include "sender_harness.hh"
+#include "wrapping_integers.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <string>
+
+using namespace std;
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.rt_timeout = 1000;
+
+            TCPSenderTestHarness test{"Data outstanding when the window closes is probed, not retransmitted", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_payload_size(0).with_seqno(isn));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(3));
+            test.execute(WriteBytes("abc"));
+            test.execute(ExpectSegment{}.with_data("abc").with_seqno(isn + 1));
+
+            // "a" arrived and filled the receiver's buffer
+            test.execute(AckReceived{WrappingInt32{isn + 2}}.with_win(0));
+            test.execute(WriteBytes("def"));
+            test.execute(Tick{999});
+            test.execute(ExpectNoSegment{});
+            test.execute(Tick{1}.with_max_retx_exceeded(false));
+            test.execute(ExpectSegment{}.with_data("abc").with_seqno(isn + 1));
+            test.execute(Tick{1999});
+            test.execute(ExpectNoSegment{});
+            test.execute(Tick{1});
+            test.execute(ExpectSegment{}.with_data("abc").with_seqno(isn + 1));
+
+            // a window update alone reopens the window
+            test.execute(AckReceived{WrappingInt32{isn + 2}}.with_win(10));
+            test.execute(ExpectSegment{}.with_data("def").with_seqno(isn + 4));
+            test.execute(ExpectNoSegment{});
+            test.execute(AckReceived{WrappingInt32{isn + 7}}.with_win(10));
+            test.execute(ExpectBytesInFlight{0});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.rt_timeout = 1000;
+
+            TCPSenderTestHarness test{"Probe intervals back off up to PERSIST_MAX_MS", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_payload_size(0).with_seqno(isn));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(0));
+            test.execute(WriteBytes("xyz"));
+            test.execute(ExpectNoSegment{});
+
+            size_t interval = 1000;
+            for (unsigned int i = 0; i < 2 * TCPConfig::MAX_RETX_ATTEMPTS; i++) {
+                test.execute(Tick{interval - 1});
+                test.execute(ExpectNoSegment{});
+                test.execute(Tick{1}.with_max_retx_exceeded(false));
+                test.execute(ExpectSegment{}.with_data("x").with_seqno(isn + 1));
+                // each probe is answered, but the window stays closed
+                test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(0));
+                interval = min<size_t>(2 * interval, TCPSender::PERSIST_MAX_MS);
+            }
+            test.execute(ExpectBytesInFlight{1});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.rt_timeout = 1000;
+
+            TCPSenderTestHarness test{"A FIN waiting on a zero window is probed by itself", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_payload_size(0).with_seqno(isn));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(0));
+            test.execute(Close{});
+            test.execute(ExpectNoSegment{});
+            test.execute(Tick{1000});
+            test.execute(ExpectSegment{}.with_payload_size(0).with_fin(true).with_seqno(isn + 1));
+            test.execute(AckReceived{WrappingInt32{isn + 2}}.with_win(0));
+            test.execute(ExpectState{TCPSenderStateSummary::FIN_ACKED});
+            test.execute(Tick{10000});
+            test.execute(ExpectNoSegment{});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+
+            TCPSenderTestHarness test{"Nothing to send, nothing to probe", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_payload_size(0).with_seqno(isn));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(0));
+            test.execute(Tick{10 * TCPSender::PERSIST_MAX_MS});
+            test.execute(ExpectNoSegment{});
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
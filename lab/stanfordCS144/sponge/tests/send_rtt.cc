@@ -0,0 +1,103 @@
+#include "sender_harness.hh"
+#include "wrapping_integers.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+
+using namespace std;
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.adaptive_rto = true;
+            cfg.rto_min = 10;
+
+            TCPSenderTestHarness test{"RTO follows SRTT + 4 * RTTVAR", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_seqno(isn));
+            test.execute(ExpectSRTT{{}});
+            test.execute(ExpectRTO{1000});
+            test.execute(Tick{100});
+            test.execute(AckReceived{WrappingInt32{isn + 1}});
+            // first sample: SRTT = 100, RTTVAR = 50
+            test.execute(ExpectSRTT{100});
+            test.execute(ExpectRTO{300});
+
+            test.execute(WriteBytes{"a"});
+            test.execute(ExpectSegment{}.with_data("a"));
+            test.execute(Tick{20});
+            test.execute(AckReceived{WrappingInt32{isn + 2}});
+            // SRTT = 7/8 * 100 + 1/8 * 20 = 90, RTTVAR = 3/4 * 50 + 1/4 * 80 = 57.5
+            test.execute(ExpectSRTT{90});
+            test.execute(ExpectRTO{320});
+
+            // the estimate is what a timer starts from
+            test.execute(WriteBytes{"b"});
+            test.execute(ExpectSegment{}.with_data("b"));
+            test.execute(Tick{319});
+            test.execute(ExpectNoSegment{});
+            test.execute(Tick{1});
+            test.execute(ExpectSegment{}.with_data("b"));
+            test.execute(ExpectRTO{640});
+
+            // Karn's rule: the ACK of a retransmitted segment is not timed
+            test.execute(Tick{500});
+            test.execute(AckReceived{WrappingInt32{isn + 3}});
+            test.execute(ExpectSRTT{90});
+            test.execute(ExpectRTO{320});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.adaptive_rto = true;
+            cfg.rto_min = 250;
+            cfg.rto_max = 700;
+
+            TCPSenderTestHarness test{"RTO stays within its bounds, also when backing off", cfg};
+            test.execute(ExpectSegment{}.with_syn(true).with_seqno(isn));
+            test.execute(Tick{1});
+            test.execute(AckReceived{WrappingInt32{isn + 1}});
+            test.execute(ExpectSRTT{1});
+            test.execute(ExpectRTO{250});
+
+            test.execute(WriteBytes{"a"});
+            test.execute(ExpectSegment{}.with_data("a"));
+            test.execute(Tick{250});
+            test.execute(ExpectSegment{}.with_data("a"));
+            test.execute(ExpectRTO{500});
+            test.execute(Tick{500});
+            test.execute(ExpectSegment{}.with_data("a"));
+            test.execute(ExpectRTO{700});
+            test.execute(Tick{700});
+            test.execute(ExpectSegment{}.with_data("a"));
+            test.execute(ExpectRTO{700});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.rt_timeout = 1000;
+
+            TCPSenderTestHarness test{"Without adaptation, RTT is measured but the RTO stays fixed", cfg};
+            test.execute(ExpectSegment{}.with_syn(true).with_seqno(isn));
+            test.execute(Tick{40});
+            test.execute(AckReceived{WrappingInt32{isn + 1}});
+            test.execute(ExpectSRTT{40});
+            test.execute(ExpectRTO{1000});
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
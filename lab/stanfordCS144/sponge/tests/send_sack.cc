@@ -0,0 +1,163 @@
+#include "sender_harness.hh"
+#include "tcp_header.hh"
+#include "util.hh"
+#include "wrapping_integers.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+//! Five full segments outstanding after the handshake, starting at `isn + 1`
+static void send_five_segments(TCPSenderTestHarness &test, const WrappingInt32 isn) {
+    const size_t MSS = TCPConfig::MAX_PAYLOAD_SIZE;
+    test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_payload_size(0).with_seqno(isn));
+    test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(5 * MSS));
+    test.execute(WriteBytes{string(5 * MSS, 'x')});
+    for (size_t i = 0; i < 5; i++) {
+        test.execute(ExpectSegment{}.with_payload_size(MSS).with_seqno(isn + 1 + i * MSS));
+    }
+    test.execute(ExpectNoSegment{});
+}
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+        const size_t MSS = TCPConfig::MAX_PAYLOAD_SIZE;
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+
+            TCPSenderTestHarness test{"Hole below DUP_THRESH SACKed segments is resent once", cfg};
+            send_five_segments(test, isn);
+
+            // two segments above the hole are not enough
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(5 * MSS).with_sack(isn + 1 + MSS,
+                                                                                         isn + 1 + 3 * MSS));
+            test.execute(ExpectNoSegment{});
+
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(5 * MSS).with_sack(isn + 1 + MSS,
+                                                                                         isn + 1 + 4 * MSS));
+            test.execute(ExpectSegment{}.with_payload_size(MSS).with_seqno(isn + 1));
+            test.execute(ExpectNoSegment{});
+
+            // more SACKs for the same hole do not resend it again
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(5 * MSS).with_sack(isn + 1 + MSS,
+                                                                                         isn + 1 + 5 * MSS));
+            test.execute(ExpectNoSegment{});
+            test.execute(ExpectBytesInFlight{5 * MSS});
+
+            // the cumulative ACK for the repair covers the SACKed segments too
+            test.execute(AckReceived{WrappingInt32{isn + 1 + 5 * MSS}}.with_win(5 * MSS));
+            test.execute(ExpectBytesInFlight{0});
+            test.execute(ExpectNoSegment{});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+
+            TCPSenderTestHarness test{"SACK information accumulates across ACKs", cfg};
+            send_five_segments(test, isn);
+
+            test.execute(AckReceived{WrappingInt32{isn + 1 + MSS}}
+                             .with_win(5 * MSS)
+                             .with_sack(isn + 1 + 4 * MSS, isn + 1 + 5 * MSS)
+                             .with_sack(isn + 1 + 2 * MSS, isn + 1 + 3 * MSS));
+            test.execute(ExpectNoSegment{});
+
+            // a block that covers only part of a segment does not count
+            test.execute(AckReceived{WrappingInt32{isn + 1 + MSS}}.with_win(5 * MSS).with_sack(isn + 2 + 3 * MSS,
+                                                                                               isn + 1 + 4 * MSS));
+            test.execute(ExpectNoSegment{});
+
+            test.execute(AckReceived{WrappingInt32{isn + 1 + MSS}}.with_win(5 * MSS).with_sack(isn + 1 + 3 * MSS,
+                                                                                               isn + 1 + 4 * MSS));
+            test.execute(ExpectSegment{}.with_payload_size(MSS).with_seqno(isn + 1 + MSS));
+            test.execute(ExpectNoSegment{});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            uint16_t retx_timeout = uniform_int_distribution<uint16_t>{10, 10000}(rd);
+            cfg.fixed_isn = isn;
+            cfg.rt_timeout = retx_timeout;
+
+            TCPSenderTestHarness test{"Timeout forgets the scoreboard", cfg};
+            send_five_segments(test, isn);
+
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(5 * MSS).with_sack(isn + 1 + MSS,
+                                                                                         isn + 1 + 5 * MSS));
+            test.execute(ExpectSegment{}.with_payload_size(MSS).with_seqno(isn + 1));
+            test.execute(Tick{retx_timeout});
+            test.execute(ExpectSegment{}.with_payload_size(MSS).with_seqno(isn + 1));
+            test.execute(ExpectNoSegment{});
+
+            // a fresh report after the timeout can trigger a repair again
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(5 * MSS).with_sack(isn + 1 + MSS,
+                                                                                         isn + 1 + 5 * MSS));
+            test.execute(ExpectSegment{}.with_payload_size(MSS).with_seqno(isn + 1));
+            test.execute(ExpectNoSegment{});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+
+            TCPSenderTestHarness test{"Blocks for data never sent are ignored", cfg};
+            send_five_segments(test, isn);
+
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(5 * MSS).with_sack(isn + 1 + MSS,
+                                                                                         isn + 1 + 6 * MSS));
+            test.execute(ExpectNoSegment{});
+        }
+
+        // options survive a serialize/parse round trip, and only those that fit in doff are written
+        {
+            TCPHeader header;
+            header.syn = true;
+            header.seqno = WrappingInt32{static_cast<uint32_t>(rd())};
+            header.sack_permitted = true;
+            for (uint32_t i = 0; i < 5; i++) {
+                header.sack.emplace_back(WrappingInt32{100 * i}, WrappingInt32{100 * i + 50});
+            }
+            if (header.options_length() != 4 + 4 + 8 * TCPHeader::MAX_SACK_BLOCKS) {
+                throw runtime_error("unexpected options length " + to_string(header.options_length()));
+            }
+            header.doff = (TCPHeader::LENGTH + header.options_length()) / 4;
+
+            TCPHeader parsed;
+            NetParser p{Buffer{header.serialize()}};
+            if (parsed.parse(p) != ParseResult::NoError or not parsed.sack_permitted or
+                parsed.sack.size() != TCPHeader::MAX_SACK_BLOCKS) {
+                throw runtime_error("SACK options did not round-trip:\n" + parsed.to_string());
+            }
+            header.sack.pop_back();
+            if (not(parsed == header)) {
+                throw runtime_error("header did not round-trip:\n" + parsed.to_string());
+            }
+
+            // no room for options: none are written
+            header.doff = TCPHeader::LENGTH / 4;
+            NetParser bare{Buffer{header.serialize()}};
+            if (parsed.parse(bare) != ParseResult::NoError or parsed.sack_permitted or not parsed.sack.empty()) {
+                throw runtime_error("options written past doff:\n" + parsed.to_string());
+            }
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -99,6 +99,88 @@ struct ExpectBytesInFlight : public SenderExpectation {
     }
 };
 
+struct ExpectRTO : public SenderExpectation {
+    unsigned int _rto;
+
+    ExpectRTO(unsigned int rto) : _rto(rto) {}
+    std::string description() const { return "retransmission timeout of " + std::to_string(_rto) + " ms"; }
+
+    void execute(TCPSender &sender, std::queue<TCPSegment> &) const {
+        if (sender.rto() != _rto) {
+            throw SenderExpectationViolation("The TCPSender reported an RTO of " + std::to_string(sender.rto()) +
+                                             " ms, but it was expected to be " + std::to_string(_rto) + " ms");
+        }
+    }
+};
+
+struct ExpectCwnd : public SenderExpectation {
+    size_t _cwnd;
+
+    ExpectCwnd(size_t cwnd) : _cwnd(cwnd) {}
+    std::string description() const { return "congestion window of " + std::to_string(_cwnd) + " bytes"; }
+
+    void execute(TCPSender &sender, std::queue<TCPSegment> &) const {
+        const size_t cwnd = sender.congestion_control().cwnd();
+        if (cwnd != _cwnd) {
+            throw SenderExpectationViolation("The TCPSender reported a congestion window of " +
+                                             std::to_string(cwnd) + " bytes, but it was expected to be " +
+                                             std::to_string(_cwnd) + " bytes");
+        }
+    }
+};
+
+struct ExpectSRTT : public SenderExpectation {
+    std::optional<unsigned int> _srtt;
+
+    ExpectSRTT(std::optional<unsigned int> srtt) : _srtt(srtt) {}
+    std::string description() const {
+        return _srtt.has_value() ? "smoothed RTT of " + std::to_string(_srtt.value()) + " ms" : "no RTT measured";
+    }
+
+    void execute(TCPSender &sender, std::queue<TCPSegment> &) const {
+        if (sender.srtt() != _srtt) {
+            throw SenderExpectationViolation("The TCPSender reported a smoothed RTT of " +
+                                             (sender.srtt().has_value() ? std::to_string(sender.srtt().value())
+                                                                        : std::string("(none)")) +
+                                             ", but it was expected to be " +
+                                             (_srtt.has_value() ? std::to_string(_srtt.value()) : "(none)"));
+        }
+    }
+};
+
+struct ExpectDeliveryRate : public SenderExpectation {
+    uint64_t _rate;
+
+    ExpectDeliveryRate(uint64_t rate) : _rate(rate) {}
+    std::string description() const { return "delivery rate of " + std::to_string(_rate) + " bytes/s"; }
+
+    void execute(TCPSender &sender, std::queue<TCPSegment> &) const {
+        if (sender.delivery_rate() != _rate) {
+            throw SenderExpectationViolation(
+                "The TCPSender reported a delivery rate of " +
+                (sender.delivery_rate().has_value() ? std::to_string(sender.delivery_rate().value())
+                                                    : std::string("(none)")) +
+                ", but it was expected to be " + std::to_string(_rate));
+        }
+    }
+};
+
+struct ExpectMinRTT : public SenderExpectation {
+    uint64_t _min_rtt;
+
+    ExpectMinRTT(uint64_t min_rtt) : _min_rtt(min_rtt) {}
+    std::string description() const { return "min RTT of " + std::to_string(_min_rtt) + " ms"; }
+
+    void execute(TCPSender &sender, std::queue<TCPSegment> &) const {
+        if (sender.min_rtt() != _min_rtt) {
+            throw SenderExpectationViolation("The TCPSender reported a min RTT of " +
+                                             (sender.min_rtt().has_value() ? std::to_string(sender.min_rtt().value())
+                                                                           : std::string("(none)")) +
+                                             ", but it was expected to be " + std::to_string(_min_rtt));
+        }
+    }
+};
+
 struct ExpectNoSegment : public SenderExpectation {
     ExpectNoSegment() {}
     std::string description() const { return "no (more) segments"; }
@@ -191,11 +273,15 @@ struct Tick : public SenderAction {
 struct AckReceived : public SenderAction {
     WrappingInt32 _ackno;
     std::optional<uint16_t> _window_advertisement{};
+    std::vector<std::pair<WrappingInt32, WrappingInt32>> _sack{};
 
     AckReceived(WrappingInt32 ackno) : _ackno(ackno) {}
     std::string description() const {
         std::ostringstream ss;
         ss << "ack " << _ackno.raw_value() << " winsize " << _window_advertisement.value_or(DEFAULT_TEST_WINDOW);
+        for (const auto &[left, right] : _sack) {
+            ss << " sack " << left << "-" << right;
+        }
         return ss.str();
     }
 
@@ -204,8 +290,13 @@ struct AckReceived : public SenderAction {
         return *this;
     }
 
+    AckReceived &with_sack(WrappingInt32 left, WrappingInt32 right) {
+        _sack.emplace_back(left, right);
+        return *this;
+    }
+
     void execute(TCPSender &sender, std::queue<TCPSegment> &) const {
-        sender.ack_received(_ackno, _window_advertisement.value_or(DEFAULT_TEST_WINDOW));
+        sender.ack_received(_ackno, _window_advertisement.value_or(DEFAULT_TEST_WINDOW), _sack);
         sender.fill_window();
     }
 };
@@ -220,6 +311,20 @@ struct Close : public SenderAction {
     }
 };
 
+struct Cork : public SenderAction {
+    Cork() {}
+    std::string description() const { return "cork"; }
+
+    void execute(TCPSender &sender, std::queue<TCPSegment> &) const { sender.cork(); }
+};
+
+struct Uncork : public SenderAction {
+    Uncork() {}
+    std::string description() const { return "uncork"; }
+
+    void execute(TCPSender &sender, std::queue<TCPSegment> &) const { sender.uncork(); }
+};
+
 struct ExpectSegment : public SenderExpectation {
     std::optional<bool> ack{};
     std::optional<bool> rst{};
@@ -394,9 +499,18 @@ class TCPSenderTestHarness {
   public:
     TCPSenderTestHarness(const std::string &name_, TCPConfig config)
         : outbound_segments()
-        , sender(config.send_capacity, config.rt_timeout, config.fixed_isn)
+        , sender(config.send_capacity,
+                 config.rt_timeout,
+                 config.fixed_isn,
+                 config.stream_backend,
+                 config.mss,
+                 config.congestion_control)
         , steps_executed()
         , name(name_) {
+        if (config.adaptive_rto) {
+            sender.adapt_rto(config.rto_min, config.rto_max);
+        }
+        sender.set_nagle(config.nagle);
         sender.fill_window();
         collect_output();
         std::ostringstream ss;
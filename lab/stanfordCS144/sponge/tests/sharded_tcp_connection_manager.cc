@@ -0,0 +1,219 @@
+#include "sharded_tcp_connection_manager.hh"
+#include "spsc_queue.hh"
+#include "tcp_connection_manager.hh"
+#include "test_should_be.hh"
+#include "util.hh"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace std;
+using ConnectionId = TCPConnectionManager::ConnectionId;
+
+static const TCPConnectionManager::Callbacks NO_CALLBACKS{};
+
+//! Run the managers (on this thread) until `done` returns true, or fail after `limit_ms`
+template <typename F>
+static void run_until(vector<unique_ptr<TCPConnectionManager>> &managers, F &&done, const uint64_t limit_ms = 20000) {
+    const uint64_t deadline = timestamp_ms() + limit_ms;
+    while (not done()) {
+        if (timestamp_ms() > deadline) {
+            throw runtime_error("timed out");
+        }
+        for (auto &manager : managers) {
+            manager->wait_next_event(chrono::microseconds{100});
+        }
+    }
+}
+
+int main() {
+    try {
+        // one producer, one consumer: everything arrives, in order, and a full queue refuses more
+        {
+            SpscQueue<string> queue{5};
+            test_should_be(queue.capacity(), size_t{8});
+            for (unsigned i = 0; i < 8; i++) {
+                test_should_be(queue.push(to_string(i)), true);
+            }
+            string refused = "refused";
+            test_should_be(queue.push(move(refused)), false);
+            test_should_be(refused == "refused", true);
+            string value;
+            test_should_be(queue.pop(value), true);
+            test_should_be(value == "0", true);
+            test_should_be(queue.push(move(refused)), true);
+            for (unsigned i = 1; i < 8; i++) {
+                test_should_be(queue.pop(value), true);
+                test_should_be(value == to_string(i), true);
+            }
+            test_should_be(queue.pop(value), true);
+            test_should_be(value == "refused", true);
+            test_should_be(queue.pop(value), false);
+            test_should_be(queue.empty(), true);
+
+            constexpr uint64_t COUNT = 1000000;
+            SpscQueue<uint64_t> numbers{64};
+            thread producer([&] {
+                for (uint64_t i = 0; i < COUNT; i++) {
+                    uint64_t number = i;
+                    while (not numbers.push(move(number))) {
+                        this_thread::yield();
+                    }
+                }
+            });
+            uint64_t expected = 0;
+            while (expected < COUNT) {
+                uint64_t number = 0;
+                if (numbers.pop(number)) {
+                    test_should_be(number, expected);
+                    expected++;
+                } else {
+                    this_thread::yield();
+                }
+            }
+            producer.join();
+            test_should_be(numbers.empty(), true);
+        }
+
+        TCPConfig tcp_config{};
+        tcp_config.rt_timeout = 20;
+        FdAdapterConfig config{};
+        config.source = {"127.0.0.1", 0};
+        constexpr size_t SHARDS = 4;
+
+        // a sharded echo server, with clients on several UDP sockets: every connection is served once,
+        // by whichever shard owns its flow, however the kernel spreads the datagrams
+        {
+            vector<atomic<size_t>> accepted(SHARDS);
+            atomic<size_t> server_closed{0};
+            ShardedTCPConnectionManager server{
+                SHARDS, tcp_config, config, [&](const size_t shard, TCPConnectionManager &manager) {
+                    TCPConnectionManager::Callbacks callbacks{};
+                    callbacks.on_open = [&accepted, shard](ConnectionId) { accepted[shard]++; };
+                    callbacks.on_readable = [&manager](ConnectionId id) {
+                        ByteStream &inbound = manager.inbound_stream(id);
+                        string data = inbound.read(inbound.buffer_size());
+                        if (not data.empty()) {
+                            manager.write(id, move(data));
+                        }
+                        if (inbound.eof()) {
+                            manager.end_input(id);
+                        }
+                    };
+                    callbacks.on_close = [&](ConnectionId) { server_closed++; };
+                    return callbacks;
+                }};
+            test_should_be(server.shards(), SHARDS);
+            server.set_listening(true);
+
+            constexpr size_t CLIENTS = 4, CONNECTIONS = 100;
+            vector<unique_ptr<TCPConnectionManager>> clients{};
+            map<pair<size_t, ConnectionId>, string> echoes{};
+            size_t client_closed = 0;
+            for (size_t c = 0; c < CLIENTS; c++) {
+                clients.push_back(make_unique<TCPConnectionManager>(tcp_config, config, NO_CALLBACKS));
+                TCPConnectionManager &client = *clients.back();
+                TCPConnectionManager::Callbacks callbacks{};
+                callbacks.on_readable = [&echoes, &client, c](ConnectionId id) {
+                    ByteStream &inbound = client.inbound_stream(id);
+                    echoes[{c, id}] += inbound.read(inbound.buffer_size());
+                };
+                callbacks.on_close = [&echoes, &client_closed, c](ConnectionId id) {
+                    client_closed++;
+                    test_should_be((echoes[{c, id}] == "message " + to_string(c) + "/" + to_string(id)), true);
+                };
+                client.set_callbacks(move(callbacks));
+            }
+            for (size_t i = 0; i < CONNECTIONS; i++) {
+                for (size_t c = 0; c < CLIENTS; c++) {
+                    TCPConnectionManager &client = *clients[c];
+                    const ConnectionId id = client.connect(server.local_address());
+                    client.write(id, "message " + to_string(c) + "/" + to_string(id));
+                    client.end_input(id);
+                }
+            }
+
+            run_until(clients, [&] { return client_closed == CLIENTS * CONNECTIONS; });
+            run_until(clients, [&] { return server_closed == CLIENTS * CONNECTIONS; });
+            size_t total = 0, busy_shards = 0;
+            for (const auto &count : accepted) {
+                total += count;
+                busy_shards += count > 0;
+            }
+            test_should_be(total, CLIENTS * CONNECTIONS);
+            test_should_be(busy_shards, SHARDS);
+        }
+
+        // connections opened from the shards, in turn, to an unsharded manager
+        {
+            vector<unique_ptr<TCPConnectionManager>> servers{};
+            servers.push_back(make_unique<TCPConnectionManager>(tcp_config, config, NO_CALLBACKS));
+            TCPConnectionManager &peer = *servers.back();
+            TCPConnectionManager::Callbacks peer_callbacks{};
+            peer_callbacks.on_readable = [&peer](ConnectionId id) {
+                ByteStream &inbound = peer.inbound_stream(id);
+                string data = inbound.read(inbound.buffer_size());
+                if (not data.empty()) {
+                    peer.write(id, move(data));
+                }
+                if (inbound.eof()) {
+                    peer.end_input(id);
+                }
+            };
+            peer.set_callbacks(move(peer_callbacks));
+            peer.set_listening(true);
+
+            vector<atomic<size_t>> echoed(SHARDS);
+            atomic<size_t> closed{0};
+            ShardedTCPConnectionManager client{
+                SHARDS, tcp_config, config, [&](const size_t shard, TCPConnectionManager &manager) {
+                    TCPConnectionManager::Callbacks callbacks{};
+                    callbacks.on_open = [&manager](ConnectionId id) {
+                        manager.write(id, "hello");
+                        manager.end_input(id);
+                    };
+                    callbacks.on_readable = [&manager, &echoed, shard](ConnectionId id) {
+                        ByteStream &inbound = manager.inbound_stream(id);
+                        if (inbound.read(inbound.buffer_size()) == "hello") {
+                            echoed[shard]++;
+                        }
+                    };
+                    callbacks.on_close = [&](ConnectionId) { closed++; };
+                    return callbacks;
+                }};
+
+            constexpr size_t CONNECTIONS = 40;
+            for (size_t i = 0; i < CONNECTIONS; i++) {
+                test_should_be(client.connect(peer.local_address()), i % SHARDS);
+            }
+            run_until(servers, [&] {
+                size_t total = 0;
+                for (const auto &count : echoed) {
+                    total += count;
+                }
+                return total == CONNECTIONS and closed == CONNECTIONS and peer.size() == 0;
+            });
+            for (const auto &count : echoed) {
+                test_should_be(size_t{count}, CONNECTIONS / SHARDS);
+            }
+            client.stop();
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,227 @@
+#include "tcp_connection_manager.hh"
+#include "tcp_segment.hh"
+#include "tcp_sponge_socket.hh"
+#include "test_should_be.hh"
+#include "util.hh"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+
+using namespace std;
+using ConnectionId = TCPConnectionManager::ConnectionId;
+
+static constexpr chrono::microseconds NO_WAIT{0};
+
+//! Run both managers until `done` returns true, or fail after `limit_ms`
+template <typename F>
+static void run_both(TCPConnectionManager &a, TCPConnectionManager &b, F &&done, const uint64_t limit_ms = 10000) {
+    const uint64_t deadline = timestamp_ms() + limit_ms;
+    while (not done()) {
+        if (timestamp_ms() > deadline) {
+            throw runtime_error("timed out");
+        }
+        a.wait_next_event(chrono::microseconds{100});
+        b.wait_next_event(NO_WAIT);
+    }
+}
+
+int main() {
+    try {
+        TCPConfig tcp_config{};
+        tcp_config.rt_timeout = 20;  // (connections linger ten times this long after closing)
+        FdAdapterConfig server_config{};
+        server_config.source = {"127.0.0.1", 0};
+        FdAdapterConfig client_config{};
+        client_config.source = {"127.0.0.1", 0};
+
+        // the next tick of a connection is when its timer is due, not periodic
+        {
+            TCPConnection tcp{tcp_config};
+            test_should_be(tcp.next_tick().has_value(), false);
+            tcp.connect();
+            test_should_be(tcp.next_tick().value(), size_t{20});
+            tcp.tick(15);
+            test_should_be(tcp.next_tick().value(), size_t{5});
+        }
+
+        // many connections between two managers: each client sends a message, the server echoes it
+        {
+            constexpr size_t CONNECTIONS = 300;
+            TCPConnectionManager *server_ptr = nullptr;
+            TCPConnectionManager::Callbacks server_callbacks{};
+            size_t accepted = 0, server_closed = 0;
+            server_callbacks.on_open = [&](ConnectionId) { accepted++; };
+            server_callbacks.on_readable = [&](ConnectionId id) {
+                ByteStream &inbound = server_ptr->inbound_stream(id);
+                string data = inbound.read(inbound.buffer_size());
+                if (not data.empty()) {
+                    server_ptr->write(id, move(data));
+                }
+                if (inbound.eof()) {
+                    server_ptr->end_input(id);
+                }
+            };
+            server_callbacks.on_close = [&](ConnectionId) { server_closed++; };
+            TCPConnectionManager server{tcp_config, server_config, server_callbacks};
+            server_ptr = &server;
+            server.set_listening(true);
+
+            TCPConnectionManager *client_ptr = nullptr;
+            TCPConnectionManager::Callbacks client_callbacks{};
+            map<ConnectionId, string> echoes{};
+            size_t opened = 0, client_closed = 0;
+            client_callbacks.on_open = [&](ConnectionId) { opened++; };
+            client_callbacks.on_readable = [&](ConnectionId id) {
+                ByteStream &inbound = client_ptr->inbound_stream(id);
+                echoes[id] += inbound.read(inbound.buffer_size());
+            };
+            client_callbacks.on_close = [&](ConnectionId id) {
+                client_closed++;
+                test_should_be(echoes[id] == "message " + to_string(id), true);
+            };
+            TCPConnectionManager client{tcp_config, client_config, client_callbacks};
+            client_ptr = &client;
+
+            for (size_t i = 0; i < CONNECTIONS; i++) {
+                const ConnectionId id = client.connect(server.local_address());
+                test_should_be(client.write(id, "message " + to_string(id)) > 0, true);
+                client.end_input(id);
+            }
+            test_should_be(client.size(), CONNECTIONS);
+            // (each is waiting for its SYN to be acknowledged)
+            test_should_be(client.timers(), CONNECTIONS);
+
+            run_both(client, server, [&] { return client_closed == CONNECTIONS and server_closed == CONNECTIONS; });
+            test_should_be(opened, CONNECTIONS);
+            test_should_be(accepted, CONNECTIONS);
+            test_should_be(client.size(), size_t{0});
+            test_should_be(server.size(), size_t{0});
+            test_should_be(client.timers(), size_t{0});
+            test_should_be(server.timers(), size_t{0});
+        }
+
+        // an established, idle connection needs no wakeups at all
+        {
+            TCPConnectionManager server{tcp_config, server_config, {}};
+            server.set_listening(true);
+            size_t opened = 0;
+            TCPConnectionManager::Callbacks client_callbacks{};
+            client_callbacks.on_open = [&](ConnectionId) { opened++; };
+            TCPConnectionManager client{tcp_config, client_config, client_callbacks};
+            client.connect(server.local_address());
+            run_both(client, server, [&] { return opened == 1 and server.size() == 1; });
+            test_should_be(client.timers(), size_t{0});
+            test_should_be(server.timers(), size_t{0});
+        }
+
+        // a manager destroyed with connections open resets them, rather than leave the peers waiting
+        {
+            optional<TCPConnectionManager> server{};
+            server.emplace(tcp_config, server_config, TCPConnectionManager::Callbacks{});
+            server->set_listening(true);
+            size_t opened = 0, closed = 0;
+            TCPConnectionManager::Callbacks client_callbacks{};
+            client_callbacks.on_open = [&](ConnectionId) { opened++; };
+            client_callbacks.on_close = [&](ConnectionId) { closed++; };
+            TCPConnectionManager client{tcp_config, client_config, client_callbacks};
+            client.connect(server->local_address());
+            run_both(client, server.value(), [&] { return opened == 1 and server->size() == 1; });
+
+            server.reset();
+            const uint64_t deadline = timestamp_ms() + 1000;
+            while (closed == 0 and timestamp_ms() < deadline) {
+                client.wait_next_event(chrono::milliseconds{1});
+            }
+            test_should_be(closed, size_t{1});  // (an idle connection would otherwise stay open)
+        }
+
+        // a segment of no connection is refused with a RST (and a RST is not answered)
+        {
+            TCPConnectionManager server{tcp_config, server_config, {}};
+            UDPSocket peer{};
+            peer.bind({"127.0.0.1", 0});
+            TCPSegment syn{};
+            syn.header().syn = true;
+            syn.header().seqno = WrappingInt32{1000};
+            syn.header().sport = 7;
+            syn.header().dport = server.local_address().port();
+            peer.sendto(server.local_address(), syn.serialize(0));
+            TCPSegment rst{};
+            rst.header().rst = true;
+            peer.sendto(server.local_address(), rst.serialize(0));
+
+            const uint64_t deadline = timestamp_ms() + 1000;
+            UDPSocket::received_datagram datagram{{nullptr, 0}, {}};
+            while (not peer.try_recv(datagram) and timestamp_ms() < deadline) {
+                server.wait_next_event(chrono::milliseconds{1});
+            }
+            TCPSegment refusal{};
+            test_should_be(refusal.parse(move(datagram.payload), 0) == ParseResult::NoError, true);
+            test_should_be(refusal.header().rst and refusal.header().ack, true);
+            test_should_be(refusal.header().ackno.raw_value(), uint32_t{1001});
+            test_should_be(refusal.header().sport, syn.header().dport);
+            test_should_be(refusal.header().dport, uint16_t{7});
+            server.wait_next_event(chrono::milliseconds{10});
+            test_should_be(peer.try_recv(datagram), false);
+            test_should_be(server.size(), size_t{0});
+        }
+
+        // a manager's first connection to a peer talks to a TCPOverUDPSpongeSocket
+        {
+            UDPSocket udp{};
+            udp.bind({"127.0.0.1", 0});
+            const Address server_address = udp.local_address();
+            TCPOverUDPSpongeSocket sock{TCPOverUDPSocketAdapter{move(udp)}};
+            thread server_thread([&] {
+                FdAdapterConfig config{};
+                config.source = server_address;
+                sock.listen_and_accept(tcp_config, config);
+                string received;
+                while (not sock.eof()) {
+                    received += sock.read();
+                }
+                sock.write(received);
+                sock.shutdown(SHUT_WR);
+                sock.wait_until_closed();
+            });
+
+            TCPConnectionManager *client_ptr = nullptr;
+            TCPConnectionManager::Callbacks callbacks{};
+            string echo;
+            bool closed = false;
+            callbacks.on_readable = [&](ConnectionId id) {
+                ByteStream &inbound = client_ptr->inbound_stream(id);
+                echo += inbound.read(inbound.buffer_size());
+            };
+            callbacks.on_close = [&](ConnectionId) { closed = true; };
+            TCPConnectionManager client{tcp_config, client_config, callbacks};
+            client_ptr = &client;
+            const ConnectionId id = client.connect(server_address);
+            client.write(id, "to a sponge socket");
+            client.end_input(id);
+
+            const uint64_t deadline = timestamp_ms() + 10000;
+            while (not closed and timestamp_ms() < deadline) {
+                client.wait_next_event(chrono::milliseconds{10});
+            }
+            server_thread.join();
+            test_should_be(closed, true);
+            test_should_be(echo == "to a sponge socket", true);
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -11,6 +11,7 @@
 #include <exception>
 #include <optional>
 #include <sstream>
+#include <utility>
 
 struct TCPExpectation : public TCPTestStep {
     virtual ~TCPExpectation() {}
@@ -390,6 +391,10 @@ struct SendSegment : public TCPAction {
     WrappingInt32 seqno{0};
     WrappingInt32 ackno{0};
     uint16_t win{0};
+    std::optional<uint16_t> mss{};
+    std::optional<uint8_t> wscale{};
+    bool sack_permitted{false};
+    std::optional<std::pair<uint32_t, uint32_t>> timestamps{};
     size_t payload_size{0};
     std::string data{};
 
@@ -445,6 +450,26 @@ struct SendSegment : public TCPAction {
         return *this;
     }
 
+    SendSegment &with_mss(uint16_t mss_) {
+        mss = mss_;
+        return *this;
+    }
+
+    SendSegment &with_wscale(uint8_t wscale_) {
+        wscale = wscale_;
+        return *this;
+    }
+
+    SendSegment &with_sack_permitted(bool sack_permitted_) {
+        sack_permitted = sack_permitted_;
+        return *this;
+    }
+
+    SendSegment &with_timestamps(uint32_t tsval, uint32_t tsecr) {
+        timestamps = {tsval, tsecr};
+        return *this;
+    }
+
     SendSegment &with_payload_size(size_t payload_size_) {
         payload_size = payload_size_;
         return *this;
@@ -466,6 +491,10 @@ struct SendSegment : public TCPAction {
         data_hdr.ackno = ackno;
         data_hdr.seqno = seqno;
         data_hdr.win = win;
+        data_hdr.mss = mss;
+        data_hdr.wscale = wscale;
+        data_hdr.sack_permitted = sack_permitted;
+        data_hdr.timestamps = timestamps;
         return data_seg;
     }
 
@@ -0,0 +1,231 @@
+#include "tcp_connection_manager.hh"
+#include "tcp_segment.hh"
+#include "tcp_sponge_listener.hh"
+#include "tcp_sponge_socket.hh"
+#include "test_should_be.hh"
+#include "util.hh"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace std;
+using ConnectionId = TCPConnectionManager::ConnectionId;
+
+static const TCPConnectionManager::Callbacks NO_CALLBACKS{};
+
+//! Run the managers until `done` returns true, or fail after `limit_ms`
+template <typename F>
+static void run_until(vector<unique_ptr<TCPConnectionManager>> &managers, F &&done, const uint64_t limit_ms = 20000) {
+    const uint64_t deadline = timestamp_ms() + limit_ms;
+    while (not done()) {
+        if (timestamp_ms() > deadline) {
+            throw runtime_error("timed out");
+        }
+        for (auto &manager : managers) {
+            manager->wait_next_event(chrono::microseconds{100});
+        }
+    }
+}
+
+int main() {
+    try {
+        TCPConfig tcp_config{};
+        tcp_config.rt_timeout = 20;
+        FdAdapterConfig config{};
+        config.source = {"127.0.0.1", 0};
+
+        // a manager drops the SYNs of new flows while its SYN backlog is full of half-open connections
+        {
+            TCPConnectionManager server{tcp_config, config, NO_CALLBACKS};
+            server.set_listening(true);
+            server.set_syn_backlog(2);
+            const uint16_t port = server.local_address().port();
+
+            UDPSocket peer{};
+            peer.bind({"127.0.0.1", 0});
+            for (uint16_t sport = 1000; sport < 1005; sport++) {
+                TCPSegment syn{};
+                syn.header().syn = true;
+                syn.header().sport = sport;
+                syn.header().dport = port;
+                peer.sendto(server.local_address(), syn.serialize(0));
+            }
+            const uint64_t deadline = timestamp_ms() + 1000;
+            while (server.half_open() < 2 and timestamp_ms() < deadline) {
+                server.wait_next_event(chrono::milliseconds{1});
+            }
+            server.wait_next_event(chrono::milliseconds{10});
+            test_should_be(server.half_open(), size_t{2});
+            test_should_be(server.size(), size_t{2});
+
+            // (a SYN-ACK for each, perhaps retransmitted)
+            UDPSocket::received_datagram datagram{{nullptr, 0}, {}};
+            set<uint16_t> answered{};
+            while (peer.try_recv(datagram)) {
+                TCPSegment syn_ack{};
+                test_should_be(syn_ack.parse(move(datagram.payload), 0) == ParseResult::NoError, true);
+                test_should_be(syn_ack.header().syn and syn_ack.header().ack, true);
+                answered.insert(syn_ack.header().dport);
+            }
+            test_should_be(answered.size(), size_t{2});
+
+            // half-open connections that are reset leave the SYN backlog
+            for (uint16_t sport = 1000; sport < 1005; sport++) {
+                TCPSegment rst{};
+                rst.header().rst = true;
+                rst.header().sport = sport;
+                rst.header().dport = port;
+                peer.sendto(server.local_address(), rst.serialize(0));
+            }
+            while (server.size() > 0 and timestamp_ms() < deadline + 1000) {
+                server.wait_next_event(chrono::milliseconds{1});
+            }
+            test_should_be(server.half_open(), size_t{0});
+            test_should_be(server.size(), size_t{0});
+        }
+
+        // a listener with a small backlog: connections beyond it wait (their SYNs are dropped, and
+        // retransmitted) until the application accepts; then every one is served
+        {
+            constexpr size_t BACKLOG = 4, CLIENTS = 2, CONNECTIONS = 8;
+            TCPSpongeListener listener{tcp_config, config, BACKLOG};
+
+            vector<unique_ptr<TCPConnectionManager>> clients{};
+            map<pair<size_t, ConnectionId>, string> replies{};
+            size_t opened = 0, closed = 0;
+            for (size_t c = 0; c < CLIENTS; c++) {
+                clients.push_back(make_unique<TCPConnectionManager>(tcp_config, config, NO_CALLBACKS));
+                TCPConnectionManager &client = *clients.back();
+                TCPConnectionManager::Callbacks callbacks{};
+                callbacks.on_open = [&opened](ConnectionId) { opened++; };
+                callbacks.on_readable = [&replies, &client, c](ConnectionId id) {
+                    ByteStream &inbound = client.inbound_stream(id);
+                    replies[{c, id}] += inbound.read(inbound.buffer_size());
+                };
+                callbacks.on_close = [&closed](ConnectionId) { closed++; };
+                client.set_callbacks(move(callbacks));
+                for (size_t i = 0; i < CONNECTIONS; i++) {
+                    const ConnectionId id = client.connect(listener.local_address());
+                    client.write(id, "request " + to_string(c) + "/" + to_string(id));
+                    client.end_input(id);
+                }
+            }
+
+            // nothing is accepted yet: the backlog fills, and stays full
+            run_until(clients, [&] { return listener.queued() == BACKLOG; });
+            const uint64_t until = timestamp_ms() + 100;
+            run_until(clients, [&] { return timestamp_ms() > until; });
+            test_should_be(listener.queued(), BACKLOG);
+            test_should_be(opened, BACKLOG);
+
+            // the application: a socket per connection, each echoing its request
+            thread application([&] {
+                vector<LocalStreamSocket> sockets{};
+                for (size_t i = 0; i < CLIENTS * CONNECTIONS; i++) {
+                    sockets.push_back(listener.accept());
+                    LocalStreamSocket &sock = sockets.back();
+                    string request;
+                    while (not sock.eof()) {
+                        request += sock.read();
+                    }
+                    sock.write("reply to " + request);
+                    sock.shutdown(SHUT_WR);
+                }
+            });
+            run_until(clients, [&] { return closed == CLIENTS * CONNECTIONS; });
+            application.join();
+
+            test_should_be(opened, CLIENTS * CONNECTIONS);
+            for (const auto &[connection, reply] : replies) {
+                const string request = "request " + to_string(connection.first) + "/" + to_string(connection.second);
+                test_should_be(reply == "reply to " + request, true);
+            }
+            test_should_be(replies.size(), CLIENTS * CONNECTIONS);
+            test_should_be(listener.queued(), size_t{0});
+        }
+
+        // an accepted socket writes many times the send capacity: the listener takes more of it each time
+        // the peer's ACKs make room in the outbound stream
+        {
+            const size_t SIZE = 8 * tcp_config.send_capacity + 1;
+            TCPSpongeListener listener{tcp_config, config};
+            thread application([&] {
+                LocalStreamSocket sock = listener.accept();
+                sock.write(string(SIZE, 'x'));
+                sock.shutdown(SHUT_WR);
+                while (not sock.eof()) {
+                    sock.read();
+                }
+            });
+
+            vector<unique_ptr<TCPConnectionManager>> clients{};
+            clients.push_back(make_unique<TCPConnectionManager>(tcp_config, config, NO_CALLBACKS));
+            TCPConnectionManager &client = *clients.back();
+            size_t received = 0;
+            bool closed = false;
+            TCPConnectionManager::Callbacks callbacks{};
+            callbacks.on_readable = [&](ConnectionId id) {
+                ByteStream &inbound = client.inbound_stream(id);
+                received += inbound.read(inbound.buffer_size()).size();
+                if (inbound.eof()) {
+                    client.end_input(id);
+                }
+            };
+            callbacks.on_close = [&closed](ConnectionId) { closed = true; };
+            client.set_callbacks(move(callbacks));
+            client.connect(listener.local_address());
+
+            run_until(clients, [&] { return closed; });
+            application.join();
+            test_should_be(received, SIZE);
+        }
+
+        // a TCPOverUDPSpongeSocket connects to a listener like to any other peer
+        {
+            TCPSpongeListener listener{tcp_config, config};
+            thread application([&] {
+                LocalStreamSocket sock = listener.accept();
+                string request;
+                while (not sock.eof()) {
+                    request += sock.read();
+                }
+                sock.write("reply to " + request);
+                sock.shutdown(SHUT_WR);
+            });
+
+            UDPSocket udp{};
+            udp.bind({"127.0.0.1", 0});
+            FdAdapterConfig client_config{};
+            client_config.source = udp.local_address();
+            client_config.destination = listener.local_address();
+            TCPOverUDPSpongeSocket sock{TCPOverUDPSocketAdapter{move(udp)}};
+            sock.connect(tcp_config, client_config);
+            sock.write("a sponge socket");
+            sock.shutdown(SHUT_WR);
+            string received;
+            while (not sock.eof()) {
+                received += sock.read();
+            }
+            sock.wait_until_closed();
+            application.join();
+            test_should_be(received == "reply to a sponge socket", true);
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,116 @@
+#include "test_should_be.hh"
+#include "timer_wheel.hh"
+#include "util.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        // timers fire in order of expiry, never early, and expiry rounds up to a whole tick
+        {
+            TimerWheel wheel{100};
+            vector<int> fired;
+            wheel.schedule(250, [&] { fired.push_back(2); });
+            wheel.schedule(150, [&] { fired.push_back(1); });
+            wheel.schedule(300, [&] { fired.push_back(3); });
+            test_should_be(wheel.size(), size_t{3});
+            test_should_be(wheel.next_expiry().value_or(0), uint64_t{200});
+
+            test_should_be(wheel.advance(199), size_t{0});
+            test_should_be(wheel.advance(200), size_t{1});
+            test_should_be(wheel.advance(299), size_t{0});  // 250 rounds up to 300
+            test_should_be(wheel.advance(300), size_t{2});
+            test_should_be(fired == vector<int>({1, 2, 3}), true);
+            test_should_be(wheel.size(), size_t{0});
+            test_should_be(wheel.next_expiry().has_value(), false);
+        }
+
+        // cancelled timers do not fire; a callback can schedule a timer that is already due
+        {
+            TimerWheel wheel{10};
+            int fired = 0;
+            const auto id = wheel.schedule(1000, [&] { fired += 100; });
+            wheel.schedule(500, [&] {
+                fired++;
+                wheel.schedule(0, [&] { fired++; });
+            });
+            test_should_be(wheel.cancel(id), true);
+            test_should_be(wheel.cancel(id), false);
+            test_should_be(wheel.advance(5000), size_t{2});
+            test_should_be(fired, 2);
+        }
+
+        // timers far enough out to start on the upper levels cascade down and fire on time
+        {
+            TimerWheel wheel{1};
+            uint64_t fired_at = 0;
+            uint64_t now = 0;
+            const uint64_t when = 64 * 64 * 64 + 4321;
+            wheel.schedule(when, [&] { fired_at = now; });
+            while (fired_at == 0) {
+                const auto next = wheel.next_expiry();
+                test_should_be(next.has_value(), true);
+                test_should_be(next.value() <= when, true);  // sleeping until next_expiry() never oversleeps
+                now = next.value();
+                wheel.advance(now);
+            }
+            test_should_be(fired_at, when);
+        }
+
+        // against a simple model: random timers (some beyond the top level) and random clock steps
+        for (unsigned round = 0; round < 5; round++) {
+            TimerWheel wheel{1};
+            map<unsigned, pair<uint64_t, TimerWheel::TimerId>> pending;  // key -> (expiry, id)
+            vector<unsigned> fired;
+            uint64_t now = 0;
+
+            for (unsigned key = 0; key < 2000; key++) {
+                const unsigned shift = uniform_int_distribution<unsigned>{0, 26}(rd);
+                const uint64_t when = now + uniform_int_distribution<uint64_t>{0, uint64_t{1} << shift}(rd);
+                pending[key] = {when, wheel.schedule(when, [&fired, key] { fired.push_back(key); })};
+
+                if (key % 7 == 0) {
+                    const auto victim = pending.begin();
+                    test_should_be(wheel.cancel(victim->second.second), true);
+                    pending.erase(victim);
+                }
+
+                now += uniform_int_distribution<uint64_t>{0, uint64_t{1} << (key % 24)}(rd);
+                fired.clear();
+                const size_t count = wheel.advance(now);
+                test_should_be(count, fired.size());
+
+                // exactly the timers that expired by now fired, each once
+                vector<unsigned> expected;
+                for (auto it = pending.begin(); it != pending.end();) {
+                    if (it->second.first <= now) {
+                        expected.push_back(it->first);
+                        it = pending.erase(it);
+                    } else {
+                        ++it;
+                    }
+                }
+                sort(fired.begin(), fired.end());
+                test_should_be(fired == expected, true);
+                test_should_be(wheel.size(), pending.size());
+            }
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}